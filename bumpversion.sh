@@ -38,6 +38,14 @@ NOTICE_FLAG="${CYAN}❯"
 ADJUSTMENTS_MSG="${QUESTION_FLAG} ${CYAN}Now you can make adjustments to ${WHITE}CHANGELOG.md${CYAN}. Then press enter to continue."
 PUSHING_MSG="${NOTICE_FLAG} Pushing new version to the ${WHITE}origin${CYAN}..."
 
+# the library's copy of the version, which keys the on-disk calendar cache
+LIBVERSION_FILE="src/datetimetools_pvt.h"
+
+set_libversion() {
+    sed -e "s/^#define LIBVERSION \".*\"/#define LIBVERSION \"$1\"/" \
+        "$LIBVERSION_FILE" > tmpfile && mv tmpfile "$LIBVERSION_FILE"
+}
+
 if [ -f VERSION ]; then
     BASE_STRING=`cat VERSION`
     BASE_LIST=(`echo $BASE_STRING | tr '.' ' '`)
@@ -56,6 +64,7 @@ if [ -f VERSION ]; then
     fi
     echo -e "${NOTICE_FLAG} Will set new version to be ${WHITE}$INPUT_STRING"
     echo $INPUT_STRING > VERSION
+    set_libversion "$INPUT_STRING"
     echo "## $INPUT_STRING ($NOW)" > tmpfile
     git log --pretty=format:"  - %s" "v$BASE_STRING"...HEAD >> tmpfile
     echo "" >> tmpfile
@@ -65,7 +74,7 @@ if [ -f VERSION ]; then
     echo -e "$ADJUSTMENTS_MSG"
     read
     echo -e "$PUSHING_MSG"
-    git add CHANGELOG.md VERSION
+    git add CHANGELOG.md VERSION "$LIBVERSION_FILE"
     git commit -m "Bump version to ${INPUT_STRING}."
     git tag -a -m "Tag version ${INPUT_STRING}." "v$INPUT_STRING"
     git push origin --tags
@@ -80,6 +89,7 @@ else
     if [ "$RESPONSE" = "YES" ]; then RESPONSE="y"; fi
     if [ "$RESPONSE" = "y" ]; then
         echo "1.0.0" > VERSION
+        set_libversion "1.0.0"
         echo "## 1.0.0 ($NOW)" > CHANGELOG.md
         git log --pretty=format:"  - %s" >> CHANGELOG.md
         echo "" >> CHANGELOG.md
@@ -87,7 +97,7 @@ else
         echo -e "$ADJUSTMENTS_MSG"
         read
         echo -e "$PUSHING_MSG"
-        git add VERSION CHANGELOG.md
+        git add VERSION CHANGELOG.md "$LIBVERSION_FILE"
         git commit -m "Add VERSION and CHANGELOG.md files, Bump version to v1.0.0."
         git tag -a -m "Tag version 1.0.0." "v1.0.0"
         git push origin --tags
@@ -46,7 +46,11 @@
 #define LEAP 1
 #define LASTWEEK 9 /* This is the magic number for a holiday rule that applies
                     to the last x-day of a certain month */
+#define EASTERMINOFFSET -80 /* offsets from Easter Sunday (E rules) that */
+#define EASTERMAXOFFSET 250 /* always stay within Easter's year */
 #define DATESTRINGLEN 20 /* max length of a date string, enough for a long date */
+#define CHAINTRIGGER -1 /* a deadline counted from the chain's trigger date */
+#define MAXCHAINTHREADS 64 /* most threads a batch of chains is spread over */
 
 /* Days of the week */
 enum DAYS {
@@ -87,6 +91,43 @@ enum MONTHS {
                     "holidays" that apply to all months, e.g., Sundays. */
 };
 
+/* How an observed ('O') holiday moves when it falls on a weekend */
+enum OBSERVEDSHIFT {
+    SHIFT_NONE = 0, /* not moved */
+    SHIFT_SUNDAYTOMONDAY = 1, /* Sunday to the following Monday */
+    SHIFT_NEAREST = 2, /* Saturday to Friday, Sunday to Monday */
+    SHIFT_SATURDAYTOFRIDAY = 3 /* Saturday to the preceding Friday */
+};
+
+/* What a closure overlay says about a date */
+enum OVERLAYSTATE {
+    OVERLAY_NONE = 0, /* whatever the base rule set says */
+    OVERLAY_CLOSED = 1, /* closed, e.g., by an emergency order */
+    OVERLAY_OPEN = 2 /* open, even if the rules close it */
+};
+
+/* The periods court-day statistics are reported by */
+enum STATPERIOD {
+    PERIOD_MONTH = 1,
+    PERIOD_QUARTER = 2,
+    PERIOD_YEAR = 3
+};
+
+/* What an enumeration lists, and how; OR them together */
+enum ENUMFLAGS {
+    ENUM_COURTDAYS = 0, /* list the court days */
+    ENUM_HOLIDAYS = 1, /* list the holidays and weekends instead */
+    ENUM_PACKED = 2 /* list dates as YYYYMMDD rather than as JDNs */
+};
+
+/* How a deadline is counted from the date it depends on */
+enum CHAINSTEP {
+    STEP_CALENDARDAYS = 0, /* calendar days */
+    STEP_COURTDAYS = 1, /* court days, as courtday_offset() counts them */
+    STEP_ROLLFORWARD = 2, /* calendar days, then on to the next court day */
+    STEP_ROLLBACKWARD = 3 /* calendar days, then back to the last court day */
+};
+
 enum DATEORDER{
     MDY,
     YMD
@@ -133,6 +174,141 @@ struct DateTime
 };
 
 struct HolidayNode;
+struct RuleSet;
+struct HolidayLanes;
+struct HolidayOverlay;
+struct HolidayPrecompute;
+struct HolidayChain;
+struct HolidayChainInstance;
+
+/* Statistics describing the cache of compiled year calendars. */
+
+struct HolidayCacheStats
+{
+    unsigned long hits; /* lookups answered from the cache */
+    unsigned long misses; /* lookups that had to compile the year */
+    unsigned long evictions; /* calendars dropped to stay within budget */
+    size_t budget_bytes; /* the configured budget */
+    size_t resident_bytes; /* memory now held, including the year index */
+    size_t calendar_bytes; /* cost of one cached year */
+    int capacity; /* years that fit within the budget */
+    int resident; /* years currently cached */
+    int mapped; /* years mapped from the on-disk cache directory */
+};
+
+/* How often one holiday rule has been tested and how often it matched. */
+
+struct HolidayRuleStats
+{
+    char holidayname[40];
+    char authority[100];
+    int month; /* ALLMONTHS for rules that apply to every month */
+    char ruletype;
+    unsigned long checks; /* times the rule was tested */
+    unsigned long hits; /* times it matched */
+};
+
+/* A holiday rule, with the fields of a rule file record. */
+
+struct HolidayRuleSpec
+{
+    int month; /* ALLMONTHS for rules that apply to every month */
+    char ruletype; /* 'A' (absolute), 'R' (relative), 'W' (weekend),
+                    * 'O' (observed), or 'E' (Easter-relative) */
+    int wkday; /* SUNDAY - SATURDAY, for R and W rules */
+    int wknum; /* week of the month (1 - 5, or LASTWEEK), for R rules */
+    int day; /* day of the month, for A and O rules */
+    const char *holidayname;
+    const char *authority;
+    int effective_from; /* first date in effect, as YYYYMMDD, or 0 */
+    int effective_until; /* last date in effect, as YYYYMMDD, or 0 */
+    int shift; /* an OBSERVEDSHIFT, for O rules */
+    int offset; /* days after Easter Sunday (negative for before), E rules */
+};
+
+/* Where an enumeration of days has got to.  Set up by
+ * holiday_enumerate_begin(); the caller owns it. */
+
+struct HolidayEnumeration
+{
+    int nextjdn; /* the first day not yet looked at */
+    int lastjdn; /* the last day of the range */
+    int flags; /* ENUMFLAGS */
+};
+
+/* Court days and closed days in one month, quarter or year. */
+
+struct HolidayPeriodStats
+{
+    int year;
+    int period; /* month (1 - 12), quarter (1 - 4), or 0 for the year */
+    int courtdays;
+    int holidays; /* days closed, weekends included */
+};
+
+/* A period during which a deadline's clock is stopped (tolled), e.g., by a
+ * stay or an emergency order, as JDNs. */
+
+struct HolidayTolledPeriod
+{
+    int firstjdn;
+    int lastjdn; /* inclusive */
+};
+
+/* One deadline of a chain template, e.g., {"Opposition due", CHAINTRIGGER,
+ * STEP_COURTDAYS, -9} for nine court days before the hearing. */
+
+struct DeadlineSpec
+{
+    const char *name;
+    int from; /* index of the deadline this one is counted from, or
+               * CHAINTRIGGER */
+    int step; /* a CHAINSTEP */
+    int amount; /* days to count; negative counts backward */
+};
+
+/* What one worker thread did in a batch of deadline chains. */
+
+struct HolidayChainWorkerStats
+{
+    long cases; /* cases this worker evaluated */
+    long chunks; /* runs of cases it took at a time */
+    long steals; /* times it took work from another worker */
+    long failures; /* cases with a deadline outside 1753 - 9999 */
+};
+
+/* Why a day is closed. */
+
+struct HolidayExplanation
+{
+    int jdn;
+    const char *holidayname; /* e.g., "Thanksgiving Day", or "" if open */
+    const char *authority; /* e.g., "5 U.S.C. 6103(a)", or "" if open */
+};
+
+/* A day that two rule sets disagree on. */
+
+struct HolidayDiff
+{
+    struct DateTime date;
+    int closed_before; /* 1 if closed under the first rule set, else 0 */
+    const char *before_rule; /* the holiday closing it in each, or "" */
+    const char *after_rule;
+};
+
+/* Memory used by one jurisdiction in the registry. */
+
+struct HolidayJurisdictionStats
+{
+    int loaded; /* 0 until the jurisdiction is first used */
+    int numrules;
+    size_t rule_bytes; /* the jurisdiction's own rules */
+    size_t calendar_bytes; /* the compiled calendars it uses */
+    int sharers; /* jurisdictions using those calendars, itself included */
+    size_t resident_bytes; /* rule_bytes + calendar_bytes / sharers */
+    size_t pool_bytes; /* the string pool, shared by every rule set */
+    struct HolidayCacheStats cache; /* the cache of those calendars */
+};
 
 /*-----------------------------------------------------------------------------
  * Activate Rule Handler 
@@ -140,6 +316,759 @@ struct HolidayNode;
 
 int holiday_rules_open(const char *receivedrulefilename, int close_on_success);
 
+/*
+ * Name: holiday_rules_get_stats
+ *
+ * Description: Reports, for every loaded rule in the order the rules are
+ *   tested, how many times it was tested and how many times it matched.
+ *   Rules are tested whenever a year is compiled into the calendar cache
+ *   (once per day of the year) or a date is checked outside the cache.
+ *
+ * Parameters: An array for the statistics and the number of entries it holds.
+ *
+ * Return: The number of rules, which may exceed maxrules.
+ */
+int holiday_rules_get_stats(struct HolidayRuleStats stats[], int maxrules);
+
+/* Zeroes every rule's counters. */
+void holiday_rules_reset_stats(void);
+
+/*
+ * Name: holiday_rules_reorder
+ *
+ * Description: Reorders the rules so that those that have matched the most
+ *   dates are tested first, cheaper rules breaking ties.  Results do not
+ *   change, only the number of rules tested to reach them.  Until this is
+ *   called, rules are tested in the order they appear in the rule file.
+ *
+ * Usage: Run some representative queries, or compile a span of years, and
+ *   then reorder.  Not while other threads are checking dates.
+ */
+void holiday_rules_reorder(void);
+
+/*-----------------------------------------------------------------------------
+ * Calendar Cache
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: holiday_cache_set_budget
+ *
+ * Description: Sets how much memory the loaded rules may spend on compiled
+ *   year calendars.  Each year is compiled into a bitmap the first time a date
+ *   in it is checked; once the budget is full, the least recently used years
+ *   are evicted (CLOCK approximation).  A budget too small to hold one year
+ *   turns the cache off, and every date is checked against the rules directly.
+ *   The default budget is 64 KiB.
+ *
+ * Usage: Discards all cached years.  Call it before or after
+ *   holiday_rules_open(), but not while other threads are checking dates.
+ *
+ * Return: The number of years that fit within the budget.
+ */
+int holiday_cache_set_budget(size_t budget_bytes);
+
+/*
+ * Name: holiday_cache_set_threadlocal
+ *
+ * Description: Turns the per-thread copies of recently used years on (the
+ *   default) or off.  Each thread keeps copies of the last few years it looked
+ *   up, so that threads working in the same years do not contend for the
+ *   shared cache.  The copies are dropped automatically when the rules are
+ *   reloaded or the budget changes, and do not count against the budget.
+ */
+void holiday_cache_set_threadlocal(int enabled);
+
+/*
+ * Name: holiday_cache_get_stats
+ *
+ * Description: Reports the hit, miss, and eviction counts and the memory used
+ *   by the cache, so the budget can be sized for each set of rules.  Hits on
+ *   other threads' per-thread copies are reported in batches of 256, so the
+ *   hit count can trail behind by up to that many per thread and year, and
+ *   hits not yet reported when a thread exits are not counted.
+ */
+void holiday_cache_get_stats(struct HolidayCacheStats *stats);
+
+/* Zeroes the hit, miss, and eviction counters. */
+void holiday_cache_reset_stats(void);
+
+/*
+ * Name: holiday_ruleset_set_cache_budget, holiday_ruleset_get_cache_stats,
+ *   holiday_ruleset_reset_cache_stats
+ *
+ * Description: holiday_cache_set_budget(), holiday_cache_get_stats(), and
+ *   holiday_cache_reset_stats() for a rule set other than the active rules,
+ *   e.g., one from holiday_ruleset_load() or holiday_registry_get(), so each
+ *   jurisdiction's cache can be sized to its own traffic.  Rule sets that
+ *   share calendars (see holiday_registry_get()) share the one cache, and
+ *   setting its budget sets it for all of them.
+ *
+ * Return: holiday_ruleset_set_cache_budget() returns the number of years that
+ *   fit within the budget, or -1 if rules is NULL.
+ */
+int holiday_ruleset_set_cache_budget(struct RuleSet *rules,
+                                     size_t budget_bytes);
+void holiday_ruleset_get_cache_stats(struct RuleSet *rules,
+                                     struct HolidayCacheStats *stats);
+void holiday_ruleset_reset_cache_stats(struct RuleSet *rules);
+
+/*
+ * Name: holiday_cache_set_dir
+ *
+ * Description: Keeps compiled calendars on disk between runs.  When rules are
+ *   next loaded with holiday_rules_open(), the years firstyear to lastyear are
+ *   looked up in dirname and mapped read-only; if they are not there, they
+ *   are compiled once and saved for the next process.  Entries are keyed by a
+ *   hash of the rule file's contents and the library version, so editing the
+ *   rule file or upgrading the library makes the old entry inapplicable
+ *   without any clean-up.  Mapped years do not count against the budget set
+ *   by holiday_cache_set_budget().
+ *
+ * Parameters: An existing, writable directory (or NULL to stop using one),
+ *   and the first and last years to keep on disk (1753 - 9999).
+ *
+ * Return: 0 on success; -1 if the span or directory name is invalid.
+ */
+int holiday_cache_set_dir(const char *dirname, int firstyear, int lastyear);
+
+/*
+ * Name: holiday_cache_precompute
+ *
+ * Description: Compiles a span of years into the cache in the background, so
+ *   the first query in each of those years does not pay to compile it.  The
+ *   years are shared out among numthreads worker threads; queries may run in
+ *   the meantime and simply compile any year they need that is not ready yet.
+ *   The span is cut short if it would not fit within the cache budget.
+ *
+ * Usage: Typically called right after holiday_rules_open(), e.g., for the
+ *   current year - 10 to the current year + 30.  Do not load new rules or
+ *   change the budget until the job has been waited on.
+ *
+ * Parameters: The first and last years; the number of worker threads (0 for
+ *   one per online processor); and an optional function to call once every
+ *   year is compiled, with userdata as its argument.  It runs on whichever
+ *   thread finishes last: usually a worker, but it may be the calling thread
+ *   before holiday_cache_precompute() returns, e.g., if the workers are
+ *   quick, the span is empty, or no thread could be started.
+ *
+ * Return: A handle for holiday_precompute_isready() and
+ *   holiday_precompute_wait(), or NULL if out of memory.
+ */
+struct HolidayPrecompute *holiday_cache_precompute(int firstyear, int lastyear,
+                                                   int numthreads,
+                                                   void (*ready)(void *),
+                                                   void *userdata);
+
+/* Returns 1 once every year in the job has been compiled, 0 until then. */
+int holiday_precompute_isready(struct HolidayPrecompute *job);
+
+/* Waits for the job's workers to finish and releases the handle. */
+void holiday_precompute_wait(struct HolidayPrecompute *job);
+
+/*-----------------------------------------------------------------------------
+ * Rule Sets
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: holiday_ruleset_load
+ *
+ * Description: Loads a holiday rule file as a rule set of its own, alongside
+ *   the rules loaded by holiday_rules_open(), e.g., to keep the federal and
+ *   state court calendars loaded at the same time.  Each rule set has its own
+ *   calendar cache (with the default budget) and uses the cache directory
+ *   set by holiday_cache_set_dir().
+ *
+ * Return: The rule set, or NULL if the file cannot be opened or read.
+ */
+struct RuleSet *holiday_ruleset_load(const char *rulefilename);
+
+/* Returns the rule set loaded by holiday_rules_open(), which isholiday() and
+ * the other date functions use. */
+struct RuleSet *holiday_ruleset_active(void);
+
+/*
+ * Name: holiday_ruleset_union, holiday_ruleset_intersection
+ *
+ * Description: Combines two rule sets into a composite.  In a union, a day is
+ *   closed if it is closed under either rule set (e.g., a case removed from
+ *   federal court to state court); in an intersection, only if it is closed
+ *   under both.  Composites may themselves be combined.  Each year of a
+ *   composite is compiled by combining its operands' compiled calendars, and
+ *   is then cached, so a query costs the same as for a single rule set.
+ *   Reloading an operand with holiday_rules_open() discards the composite's
+ *   cached years as well.
+ *
+ * Return: The composite, or NULL if either operand is NULL or out of memory.
+ */
+struct RuleSet *holiday_ruleset_union(struct RuleSet *left,
+                                      struct RuleSet *right);
+struct RuleSet *holiday_ruleset_intersection(struct RuleSet *left,
+                                             struct RuleSet *right);
+
+/*
+ * Name: holiday_ruleset_close
+ *
+ * Description: Releases a rule set made by the functions above.
+ *
+ * Return: 0 on success; -1 if a composite still depends on it, or if it is
+ *   the active rule set, which cannot be closed.
+ */
+int holiday_ruleset_close(struct RuleSet *rules);
+
+/* Like isholiday(), but under the given rule set. */
+int holiday_ruleset_isholiday(struct RuleSet *rules, struct DateTime *dt);
+
+/* Like next_courtday(), prev_courtday() and nearest_courtday(), but under the
+ * given rule set. */
+int holiday_ruleset_next_courtday(struct RuleSet *rules, struct DateTime *dt,
+                                  struct DateTime *result);
+int holiday_ruleset_prev_courtday(struct RuleSet *rules, struct DateTime *dt,
+                                  struct DateTime *result);
+int holiday_ruleset_nearest_courtday(struct RuleSet *rules,
+                                     struct DateTime *dt,
+                                     struct DateTime *result);
+
+/*
+ * Name: holiday_ruleset_period_stats
+ *
+ * Description: Counts the court days and closed days in each month, quarter
+ *   or year (PERIOD_MONTH, PERIOD_QUARTER or PERIOD_YEAR) from firstyear
+ *   through lastyear, e.g., for capacity planning.  Each month takes two
+ *   lookups in a compiled year's court-day index, so a decade costs about
+ *   as much as compiling it.
+ *
+ * Parameters: The rule set, the span of years (within 1753 - 9999), the
+ *   period, and an array for the statistics, filled in date order, and its
+ *   size.
+ *
+ * Return: The number of periods in the span, which may exceed maxstats; -1
+ *   if the rule set is NULL or the span or period is not valid.
+ */
+int holiday_ruleset_period_stats(struct RuleSet *rules, int firstyear,
+                                 int lastyear, int period,
+                                 struct HolidayPeriodStats stats[],
+                                 int maxstats);
+
+/*
+ * Name: holiday_ruleset_period_stats_batch
+ *
+ * Description: holiday_ruleset_period_stats() for several rule sets (e.g.,
+ *   every jurisdiction in the registry) over the same span.  The statistics
+ *   for rules[n] start at stats[n * the return value].
+ *
+ * Return: The number of periods for each rule set; stats must hold numrules
+ *   times as many.  -1 if a rule set is NULL or the span or period is not
+ *   valid.
+ */
+int holiday_ruleset_period_stats_batch(struct RuleSet *rules[], int numrules,
+                                       int firstyear, int lastyear,
+                                       int period,
+                                       struct HolidayPeriodStats stats[]);
+
+/* Like nth_courtday_in_period() and courtday_ordinal(), but under the given
+ * rule set. */
+int holiday_ruleset_nth_courtday(struct RuleSet *rules, int year,
+                                 int periodkind, int period, int n,
+                                 struct DateTime *result);
+int holiday_ruleset_courtday_ordinal(struct RuleSet *rules,
+                                     struct DateTime *dt, int periodkind);
+
+/*
+ * Name: holiday_ruleset_explain, holiday_ruleset_explain_range
+ *
+ * Description: holiday_explain() under the given rule set, for one date or
+ *   for every closed date from first through last, in date order.
+ *
+ * Return: For a range, the number of closed dates, which may exceed maxwhy.
+ */
+int holiday_ruleset_explain(struct RuleSet *rules, struct DateTime *dt,
+                            struct HolidayExplanation *why);
+int holiday_ruleset_explain_range(struct RuleSet *rules,
+                                  struct DateTime *first,
+                                  struct DateTime *last,
+                                  struct HolidayExplanation why[],
+                                  int maxwhy);
+
+/* Like enumerate_days(), but under the given rule set. */
+int holiday_ruleset_enumerate(struct RuleSet *rules,
+                              struct HolidayEnumeration *cursor,
+                              int dates[], int maxdates);
+
+/*
+ * Name: holiday_ruleset_add_rule, holiday_ruleset_remove_rule,
+ *   holiday_ruleset_replace_rule
+ *
+ * Description: Edits the rules of a loaded rule set (including the active
+ *   one) without reloading it.  Years already compiled are patched rather
+ *   than discarded: only the days the changed rule matches are looked at
+ *   again, and the court-day counts are adjusted from the first changed day
+ *   onward, so an edit costs microseconds even with centuries cached.
+ *   Composites built on the rule set are brought up to date too.  Rules are
+ *   removed by holiday name (the first rule with that name).  A registry rule
+ *   set that was sharing calendars with another jurisdiction gets calendars of
+ *   its own first; years mapped from the cache directory are dropped, since
+ *   they no longer match the rules.  Lanes must be rebuilt.
+ *
+ * Usage: Not while other threads are checking dates under the rule set, or
+ *   under any jurisdiction sharing its calendars: the edit moves those onto
+ *   calendars of their own and patches the ones they were reading.
+ *
+ * Return: 0 on success; -1 if the rule set is a composite or has no rules
+ *   loaded, the rule is not valid, or no rule has that name.
+ */
+int holiday_ruleset_add_rule(struct RuleSet *rules,
+                             const struct HolidayRuleSpec *rule);
+int holiday_ruleset_remove_rule(struct RuleSet *rules,
+                                const char *holidayname);
+int holiday_ruleset_replace_rule(struct RuleSet *rules,
+                                 const char *holidayname,
+                                 const struct HolidayRuleSpec *rule);
+
+/*
+ * Name: holiday_ruleset_diff
+ *
+ * Description: Finds every day from firstyear through lastyear that is closed
+ *   under one rule set and open under the other, e.g., to check a new rule
+ *   file against the one it replaces before deploying it.  The two sets'
+ *   compiled calendars are compared a word at a time, so years they agree on
+ *   cost next to nothing and centuries can be compared in milliseconds.
+ *
+ * Parameters: The rule sets, the span of years (within 1753 - 9999), and an
+ *   array for the differences, filled in date order, and its size.
+ *
+ * Return: The number of days that differ, which may exceed maxdiffs; -1 if
+ *   a rule set is NULL or the span is not valid.
+ */
+int holiday_ruleset_diff(struct RuleSet *before, struct RuleSet *after,
+                         int firstyear, int lastyear,
+                         struct HolidayDiff diffs[], int maxdiffs);
+
+/*-----------------------------------------------------------------------------
+ * Jurisdiction Registry
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: holiday_registry_add
+ *
+ * Description: Registers the rule file for a jurisdiction (e.g., "CA-LA").
+ *   Nothing is read until the jurisdiction is first asked for.
+ *
+ * Return: 0 on success; -1 if the jurisdiction is already registered.
+ */
+int holiday_registry_add(const char *jurisdiction, const char *rulefilename);
+
+/*
+ * Name: holiday_registry_get
+ *
+ * Description: Returns a jurisdiction's rule set, loading its rule file on
+ *   first use.  Jurisdictions whose rules turn out to be the same as those
+ *   of a jurisdiction already loaded (whatever the holidays are called or
+ *   which authorities are cited) share that jurisdiction's compiled
+ *   calendars, so memory grows with the number of distinct rule sets rather
+ *   than the number of jurisdictions.  Holiday names and authorities are
+ *   stored once however many rule files repeat them.  Registry rule sets
+ *   live for the life of the process and cannot be closed.
+ *
+ * Usage: Look each jurisdiction up once and keep the rule set; the lookup
+ *   takes a lock.  Rule files are read one at a time, but without holding up
+ *   lookups of jurisdictions already loaded.
+ *
+ * Return: The rule set, or NULL if the jurisdiction is not registered or its
+ *   rule file cannot be read.
+ */
+struct RuleSet *holiday_registry_get(const char *jurisdiction);
+
+/*
+ * Name: holiday_registry_get_stats
+ *
+ * Description: Reports the memory a jurisdiction uses, counting an equal
+ *   share of any calendars it shares with other jurisdictions, and the hit
+ *   rate and budget of the cache that holds those calendars.
+ *
+ * Return: 0 on success; -1 if the jurisdiction is not registered.
+ */
+int holiday_registry_get_stats(const char *jurisdiction,
+                               struct HolidayJurisdictionStats *stats);
+
+/*
+ * Name: holiday_registry_set_cache_budget
+ *
+ * Description: holiday_ruleset_set_cache_budget() for a jurisdiction, loading
+ *   its rule file first if it has not been used yet.  A jurisdiction sharing
+ *   another's calendars sets the budget of the shared cache.
+ *
+ * Return: The number of years that fit within the budget, or -1 if the
+ *   jurisdiction is not registered or its rule file could not be read.
+ */
+int holiday_registry_set_cache_budget(const char *jurisdiction,
+                                      size_t budget_bytes);
+
+/*-----------------------------------------------------------------------------
+ * Closure Overlays
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: holiday_overlay_create
+ *
+ * Description: Creates an empty overlay of one-off closures (fires, power
+ *   outages, a courtroom's dark days) and forced openings on top of a rule
+ *   set.  The base is not copied, and any number of overlays (e.g., one per
+ *   department) can share it.  Edits to the base's rules show through.
+ *
+ * Return: The overlay, or NULL if base is NULL or out of memory.
+ */
+struct HolidayOverlay *holiday_overlay_create(struct RuleSet *base);
+
+/* Releases an overlay; its base is left alone. */
+void holiday_overlay_release(struct HolidayOverlay *overlay);
+
+/*
+ * Name: holiday_overlay_set
+ *
+ * Description: Marks a date OVERLAY_CLOSED or OVERLAY_OPEN, or OVERLAY_NONE
+ *   to go back to the base's answer.  O(log n) in the overlay's dates.
+ *
+ * Return: 0 on success; -1 if state is not valid or out of memory.
+ */
+int holiday_overlay_set(struct HolidayOverlay *overlay, struct DateTime *dt,
+                        int state);
+
+/* Like isholiday(), but with the overlay's dates applied to its base. */
+int holiday_overlay_isholiday(struct HolidayOverlay *overlay,
+                              struct DateTime *dt);
+
+/*
+ * Name: holiday_overlay_courtdays
+ *
+ * Description: Counts the court days from first through last, inclusive,
+ *   with the overlay applied: the base's count from its court-day index,
+ *   corrected by the overlay's dates in the range in O(log n).
+ *
+ * Return: The count, or 0 if last is before first.
+ */
+int holiday_overlay_courtdays(struct HolidayOverlay *overlay,
+                              struct DateTime *first, struct DateTime *last);
+
+/* Returns the number of dates the overlay sets. */
+int holiday_overlay_numdates(struct HolidayOverlay *overlay);
+
+/*-----------------------------------------------------------------------------
+ * Multi-Jurisdiction Lanes
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: holiday_lanes_build
+ *
+ * Description: Lays out the calendars of several rule sets side by side, one
+ *   bit lane per rule set, for the years firstyear to lastyear, so that one
+ *   lookup answers for every rule set at once.  Up to one lane per bit of an
+ *   unsigned long (64 on LP64 systems).  Uses 8 bytes per day on LP64.
+ *
+ * Parameters: The rule sets (lane n is rules[n]), how many there are, and
+ *   the span of years.
+ *
+ * Return: The lanes, or NULL if a rule set is NULL, there are too many, the
+ *   span is not within 1753 - 9999, or out of memory.  Rebuild them after
+ *   any of the rule sets is reloaded.
+ */
+struct HolidayLanes *holiday_lanes_build(struct RuleSet *rules[], int numlanes,
+                                         int firstyear, int lastyear);
+
+void holiday_lanes_release(struct HolidayLanes *lanes);
+
+/*
+ * Name: holiday_lanes_closed
+ *
+ * Description: Returns a mask with bit n set if the date is a holiday or
+ *   weekend under rule set n.  Dates outside the span are answered too, by
+ *   asking each rule set in turn.  holiday_lanes_closed_batch() does the same
+ *   for an array of Julian Day Numbers.
+ */
+unsigned long holiday_lanes_closed(const struct HolidayLanes *lanes,
+                                   struct DateTime *dt);
+void holiday_lanes_closed_batch(const struct HolidayLanes *lanes,
+                                const int jdns[], unsigned long closed[],
+                                int count);
+
+/*
+ * Name: holiday_lanes_courtday_offset
+ *
+ * Description: Does courtday_offset() under every rule set at once, counting
+ *   the lanes together with bit-sliced counters.
+ *
+ * Parameters: The start date, the number of court days to count (negative
+ *   to count backward), and an array with one result per lane.
+ *
+ * Return: 0, or -1 if any lane's result falls outside 1753 - 9999 (its jdn
+ *   is -1).
+ */
+int holiday_lanes_courtday_offset(const struct HolidayLanes *lanes,
+                                  struct DateTime *orig_date, int numdays,
+                                  struct DateTime results[]);
+
+/*-----------------------------------------------------------------------------
+ * Deadline Chains
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: holiday_chain_build, holiday_chain_release
+ *
+ * Description: Compiles a chain template: deadlines that each count from the
+ *   trigger date or from another deadline, in any order so long as no
+ *   deadline depends on itself.  The template is sorted once, so that each
+ *   deadline comes after the one it counts from, and can then be evaluated
+ *   against any rule set, any number of times.  The names are copied.
+ *
+ * Return: The template, or NULL if a deadline counts from one that does not
+ *   exist, the deadlines form a cycle, a step is not a CHAINSTEP, or out of
+ *   memory.
+ */
+struct HolidayChain *holiday_chain_build(const struct DeadlineSpec deadlines[],
+                                         int numdeadlines);
+void holiday_chain_release(struct HolidayChain *chain);
+
+/*
+ * Name: evaluate_deadlines, holiday_ruleset_evaluate_deadlines
+ *
+ * Description: Works out every deadline of a chain from a trigger date, under
+ *   the active rules or the given rule set, in one pass.  Court days are
+ *   counted from the court-day index (a rank and a select per deadline)
+ *   rather than a day at a time, and nothing is allocated.
+ *
+ * Parameters: jdns has room for one JDN per deadline, in the order the
+ *   deadlines were given to holiday_chain_build().
+ *
+ * Return: 0, or -1 if any deadline falls outside 1753 - 9999 (its JDN, and
+ *   those of the deadlines counted from it, are -1).
+ */
+int evaluate_deadlines(const struct HolidayChain *chain,
+                       struct DateTime *trigger, int jdns[]);
+int holiday_ruleset_evaluate_deadlines(struct RuleSet *rules,
+                                       const struct HolidayChain *chain,
+                                       struct DateTime *trigger, int jdns[]);
+
+/*
+ * Name: evaluate_deadlines_batch, holiday_ruleset_evaluate_deadlines_batch
+ *
+ * Description: Evaluates one chain for many cases (e.g., every open case
+ *   after a rule change), spread over a pool of threads that share the rule
+ *   set's compiled calendars.  Each thread starts with an equal share of the
+ *   cases and, when it runs out, steals half of what another has left, so
+ *   uneven cases do not leave threads idle.  The calling thread is one of
+ *   the workers.
+ *
+ * Usage: Not while the rule set is being edited or reloaded.
+ *
+ * Parameters: The trigger date of each case as a JDN; room for numdeadlines
+ *   JDNs per case (case n's start at jdns[n * numdeadlines]); the number of
+ *   threads (0 for one per online processor, up to MAXCHAINTHREADS); and
+ *   optionally room for one HolidayChainWorkerStats per thread.
+ *
+ * Return: The number of threads used (and stats filled in), or -1 if out of
+ *   memory.
+ */
+int evaluate_deadlines_batch(const struct HolidayChain *chain,
+                             const int triggerjdns[], int numcases,
+                             int jdns[], int numthreads,
+                             struct HolidayChainWorkerStats stats[]);
+int holiday_ruleset_evaluate_deadlines_batch(struct RuleSet *rules,
+        const struct HolidayChain *chain, const int triggerjdns[],
+        int numcases, int jdns[], int numthreads,
+        struct HolidayChainWorkerStats stats[]);
+
+/*
+ * Name: evaluate_deadlines_columns, holiday_ruleset_evaluate_deadlines_columns
+ *
+ * Description: Evaluates one chain for many cases that differ only in their
+ *   trigger dates, a deadline at a time across every case rather than a case
+ *   at a time.  The years the cases span are first laid out as two arrays, a
+ *   court-day count for each day and a list of the court days, so that every
+ *   step for every case is an add or a rank and a select, each one array
+ *   read.  Cases that stray outside those years are counted the usual way.
+ *
+ * Parameters: The trigger date of each case as a JDN, and one column per
+ *   deadline: columns[d] has room for numcases JDNs, deadline d of each case.
+ *
+ * Return: 0, or -1 if any deadline falls outside 1753 - 9999 (its JDN is -1).
+ */
+int evaluate_deadlines_columns(const struct HolidayChain *chain,
+                               const int triggerjdns[], int numcases,
+                               int *columns[]);
+int holiday_ruleset_evaluate_deadlines_columns(struct RuleSet *rules,
+        const struct HolidayChain *chain, const int triggerjdns[],
+        int numcases, int *columns[]);
+
+/*
+ * Name: latest_trigger, earliest_trigger, and holiday_ruleset_latest_trigger,
+ *   holiday_ruleset_earliest_trigger
+ *
+ * Description: Solves a chain backward: the latest trigger date for which a
+ *   deadline falls on or before target (e.g., the last day to file so the
+ *   reply is due by the hearing), or the earliest for which it falls on or
+ *   after it.  Each step back to the trigger date is undone in turn, the way
+ *   latest_courtday_start() undoes a court-day offset.
+ *
+ * Return: 0, or -1 if there is no such deadline, or no such date within
+ *   1753 - 9999.
+ */
+int latest_trigger(const struct HolidayChain *chain, int deadline,
+                   struct DateTime *target, struct DateTime *trigger);
+int earliest_trigger(const struct HolidayChain *chain, int deadline,
+                     struct DateTime *target, struct DateTime *trigger);
+int holiday_ruleset_latest_trigger(struct RuleSet *rules,
+                                   const struct HolidayChain *chain,
+                                   int deadline, struct DateTime *target,
+                                   struct DateTime *trigger);
+int holiday_ruleset_earliest_trigger(struct RuleSet *rules,
+                                     const struct HolidayChain *chain,
+                                     int deadline, struct DateTime *target,
+                                     struct DateTime *trigger);
+
+/*
+ * Name: track_deadlines, holiday_chain_instance_create,
+ *   holiday_chain_instance_release
+ *
+ * Description: Sets up a case's deadlines under a chain template, under the
+ *   active rules or the given rule set, so that they can be kept up to date
+ *   as the case's dates change without working out the whole chain again.
+ *   The instance remembers each deadline, and a change marks only the
+ *   deadlines downstream of it to be worked out again, when next asked for.
+ *   Edits to the rules are picked up the same way.  The chain must outlive
+ *   the instance.
+ *
+ * Return: The instance, or NULL if out of memory.
+ */
+struct HolidayChainInstance *track_deadlines(const struct HolidayChain *chain,
+                                             struct DateTime *trigger);
+struct HolidayChainInstance *holiday_chain_instance_create(
+        struct RuleSet *rules, const struct HolidayChain *chain,
+        struct DateTime *trigger);
+void holiday_chain_instance_release(struct HolidayChainInstance *instance);
+
+/*
+ * Name: holiday_chain_instance_set_trigger, holiday_chain_instance_pin
+ *
+ * Description: Moves a case's trigger date, or holds one deadline to a date
+ *   (e.g., when a hearing is continued), or with a NULL date lets it be
+ *   counted under the template again.  A pinned deadline does not move with
+ *   the trigger date, but the deadlines counted from it move with it.
+ *
+ * Return: The number of deadlines newly marked to be worked out again, or -1
+ *   if there is no such deadline.
+ */
+int holiday_chain_instance_set_trigger(struct HolidayChainInstance *instance,
+                                       struct DateTime *trigger);
+int holiday_chain_instance_pin(struct HolidayChainInstance *instance,
+                               int deadline, struct DateTime *dt);
+
+/*
+ * Name: holiday_chain_instance_deadline
+ *
+ * Description: A deadline of the case, worked out first if it is out of date
+ *   (along with any out-of-date deadlines it counts from, and nothing else).
+ *
+ * Return: Its JDN, or -1 if it falls outside 1753 - 9999 or there is no such
+ *   deadline.
+ */
+int holiday_chain_instance_deadline(struct HolidayChainInstance *instance,
+                                    int deadline);
+
+/*
+ * Name: holiday_chain_instance_changes
+ *
+ * Description: Brings every deadline of the case up to date and lists those
+ *   whose dates differ from when they were last listed (or from when the
+ *   instance was set up), e.g., to notify the parties of just those.
+ *   Deadlines that were marked but came out the same are not listed.
+ *
+ * Return: The number of deadlines that changed, which may exceed maxchanged;
+ *   those that did not fit are listed by the next call.
+ */
+int holiday_chain_instance_changes(struct HolidayChainInstance *instance,
+                                   int changed[], int maxchanged);
+
+/*-----------------------------------------------------------------------------
+ * Court-Day Offset Searches
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Name: offset_fanout, holiday_ruleset_offset_fanout
+ *
+ * Description: Counts many offsets from one date at once, e.g., the 10, 15,
+ *   20, 30 and 60 court days after service of a complaint, under the active
+ *   rules or the given rule set.  Court-day offsets take a single sweep
+ *   forward (and one backward, for negative offsets) through the court-day
+ *   index: the start is ranked once, and each answer is selected from the
+ *   year it falls in, so the days between are never walked again.
+ *
+ * Parameters: The start date; how the offsets are counted (a CHAINSTEP, e.g.,
+ *   STEP_COURTDAYS as courtday_offset() counts, or STEP_ROLLFORWARD for
+ *   calendar days moved on to a court day); the offsets, sorted from lowest
+ *   to highest; and one result per offset.
+ *
+ * Return: 0, or -1 if the offsets are not sorted, the step is not a
+ *   CHAINSTEP, or any result falls outside 1753 - 9999 (its jdn is -1).
+ */
+int offset_fanout(struct DateTime *orig_date, int step, const int offsets[],
+                  int count, struct DateTime results[]);
+int holiday_ruleset_offset_fanout(struct RuleSet *rules,
+                                  struct DateTime *orig_date, int step,
+                                  const int offsets[], int count,
+                                  struct DateTime results[]);
+
+/*
+ * Name: latest_courtday_start, earliest_courtday_start, and
+ *   holiday_ruleset_latest_courtday_start,
+ *   holiday_ruleset_earliest_courtday_start
+ *
+ * Description: Undoes courtday_offset(): finds the latest date from which
+ *   numdays court days land on or before target, or the earliest from which
+ *   they land on or after it, under the active rules or the given rule set.
+ *   Several start dates can give the same answer (e.g., every day of a
+ *   weekend); these return the last or the first of them.  Each is a scan to
+ *   the nearest court day and a rank and select in the court-day index.
+ *
+ * Return: 0, or -1 if there is no such date within 1753 - 9999.
+ */
+int latest_courtday_start(struct DateTime *target, int numdays,
+                          struct DateTime *result);
+int earliest_courtday_start(struct DateTime *target, int numdays,
+                            struct DateTime *result);
+int holiday_ruleset_latest_courtday_start(struct RuleSet *rules,
+                                          struct DateTime *target,
+                                          int numdays,
+                                          struct DateTime *result);
+int holiday_ruleset_earliest_courtday_start(struct RuleSet *rules,
+                                            struct DateTime *target,
+                                            int numdays,
+                                            struct DateTime *result);
+
+/*
+ * Name: tolled_date_offset, tolled_courtday_offset, and
+ *   holiday_ruleset_tolled_courtday_offset
+ *
+ * Description: date_offset() and courtday_offset() with the clock stopped
+ *   during the tolled periods: a tolled day is never counted, just as a
+ *   holiday is not counted in court days, so the count resumes the day after
+ *   each period ends.  The periods are closed in a copy of each year's
+ *   calendar, a machine word of days at a time, and the count is then a rank
+ *   and a select in that year's court-day index.  The periods may overlap and
+ *   need not be sorted.
+ *
+ * Return: 0, or -1 if the result is not within 1753 - 9999.
+ */
+int tolled_date_offset(struct DateTime *orig_date, struct DateTime *calc_date,
+                       int numdays,
+                       const struct HolidayTolledPeriod tolled[],
+                       int numtolled);
+int tolled_courtday_offset(struct DateTime *orig_date,
+                           struct DateTime *calc_date, int numdays,
+                           const struct HolidayTolledPeriod tolled[],
+                           int numtolled);
+int holiday_ruleset_tolled_courtday_offset(struct RuleSet *rules,
+        struct DateTime *orig_date, struct DateTime *calc_date, int numdays,
+        const struct HolidayTolledPeriod tolled[], int numtolled);
+
 /*-----------------------------------------------------------------------------
  * DATE COMPUTATIONS
  *----------------------------------------------------------------------------*/
@@ -302,6 +1231,89 @@ int islastweek(struct DateTime *dt);
 
 int isholiday(struct DateTime *dt) ;/* search holiday rules function */
 
+/*
+ * Name: holiday_explain
+ *
+ * Description: Says why a date is closed: the name and authority of the
+ *   holiday rule that closes it.  Each year asked about is indexed once (the
+ *   rule closing each day, by a one-byte ID), so after that an explanation
+ *   is a single array read.  The strings stay valid for the life of the
+ *   process, even after the rules are reloaded.
+ *
+ * Return: 1 if the date is closed, 0 if it is a court day (with empty
+ *   strings), or -1 if it is not a valid date.
+ */
+int holiday_explain(struct DateTime *dt, struct HolidayExplanation *why);
+
+/*
+ * Name: next_courtday, prev_courtday, nearest_courtday
+ *
+ * Description: Rolls a date to a court day: the date itself if it is one,
+ *   otherwise the first court day after it, the last one before it, or
+ *   whichever of those is closer (the later on a tie).  The compiled
+ *   calendars are scanned a word at a time, across year ends as needed, so
+ *   a long run of holidays costs little more than none.
+ *
+ * Parameters: The date and a DateTime struct for the court day, which may be
+ *   the same struct.
+ *
+ * Return: 0, or -1 if there is no court day within 1753 - 9999.
+ */
+int next_courtday(struct DateTime *dt, struct DateTime *result);
+int prev_courtday(struct DateTime *dt, struct DateTime *result);
+int nearest_courtday(struct DateTime *dt, struct DateTime *result);
+
+/*
+ * Name: nth_courtday_in_period
+ *
+ * Description: Finds the nth court day of a month, quarter or year, e.g.,
+ *   the third court day of each month for a law-and-motion calendar.  The
+ *   day is selected from the compiled calendar's court-day index with a
+ *   binary search and a scan of one word.
+ *
+ * Parameters: The year; PERIOD_MONTH, PERIOD_QUARTER or PERIOD_YEAR; the
+ *   month (1 - 12) or quarter (1 - 4), ignored for a year; n, counting from
+ *   1, or from -1 for the last court day backward; and a DateTime struct for
+ *   the court day.
+ *
+ * Return: 0, or -1 if the period has fewer than n court days or is not
+ *   valid.
+ */
+int nth_courtday_in_period(int year, int periodkind, int period, int n,
+                           struct DateTime *result);
+
+/*
+ * Name: courtday_ordinal
+ *
+ * Description: Says which court day of its month, quarter or year a date is,
+ *   from the court-day index.
+ *
+ * Return: The ordinal, counting from 1; 0 if the date is not a court day; -1
+ *   if the date or period is not valid.
+ */
+int courtday_ordinal(struct DateTime *dt, int periodkind);
+
+/*
+ * Name: holiday_enumerate_begin, enumerate_days
+ *
+ * Description: Lists every court day (or with ENUM_HOLIDAYS every holiday and
+ *   weekend) from first through last, inclusive, e.g., the hearing dates
+ *   open in a quarter.  holiday_enumerate_begin() sets up the cursor, and
+ *   each call to enumerate_days() fills the buffer with the next dates, as
+ *   JDNs or with ENUM_PACKED as YYYYMMDD, picking up where the last call
+ *   stopped.  The dates are read from the compiled calendars a word at a time
+ *   with popcount and bit scans, and nothing is allocated.
+ *
+ * Usage: Call enumerate_days() until it returns 0.
+ *
+ * Return: The number of dates written, at most maxdates.
+ */
+void holiday_enumerate_begin(struct HolidayEnumeration *cursor,
+                             struct DateTime *first, struct DateTime *last,
+                             int flags);
+int enumerate_days(struct HolidayEnumeration *cursor, int dates[],
+                   int maxdates);
+
 /*-----------------------------------------------------------------------------
  * Output Functions
  *----------------------------------------------------------------------------*/
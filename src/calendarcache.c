@@ -0,0 +1,972 @@
+/*
+ * Filename: calendarcache.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 09:12:40
+ * Last Modified: Mon Oct 19 09:12:40 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Compiles the holiday rules into per-year bitmaps and keeps a bounded
+ * cache of them for each rule set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+/*-----------------------------------------------------------------------------
+ * Compiled Year Calendars
+ *----------------------------------------------------------------------------*/
+
+/* Days before the first of each month.  Row 1 is for leap years. */
+static const int daysbeforemonth[2][13] = {
+    {0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334},
+    {0, 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335}
+};
+
+/*
+ * Description: Returns the day of the year (January 1 = 0) for a date, or -1
+ * if the month or day is not on the calendar.
+ */
+
+int calendar_dayofyear(int year, int month, int day)
+{
+    int leap;
+
+    leap = (year%4 == 0 && (year%100 != 0 || year%400 == 0));
+    if (month < JANUARY || month > DECEMBER)
+        return -1;
+    if (day < 1 || day > daysinmonths[leap][month])
+        return -1;
+    return daysbeforemonth[leap][month] + day - 1;
+}
+
+int calendar_testday(const struct YearCalendar *cal, int dayofyear)
+{
+    return (int) ((cal->closed[dayofyear / CAL_WORDBITS] >>
+                   (dayofyear % CAL_WORDBITS)) & 1UL);
+}
+
+/* Counts the court days of a year before a day of the year (0 - numdays) */
+int calendar_courtdays_before(const struct YearCalendar *cal, int dayofyear)
+{
+    int word = dayofyear / CAL_WORDBITS;
+    int bits = dayofyear % CAL_WORDBITS;
+
+    if (bits == 0)
+        return cal->rank[word];
+    return cal->rank[word] +
+        __builtin_popcountl(~cal->closed[word] & ((1UL << bits) - 1));
+}
+
+/*
+ * Description: Counts the court days in each month of a compiled year, two
+ * lookups in the court-day index per month.  courtdays[0] is left alone.
+ */
+
+void calendar_month_courtdays(const struct YearCalendar *cal,
+                              int courtdays[TTLMONTHS])
+{
+    int leap;
+    int month;
+    int before;
+    int upto;
+
+    leap = cal->numdays == 366;
+    before = 0;
+    for (month = JANUARY; month <= DECEMBER; month++) {
+        upto = calendar_courtdays_before(cal, month == DECEMBER ?
+                                         cal->numdays :
+                                         daysbeforemonth[leap][month + 1]);
+        courtdays[month] = upto - before;
+        before = upto;
+    }
+    return;
+}
+
+/*
+ * Description: Returns a word of the calendar with a bit set for each court
+ * day.  Bits past the end of the year are never set in the bitmap, so they
+ * are masked off to keep them from being taken for court days.
+ */
+
+static unsigned long calendar_openword(const struct YearCalendar *cal,
+                                       int word)
+{
+    unsigned long open;
+    int bits;
+
+    bits = cal->numdays - word * CAL_WORDBITS;
+    if (bits <= 0)
+        return 0;
+    open = ~cal->closed[word];
+    if (bits < CAL_WORDBITS)
+        open &= (1UL << bits) - 1;
+    return open;
+}
+
+/*
+ * Description: Finds the first court day of a year on or after a day of the
+ * year, a word at a time.
+ *
+ * Return: Its day of the year, or -1 if the rest of the year is closed.
+ */
+
+int calendar_next_open(const struct YearCalendar *cal, int dayofyear)
+{
+    unsigned long open;
+    int word;
+
+    if (dayofyear < 0)
+        dayofyear = 0;
+    if (dayofyear >= cal->numdays)
+        return -1;
+    word = dayofyear / CAL_WORDBITS;
+    open = calendar_openword(cal, word) & (~0UL << (dayofyear % CAL_WORDBITS));
+    while (open == 0) {
+        if (++word >= (int) CAL_WORDS)
+            return -1;
+        open = calendar_openword(cal, word);
+    }
+    return word * CAL_WORDBITS + __builtin_ctzl(open);
+}
+
+/* The last court day of a year on or before a day of the year, or -1 */
+int calendar_prev_open(const struct YearCalendar *cal, int dayofyear)
+{
+    unsigned long open;
+    int word;
+    int bits;
+
+    if (dayofyear < 0)
+        return -1;
+    if (dayofyear >= cal->numdays)
+        dayofyear = cal->numdays - 1;
+    word = dayofyear / CAL_WORDBITS;
+    bits = dayofyear % CAL_WORDBITS + 1; /* days of the word to look at */
+    open = calendar_openword(cal, word);
+    if (bits < CAL_WORDBITS)
+        open &= (1UL << bits) - 1;
+    while (open == 0) {
+        if (--word < 0)
+            return -1;
+        open = calendar_openword(cal, word);
+    }
+    return word * CAL_WORDBITS + CAL_WORDBITS - 1 - __builtin_clzl(open);
+}
+
+/* A day of a calendar as a JDN, or as YYYYMMDD with ENUM_PACKED */
+static int calendar_datevalue(const struct YearCalendar *cal, int dayofyear,
+                              int flags)
+{
+    int leap;
+    int month;
+
+    if (!(flags & ENUM_PACKED))
+        return cal->jdn + dayofyear;
+    leap = cal->numdays == 366;
+    for (month = DECEMBER; daysbeforemonth[leap][month] > dayofyear; month--)
+        ;
+    return cal->year * 10000 + month * 100 +
+        dayofyear - daysbeforemonth[leap][month] + 1;
+}
+
+/*
+ * Description: Lists the court days (or with ENUM_HOLIDAYS the closed days)
+ * of a year from firstdoy through lastdoy, until maxdates are listed.  A
+ * word whose popcount shows it fits is emptied with a bit scan; a word that
+ * does not is taken as far as it fits.
+ *
+ * Return: The number of dates listed.  *nextdoy is set to the first day not
+ * yet looked at.
+ */
+
+int calendar_enumerate(const struct YearCalendar *cal, int firstdoy,
+                       int lastdoy, int flags, int dates[], int maxdates,
+                       int *nextdoy)
+{
+    unsigned long bits;
+    int count = 0;
+    int firstword;
+    int lastword;
+    int word;
+
+    firstword = firstdoy / CAL_WORDBITS;
+    lastword = lastdoy / CAL_WORDBITS;
+    for (word = firstword; word <= lastword; word++) {
+        bits = flags & ENUM_HOLIDAYS ? cal->closed[word] :
+            calendar_openword(cal, word);
+        if (word == firstword)
+            bits &= ~0UL << (firstdoy % CAL_WORDBITS);
+        if (word == lastword && lastdoy % CAL_WORDBITS < CAL_WORDBITS - 1)
+            bits &= (1UL << (lastdoy % CAL_WORDBITS + 1)) - 1;
+
+        if (__builtin_popcountl(bits) > maxdates - count) {
+            while (count < maxdates) {
+                dates[count++] = calendar_datevalue(cal, word * CAL_WORDBITS +
+                                                    __builtin_ctzl(bits), flags);
+                bits &= bits - 1;
+            }
+            *nextdoy = word * CAL_WORDBITS + __builtin_ctzl(bits);
+            return count;
+        }
+        while (bits != 0) {
+            dates[count++] = calendar_datevalue(cal, word * CAL_WORDBITS +
+                                                __builtin_ctzl(bits), flags);
+            bits &= bits - 1; /* clear the lowest set bit */
+        }
+    }
+    *nextdoy = lastdoy + 1;
+    return count;
+}
+
+/*
+ * Description: Finds the days of the year a month, quarter or the year spans
+ * (period is ignored for PERIOD_YEAR).
+ *
+ * Return: 0, with the first day and the day after the last; -1 if the period
+ * is not valid.
+ */
+
+int calendar_period_bounds(const struct YearCalendar *cal, int periodkind,
+                           int period, int *firstdoy, int *enddoy)
+{
+    int leap = cal->numdays == 366;
+    int firstmonth;
+    int nummonths;
+
+    switch (periodkind) {
+        case PERIOD_MONTH:
+            firstmonth = period;
+            nummonths = 1;
+            break;
+        case PERIOD_QUARTER:
+            firstmonth = (period - 1) * 3 + 1;
+            nummonths = 3;
+            break;
+        case PERIOD_YEAR:
+            firstmonth = JANUARY;
+            nummonths = 12;
+            break;
+        default:
+            return -1;
+    }
+    if (firstmonth < JANUARY || firstmonth + nummonths - 1 > DECEMBER)
+        return -1;
+    *firstdoy = daysbeforemonth[leap][firstmonth];
+    *enddoy = firstmonth + nummonths > DECEMBER ? cal->numdays :
+        daysbeforemonth[leap][firstmonth + nummonths];
+    return 0;
+}
+
+/*
+ * Description: Finds the court day of a year with a given number of court
+ * days before it (0 for the first).  The word holding it is found by binary
+ * search of the court-day index, and the day within the word by clearing the
+ * word's lower court days.
+ *
+ * Return: Its day of the year, or -1 if the year has too few court days.
+ */
+
+int calendar_select_open(const struct YearCalendar *cal, int courtdays)
+{
+    unsigned long open;
+    int low = 0;
+    int high = (int) CAL_WORDS - 1;
+    int mid;
+
+    if (courtdays < 0 || courtdays >= cal->courtdays)
+        return -1;
+    while (low < high) { /* the last word with rank <= courtdays */
+        mid = (low + high + 1) / 2;
+        if (cal->rank[mid] <= courtdays)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    open = calendar_openword(cal, low);
+    for (courtdays -= cal->rank[low]; courtdays > 0; courtdays--)
+        open &= open - 1;
+    return low * CAL_WORDBITS + __builtin_ctzl(open);
+}
+
+/*
+ * Description: Closes the days firstdoy through lastdoy of a calendar (e.g.,
+ * days a deadline is tolled), a word-wide mask at a time.  The court-day
+ * index must be recounted afterward.
+ */
+
+void calendar_close_days(struct YearCalendar *cal, int firstdoy, int lastdoy)
+{
+    int word;
+    int low;
+    int high;
+
+    for (word = firstdoy / CAL_WORDBITS; word <= lastdoy / CAL_WORDBITS;
+            word++) {
+        low = word == firstdoy / CAL_WORDBITS ? firstdoy % CAL_WORDBITS : 0;
+        high = word == lastdoy / CAL_WORDBITS ? lastdoy % CAL_WORDBITS :
+            CAL_WORDBITS - 1;
+        cal->closed[word] |= (~0UL >> (CAL_WORDBITS - 1 - high)) &
+            (~0UL << low);
+    }
+    return;
+}
+
+/*
+ * Description: Fills in the court-day index of a calendar: the running count
+ * of court days before each bitmap word and the total for the year.
+ */
+
+void calendar_rank(struct YearCalendar *cal)
+{
+    int word;
+    int count = 0;
+
+    for (word = 0; word < (int) CAL_WORDS; word++) {
+        cal->rank[word] = (unsigned short) count;
+        count += __builtin_popcountl(calendar_openword(cal, word));
+    }
+    cal->courtdays = count;
+    return;
+}
+
+/*
+ * Description: Compiles the holiday rules for one year into a calendar.
+ *
+ * Algorithm: Walks each day of the year once, carrying the day of the week
+ * forward rather than deriving it for every date, and sets the bit for each
+ * day on which a rule applies.  The rules' statistics are tallied locally and
+ * added to the rules once, at the end.
+ */
+
+void calendar_build(struct YearCalendar *cal, int year,
+                    struct HolidayNode *holidayhashtable[])
+{
+    struct RuleTally tally;
+    struct DateTime dt;
+    int leap;
+    int doy = 0;
+    int wkday;
+
+    memset(cal, 0, sizeof(*cal));
+    memset(&tally, 0, sizeof(tally));
+    leap = (year%4 == 0 && (year%100 != 0 || year%400 == 0));
+    cal->year = year;
+    cal->numdays = 365 + leap;
+
+    dt.year = year;
+    dt.month = JANUARY;
+    dt.day = 1;
+    cal->jdn = jdncnvrt(&dt);
+    wkday = derive_weekday(&dt);
+
+    for (dt.month = JANUARY; dt.month <= DECEMBER; dt.month++) {
+        for (dt.day = 1; dt.day <= daysinmonths[leap][dt.month]; dt.day++) {
+            dt.day_of_week = (enum DAYS) wkday;
+            if (holiday_tbl_evaluate_tallied(&dt, holidayhashtable, &tally))
+                cal->closed[doy / CAL_WORDBITS] |= 1UL << (doy % CAL_WORDBITS);
+            doy++;
+            wkday = (wkday + 1) % WEEKDAYS;
+        }
+    }
+    holiday_tally_fold(&tally, holidayhashtable);
+    calendar_rank(cal);
+    return;
+}
+
+/*
+ * Description: Brings a compiled year up to date after a rule has been added
+ * to or removed from the rules it was compiled from.  Only the months the
+ * rule applies to are visited, only the days the rule matches are evaluated
+ * again (against the rules as they now stand), and the court-day index is
+ * adjusted from the first changed word onward rather than recounted.
+ *
+ * Return: The number of days whose status changed.
+ */
+
+static int calendar_patch(struct YearCalendar *cal,
+                          struct HolidayNode *holidayhashtable[],
+                          const struct HolidayRule *rule)
+{
+    struct RuleTally tally;
+    struct DateTime dt;
+    int change[CAL_WORDS]; /* net change in court days within each word */
+    int firstword = (int) CAL_WORDS;
+    int changed = 0;
+    int lastmonth;
+    int slot;
+    int running;
+    int closed;
+    int leap;
+    int word;
+    int doy;
+
+    memset(change, 0, sizeof(change));
+    memset(&tally, 0, sizeof(tally));
+    leap = cal->numdays == 366;
+    dt.year = cal->year;
+    slot = holiday_rule_slot(rule);
+    dt.month = slot == ALLMONTHS ? JANUARY : slot;
+    lastmonth = slot == ALLMONTHS ? DECEMBER : slot;
+    for (; dt.month <= lastmonth; dt.month++) {
+        dt.day = 1;
+        dt.day_of_week = (enum DAYS) derive_weekday(&dt);
+        doy = daysbeforemonth[leap][dt.month];
+        for (; dt.day <= daysinmonths[leap][dt.month]; dt.day++, doy++) {
+            if (holiday_rule_matches(&dt, rule)) {
+                closed = holiday_tbl_evaluate_tallied(&dt, holidayhashtable,
+                                                      &tally);
+                if (closed != calendar_testday(cal, doy)) {
+                    word = doy / CAL_WORDBITS;
+                    cal->closed[word] ^= 1UL << (doy % CAL_WORDBITS);
+                    change[word] += closed ? -1 : 1;
+                    if (word < firstword)
+                        firstword = word;
+                    changed++;
+                }
+            }
+            dt.day_of_week = (enum DAYS) ((dt.day_of_week + 1) % WEEKDAYS);
+        }
+    }
+
+    /* rank[word] counts the days before the word, so it takes the changes
+     * of every earlier word */
+    running = 0;
+    for (word = firstword; word < (int) CAL_WORDS; word++) {
+        cal->rank[word] = (unsigned short) (cal->rank[word] + running);
+        running += change[word];
+    }
+    cal->courtdays += running;
+    holiday_tally_fold(&tally, holidayhashtable);
+    return changed;
+}
+
+/*-----------------------------------------------------------------------------
+ * Per-Thread Hot Years
+ *----------------------------------------------------------------------------*/
+
+struct HotYear {
+    struct CalendarCache *cache; /* the cache this copy came from, or NULL */
+    unsigned long generation; /* the cache's generation at the time */
+    unsigned long hits; /* hits not yet added to cache->hits */
+    struct YearCalendar cal;
+};
+
+static THREAD_LOCAL struct HotYear hotyears[CAL_HOTYEARS];
+static THREAD_LOCAL int hotnext; /* next entry to reuse */
+
+static unsigned long calendar_generation; /* last generation handed out */
+static int hotyears_enabled = 1;
+
+/*
+ * Description: Looks for a year among this thread's copies.  Only plain loads
+ * and thread-local stores are made, so threads hitting the same year do not
+ * contend for any cache line, except that every CAL_HOTFOLD hits on a copy
+ * are added to the shared count with one atomic add.
+ */
+
+static const struct YearCalendar *hotyear_find(struct CalendarCache *cache,
+                                               unsigned long generation,
+                                               int year)
+{
+    struct HotYear *hot;
+    int idx;
+
+    for (idx = 0; idx < CAL_HOTYEARS; idx++) {
+        hot = &hotyears[idx];
+        if (hot->cache == cache && hot->cal.year == year &&
+                hot->generation == generation) {
+            if (++hot->hits >= CAL_HOTFOLD) {
+                ATOMIC_ADD(&cache->hits, hot->hits);
+                hot->hits = 0;
+            }
+            return &hot->cal;
+        }
+    }
+    return NULL;
+}
+
+/* Adds this thread's tally of hits on copies from cache to the shared count */
+static void hotyear_fold(struct CalendarCache *cache)
+{
+    unsigned long pending = 0;
+    int idx;
+
+    for (idx = 0; idx < CAL_HOTYEARS; idx++) {
+        if (hotyears[idx].cache == cache) {
+            pending += hotyears[idx].hits;
+            hotyears[idx].hits = 0;
+        }
+    }
+    if (pending > 0)
+        ATOMIC_ADD(&cache->hits, pending);
+    return;
+}
+
+/*
+ * Description: Picks the entry to hold a year about to be fetched from the
+ * shared cache: an unused or outdated entry if there is one, otherwise the
+ * entries are reused in turn.  The entry is marked unused until it is filled.
+ */
+
+static struct HotYear *hotyear_claim(struct CalendarCache *cache,
+                                     unsigned long generation)
+{
+    struct HotYear *hot;
+    int idx;
+
+    hotyear_fold(cache);
+    for (idx = 0; idx < CAL_HOTYEARS; idx++) {
+        hot = &hotyears[idx];
+        if (hot->cache == NULL ||
+                (hot->cache == cache && hot->generation != generation))
+            break;
+    }
+    if (idx == CAL_HOTYEARS) {
+        hot = &hotyears[hotnext];
+        hotnext = (hotnext + 1) % CAL_HOTYEARS;
+    }
+    hot->cache = NULL; /* any hits still tallied for another cache are lost */
+    hot->hits = 0;
+    return hot;
+}
+
+/*-----------------------------------------------------------------------------
+ * Calendar Cache
+ *----------------------------------------------------------------------------*/
+
+/* Gives the cache a generation no thread has a copy of. */
+static void calendar_cache_newgeneration(struct CalendarCache *cache)
+{
+    ATOMIC_STORE_RELAXED(&cache->generation,
+                         ATOMIC_ADD(&calendar_generation, 1UL) + 1UL);
+    return;
+}
+
+void calendar_cache_init(struct CalendarCache *cache, size_t budget)
+{
+    if (!cache->initialized) {
+        pthread_mutex_init(&cache->lock, NULL);
+        cache->initialized = 1;
+    }
+    calendar_cache_newgeneration(cache);
+    cache->slots = NULL;
+    cache->yearindex = NULL;
+    cache->budget = budget;
+    cache->numslots = (int) (budget / sizeof(struct CalendarSlot));
+    if (cache->numslots > CAL_NUMYEARS)
+        cache->numslots = CAL_NUMYEARS; /* every year fits; no need for more */
+    cache->inuse = 0;
+    cache->hand = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    return;
+}
+
+/*
+ * Description: Discards every cached calendar, e.g., after the rules change.
+ * The slots themselves are kept for reuse.
+ *
+ * Notes: Must not run while other threads are querying the rule set.
+ */
+
+void calendar_cache_flush(struct CalendarCache *cache)
+{
+    int idx;
+
+    if (cache->yearindex != NULL) {
+        for (idx = 0; idx < CAL_NUMYEARS; idx++)
+            cache->yearindex[idx] = -1;
+    }
+    cache->inuse = 0;
+    cache->hand = 0;
+    calendar_cache_newgeneration(cache);
+    return;
+}
+
+void calendar_cache_release(struct CalendarCache *cache)
+{
+    free(cache->slots);
+    free(cache->yearindex);
+    cache->slots = NULL;
+    cache->yearindex = NULL;
+    cache->inuse = 0;
+    cache->hand = 0;
+    return;
+}
+
+/*
+ * Description: Lock-free lookup of a cached year.
+ *
+ * Return: 1 and a copy of the calendar in cal on a hit; 0 on a miss or if a
+ * writer was rewriting the slot at the time (the caller then takes the slow
+ * path, which waits on the lock).
+ */
+
+static int calendar_cache_read(struct CalendarCache *cache, int year,
+                               struct YearCalendar *cal)
+{
+    struct CalendarSlot *slot;
+    short *yearindex;
+    short slotnum;
+    unsigned long seq;
+
+    yearindex = ATOMIC_LOAD(&cache->yearindex);
+    if (yearindex == NULL)
+        return 0;
+    slotnum = ATOMIC_LOAD(&yearindex[year - CAL_MINYEAR]);
+    if (slotnum < 0)
+        return 0;
+    slot = &cache->slots[slotnum];
+
+    seq = ATOMIC_LOAD(&slot->seq);
+    if (seq & 1UL)
+        return 0;
+    memcpy(cal, &slot->cal, sizeof(*cal));
+    ATOMIC_FENCE_ACQUIRE();
+    if (ATOMIC_LOAD_RELAXED(&slot->seq) != seq || cal->year != year)
+        return 0; /* slot was reused while we copied it */
+
+    if (ATOMIC_LOAD_RELAXED(&slot->referenced) == 0)
+        ATOMIC_STORE_RELAXED(&slot->referenced, 1);
+    return 1;
+}
+
+/*
+ * Description: Installs a freshly built calendar, evicting with the CLOCK
+ * algorithm once every slot is in use.  Caller holds cache->lock.
+ */
+
+static void calendar_cache_install(struct CalendarCache *cache,
+                                   const struct YearCalendar *cal)
+{
+    struct CalendarSlot *slot;
+    int victim;
+
+    if (cache->inuse < cache->numslots) {
+        victim = cache->inuse++;
+    } else {
+        /* sweep, giving each recently used slot a second chance */
+        while (ATOMIC_LOAD_RELAXED(&cache->slots[cache->hand].referenced)) {
+            ATOMIC_STORE_RELAXED(&cache->slots[cache->hand].referenced, 0);
+            cache->hand = (cache->hand + 1) % cache->numslots;
+        }
+        victim = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->numslots;
+        ATOMIC_STORE(&cache->yearindex[cache->slots[victim].cal.year -
+                     CAL_MINYEAR], (short) -1);
+        ATOMIC_ADD(&cache->evictions, 1UL);
+    }
+
+    slot = &cache->slots[victim];
+    ATOMIC_STORE_RELAXED(&slot->seq, slot->seq + 1); /* odd: rewriting */
+    ATOMIC_FENCE_RELEASE();
+    memcpy(&slot->cal, cal, sizeof(*cal));
+    slot->referenced = 1;
+    ATOMIC_STORE(&slot->seq, slot->seq + 1); /* even: stable again */
+    ATOMIC_STORE(&cache->yearindex[cal->year - CAL_MINYEAR], (short) victim);
+    return;
+}
+
+/*
+ * Description: Returns the compiled calendar for a year, building and caching
+ * it on a miss.
+ *
+ * Parameters: The rule set, the year, and scratch storage the calendar can be
+ * copied into.
+ *
+ * Return: A pointer to the calendar, which is either scratch, a year in the
+ * mapped on-disk store, or one of this thread's copies, or NULL if the year is
+ * outside the compiled range or the rule set has no cache budget.  The pointer
+ * is good until this thread's next call.
+ */
+
+const struct YearCalendar *calendar_cache_get(struct RuleSet *rules, int year,
+                                              struct YearCalendar *scratch)
+{
+    struct CalendarCache *cache;
+    const struct YearCalendar *cal;
+    struct HotYear *hot = NULL;
+    unsigned long generation;
+
+    if (year < CAL_MINYEAR || year > CAL_MAXYEAR)
+        return NULL;
+    if (rules->calendars != NULL)
+        rules = rules->calendars; /* identical rules loaded elsewhere */
+    cache = &rules->cache;
+
+    generation = ATOMIC_LOAD_RELAXED(&cache->generation);
+    if (ATOMIC_LOAD_RELAXED(&hotyears_enabled)) {
+        cal = hotyear_find(cache, generation, year);
+        if (cal != NULL)
+            return cal;
+    }
+
+    if (rules->store.years != NULL && year >= rules->store.firstyear &&
+            year <= rules->store.lastyear) {
+        ATOMIC_ADD(&cache->hits, 1UL);
+        cal = &rules->store.years[year - rules->store.firstyear];
+        if (!ATOMIC_LOAD_RELAXED(&hotyears_enabled))
+            return cal;
+        hot = hotyear_claim(cache, generation);
+        memcpy(&hot->cal, cal, sizeof(*cal));
+        hot->generation = generation;
+        hot->cache = cache;
+        return &hot->cal;
+    }
+
+    if (cache->numslots <= 0)
+        return NULL;
+
+    if (calendar_cache_read(cache, year, scratch)) {
+        ATOMIC_ADD(&cache->hits, 1UL);
+    } else {
+        /* Miss: compile the year without holding the lock. */
+        calendar_compile(rules, scratch, year);
+        ATOMIC_ADD(&cache->misses, 1UL);
+        calendar_cache_put(cache, scratch);
+    }
+
+    /* Claimed only now: compiling a composite looks up its operands, which
+     * may claim entries of their own. */
+    if (!ATOMIC_LOAD_RELAXED(&hotyears_enabled))
+        return scratch;
+    hot = hotyear_claim(cache, generation);
+    memcpy(&hot->cal, scratch, sizeof(*scratch));
+    hot->generation = generation;
+    hot->cache = cache;
+    return &hot->cal;
+}
+
+/*
+ * Description: Adds a compiled year to the cache unless another thread has
+ * already added it.  The slots are allocated on first use.
+ *
+ * Return: 1 if the calendar was installed; 0 otherwise.
+ */
+
+int calendar_cache_put(struct CalendarCache *cache,
+                       const struct YearCalendar *cal)
+{
+    short *yearindex;
+    int idx;
+    int installed = 0;
+
+    if (cache->numslots <= 0)
+        return 0;
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->yearindex == NULL) {
+        yearindex = malloc(CAL_NUMYEARS * sizeof(short));
+        cache->slots = calloc((size_t) cache->numslots,
+                              sizeof(struct CalendarSlot));
+        if (cache->slots == NULL || yearindex == NULL) {
+            free(yearindex);
+            calendar_cache_release(cache);
+            pthread_mutex_unlock(&cache->lock);
+            return 0;
+        }
+        for (idx = 0; idx < CAL_NUMYEARS; idx++)
+            yearindex[idx] = -1;
+        ATOMIC_STORE(&cache->yearindex, yearindex); /* publish to readers */
+    }
+    if (cache->yearindex[cal->year - CAL_MINYEAR] < 0) {
+        calendar_cache_install(cache, cal); /* nobody beat us to it */
+        installed = 1;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return installed;
+}
+
+/*
+ * Description: Patches every cached year of a rule set after a rule has been
+ * added to or removed from its table, using calendar_patch().  Each slot is
+ * rewritten under its sequence number, as in calendar_cache_install(), and
+ * the cache takes a new generation so no thread keeps an outdated copy.
+ *
+ * Return: The number of cached years that changed.
+ */
+
+int calendar_cache_patch(struct CalendarCache *cache,
+                         struct HolidayNode *holidayhashtable[],
+                         const struct HolidayRule *rule)
+{
+    struct CalendarSlot *slot;
+    struct YearCalendar cal;
+    int changed = 0;
+    int idx;
+
+    pthread_mutex_lock(&cache->lock);
+    for (idx = 0; idx < cache->inuse; idx++) {
+        slot = &cache->slots[idx];
+        memcpy(&cal, &slot->cal, sizeof(cal));
+        if (calendar_patch(&cal, holidayhashtable, rule) == 0)
+            continue;
+        ATOMIC_STORE_RELAXED(&slot->seq, slot->seq + 1); /* odd: rewriting */
+        ATOMIC_FENCE_RELEASE();
+        memcpy(&slot->cal, &cal, sizeof(cal));
+        ATOMIC_STORE(&slot->seq, slot->seq + 1); /* even: stable again */
+        changed++;
+    }
+    calendar_cache_newgeneration(cache); /* the rules changed, cached or not */
+    pthread_mutex_unlock(&cache->lock);
+
+    return changed;
+}
+
+/*
+ * Description: Compiles every cached year of a composite again, after one of
+ * its operands has changed.  Each year costs two lookups in the operands'
+ * caches and a pass over the bitmap words.
+ */
+
+void calendar_cache_recompile(struct RuleSet *rules)
+{
+    struct CalendarCache *cache = &rules->cache;
+    struct CalendarSlot *slot;
+    struct YearCalendar cal;
+    int idx;
+
+    for (idx = 0; idx < cache->inuse; idx++) {
+        slot = &cache->slots[idx];
+        /* compiled outside the lock, which the operands' lookups may need */
+        calendar_compile(rules, &cal, slot->cal.year);
+        pthread_mutex_lock(&cache->lock);
+        ATOMIC_STORE_RELAXED(&slot->seq, slot->seq + 1);
+        ATOMIC_FENCE_RELEASE();
+        memcpy(&slot->cal, &cal, sizeof(cal));
+        ATOMIC_STORE(&slot->seq, slot->seq + 1);
+        pthread_mutex_unlock(&cache->lock);
+    }
+    pthread_mutex_lock(&cache->lock);
+    calendar_cache_newgeneration(cache);
+    pthread_mutex_unlock(&cache->lock);
+    return;
+}
+
+/*
+ * Description: Checks, without locking or counting a hit, whether a year is
+ * already compiled, either in the cache or in the mapped store.
+ */
+
+int calendar_cache_holds(struct RuleSet *rules, int year)
+{
+    short *yearindex;
+
+    if (rules->calendars != NULL)
+        rules = rules->calendars;
+    if (rules->store.years != NULL && year >= rules->store.firstyear &&
+            year <= rules->store.lastyear)
+        return 1;
+    yearindex = ATOMIC_LOAD(&rules->cache.yearindex);
+    return yearindex != NULL && ATOMIC_LOAD(&yearindex[year - CAL_MINYEAR]) >= 0;
+}
+
+/* Memory held by the cached calendars and the year index */
+size_t calendar_cache_resident_bytes(struct CalendarCache *cache)
+{
+    size_t bytes;
+
+    bytes = (size_t) cache->inuse * sizeof(struct CalendarSlot);
+    if (cache->yearindex != NULL)
+        bytes += CAL_NUMYEARS * sizeof(short);
+    return bytes;
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Cache Interface
+ *----------------------------------------------------------------------------*/
+
+/* The rule set whose cache holds a rule set's calendars */
+static struct RuleSet *calendar_owner(struct RuleSet *rules)
+{
+    return rules->calendars != NULL ? rules->calendars : rules;
+}
+
+int holiday_ruleset_set_cache_budget(struct RuleSet *rules,
+                                     size_t budget_bytes)
+{
+    struct CalendarCache *cache;
+
+    if (rules == NULL)
+        return -1;
+    cache = &calendar_owner(rules)->cache;
+    if (!cache->initialized) { /* called before any rules were loaded */
+        calendar_cache_init(cache, budget_bytes);
+        return cache->numslots;
+    }
+    pthread_mutex_lock(&cache->lock);
+    calendar_cache_release(cache);
+    calendar_cache_init(cache, budget_bytes);
+    pthread_mutex_unlock(&cache->lock);
+
+    return cache->numslots;
+}
+
+void holiday_ruleset_get_cache_stats(struct RuleSet *rules,
+                                     struct HolidayCacheStats *stats)
+{
+    struct RuleSet *owner = calendar_owner(rules);
+    struct CalendarCache *cache = &owner->cache;
+
+    hotyear_fold(cache); /* this thread's hits, at least, are up to date */
+
+    stats->hits = ATOMIC_LOAD_RELAXED(&cache->hits);
+    stats->misses = ATOMIC_LOAD_RELAXED(&cache->misses);
+    stats->evictions = ATOMIC_LOAD_RELAXED(&cache->evictions);
+    stats->budget_bytes = cache->budget;
+    stats->capacity = cache->numslots;
+    stats->resident = cache->inuse;
+    stats->resident_bytes = calendar_cache_resident_bytes(cache);
+    stats->calendar_bytes = sizeof(struct CalendarSlot);
+    stats->mapped = 0;
+    if (owner->store.years != NULL)
+        stats->mapped = owner->store.lastyear - owner->store.firstyear + 1;
+    return;
+}
+
+void holiday_ruleset_reset_cache_stats(struct RuleSet *rules)
+{
+    struct CalendarCache *cache = &calendar_owner(rules)->cache;
+
+    ATOMIC_STORE_RELAXED(&cache->hits, 0UL);
+    ATOMIC_STORE_RELAXED(&cache->misses, 0UL);
+    ATOMIC_STORE_RELAXED(&cache->evictions, 0UL);
+    return;
+}
+
+int holiday_cache_set_budget(size_t budget_bytes)
+{
+    return holiday_ruleset_set_cache_budget(&activerules_h, budget_bytes);
+}
+
+void holiday_cache_set_threadlocal(int enabled)
+{
+    ATOMIC_STORE_RELAXED(&hotyears_enabled, enabled != 0);
+    return;
+}
+
+void holiday_cache_get_stats(struct HolidayCacheStats *stats)
+{
+    holiday_ruleset_get_cache_stats(&activerules_h, stats);
+    return;
+}
+
+void holiday_cache_reset_stats(void)
+{
+    holiday_ruleset_reset_cache_stats(&activerules_h);
+    return;
+}
@@ -0,0 +1,80 @@
+/*
+ * Filename: calendardiff.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 18:20:37
+ * Last Modified: Mon Oct 19 18:20:37 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Compares the compiled calendars of two rule sets, e.g., a rule file
+ * and the new version about to replace it.
+ */
+
+#include <stdio.h>
+#include "datetimetools_pvt.h"
+
+/* Fills in one differing day, given the year's calendar under before */
+static void diff_record(struct RuleSet *before, struct RuleSet *after,
+                        const struct YearCalendar *cal, int doy,
+                        struct HolidayDiff *diff)
+{
+    jdn2greg(cal->jdn + doy, &diff->date);
+    diff->date.jdn = cal->jdn + doy;
+    set_weekday(&diff->date);
+    diff->before_rule = ruleset_rulename(before, &diff->date);
+    diff->after_rule = ruleset_rulename(after, &diff->date);
+    diff->closed_before = calendar_testday(cal, doy);
+    return;
+}
+
+/*
+ * Description: Lists the days that are closed under one rule set and open
+ * under the other.
+ *
+ * Algorithm: Each year's two calendars are XORed a word at a time; a year
+ * that the rule sets agree on costs CAL_WORDS word operations.  Only the set
+ * bits of the differences are visited, and only they are looked at again to
+ * find the rules responsible.
+ */
+
+int holiday_ruleset_diff(struct RuleSet *before, struct RuleSet *after,
+                         int firstyear, int lastyear,
+                         struct HolidayDiff diffs[], int maxdiffs)
+{
+    struct YearCalendar beforecal;
+    struct YearCalendar aftercal;
+    unsigned long bits;
+    int numdiffs = 0;
+    int year;
+    int word;
+
+    if (before == NULL || after == NULL || firstyear < CAL_MINYEAR ||
+            lastyear > CAL_MAXYEAR || firstyear > lastyear || maxdiffs < 0)
+        return -1;
+
+    for (year = firstyear; year <= lastyear; year++) {
+        ruleset_getyear(before, year, &beforecal);
+        ruleset_getyear(after, year, &aftercal);
+        for (word = 0; word < (int) CAL_WORDS; word++) {
+            bits = beforecal.closed[word] ^ aftercal.closed[word];
+            while (bits != 0) {
+                if (numdiffs < maxdiffs)
+                    diff_record(before, after, &beforecal,
+                                word * CAL_WORDBITS + __builtin_ctzl(bits),
+                                &diffs[numdiffs]);
+                numdiffs++;
+                bits &= bits - 1; /* clear the lowest set bit */
+            }
+        }
+    }
+    return numdiffs;
+}
@@ -0,0 +1,279 @@
+/*
+ * Filename: calendarstore.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 11:02:17
+ * Last Modified: Mon Oct 19 11:02:17 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Restrictions: Uses POSIX file mapping (mmap), so the on-disk store is only
+ * available on Unix-like systems.
+ *
+ * Notes: Persists compiled year calendars to a cache directory so that short
+ * lived processes can map them instead of compiling the rules again.
+ */
+
+#define _POSIX_C_SOURCE 200809L /* mkstemp, fdopen, fsync */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "datetimetools_pvt.h"
+
+#define STOREALIGN 16 /* calendars start on this boundary in the file */
+
+/* The cache directory and the span of years to persist */
+static char storedir[FILENAME_MAX];
+static int storefirstyear;
+static int storelastyear;
+
+/*-----------------------------------------------------------------------------
+ * Store Configuration
+ *----------------------------------------------------------------------------*/
+
+int holiday_cache_set_dir(const char *dirname, int firstyear, int lastyear)
+{
+    if (dirname == NULL) { /* turn the store off */
+        storedir[0] = NULCHAR;
+        return 0;
+    }
+    if (firstyear < CAL_MINYEAR || lastyear > CAL_MAXYEAR ||
+            firstyear > lastyear)
+        return -1;
+    if (strlen(dirname) >= sizeof(storedir))
+        return -1;
+
+    strcpy(storedir, dirname);
+    storefirstyear = firstyear;
+    storelastyear = lastyear;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+ * Store Helpers
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Reads the whole rule file into memory.
+ *
+ * Return: A buffer the caller must free, or NULL.  The file is left at its
+ * end, as it is after the rules have been loaded.
+ */
+
+static char *store_readrules(FILE *holidayrulefile, long *len)
+{
+    char *content;
+
+    holiday_rules_resetfile(holidayrulefile);
+    if (fseek(holidayrulefile, 0L, SEEK_END) != 0)
+        return NULL;
+    *len = ftell(holidayrulefile);
+    holiday_rules_resetfile(holidayrulefile);
+    if (*len <= 0)
+        return NULL;
+
+    content = malloc((size_t) *len);
+    if (content == NULL)
+        return NULL;
+    if (fread(content, 1, (size_t) *len, holidayrulefile) != (size_t) *len) {
+        free(content);
+        return NULL;
+    }
+    return content;
+}
+
+static long store_calendaroffset(long contentlen)
+{
+    long offset;
+
+    offset = (long) sizeof(struct CalendarStoreHeader) + contentlen;
+    return (offset + STOREALIGN - 1) / STOREALIGN * STOREALIGN;
+}
+
+/*
+ * Description: Maps a store file and checks that it was written from the
+ * same rules, by the same library version, for the configured span.
+ *
+ * Return: 1 if the store was mapped into rules->store; 0 otherwise.
+ */
+
+static int store_map(struct CalendarStore *store, const char *path,
+                     const char *content, long contentlen,
+                     unsigned long hash)
+{
+    const struct CalendarStoreHeader *header;
+    struct stat filestat;
+    void *map;
+    size_t need;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &filestat) != 0 ||
+            filestat.st_size < (off_t) sizeof(struct CalendarStoreHeader)) {
+        close(fd);
+        return 0;
+    }
+    map = mmap(NULL, (size_t) filestat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* the mapping stays valid */
+    if (map == MAP_FAILED)
+        return 0;
+
+    header = map;
+    need = (size_t) store_calendaroffset(contentlen) +
+        (size_t) (storelastyear - storefirstyear + 1) *
+        sizeof(struct YearCalendar);
+    if (memcmp(header->magic, STOREMAGIC, sizeof(STOREMAGIC)) != 0 ||
+            strncmp(header->libversion, LIBVERSION,
+                sizeof(header->libversion)) != 0 ||
+            header->contenthash != hash ||
+            header->contentlen != contentlen ||
+            header->firstyear != storefirstyear ||
+            header->lastyear != storelastyear ||
+            header->calendarsize != (int) sizeof(struct YearCalendar) ||
+            header->calendaroffset != store_calendaroffset(contentlen) ||
+            (size_t) filestat.st_size < need ||
+            memcmp(header + 1, content, (size_t) contentlen) != 0) {
+        munmap(map, (size_t) filestat.st_size);
+        return 0;
+    }
+
+    store->map = map;
+    store->maplen = (size_t) filestat.st_size;
+    store->years = (const struct YearCalendar *)
+        ((const char *) map + header->calendaroffset);
+    store->firstyear = header->firstyear;
+    store->lastyear = header->lastyear;
+    return 1;
+}
+
+/*
+ * Description: Compiles the configured span and publishes it as a store file.
+ *
+ * Algorithm: The file is written under a temporary name in the cache
+ * directory and renamed into place once complete, so readers see either no
+ * file or a whole one, and concurrent writers simply replace each other's
+ * identical output.
+ */
+
+static void store_write(struct RuleSet *rules, const char *path,
+                        const char *content, long contentlen,
+                        unsigned long hash)
+{
+    struct CalendarStoreHeader header;
+    struct YearCalendar cal;
+    char tmppath[FILENAME_MAX + 32];
+    char padding[STOREALIGN];
+    FILE *storefile;
+    long padlen;
+    int year;
+    int fd;
+    int ok;
+
+    sprintf(tmppath, "%s/.calendars-%08lx.XXXXXX", storedir, hash);
+    fd = mkstemp(tmppath);
+    if (fd < 0)
+        return;
+    fchmod(fd, 0644); /* mkstemp creates it private to this user */
+    storefile = fdopen(fd, "wb");
+    if (storefile == NULL) {
+        close(fd);
+        unlink(tmppath);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STOREMAGIC, sizeof(STOREMAGIC));
+    strcpy(header.libversion, LIBVERSION);
+    header.contenthash = hash;
+    header.contentlen = contentlen;
+    header.firstyear = storefirstyear;
+    header.lastyear = storelastyear;
+    header.calendarsize = (int) sizeof(struct YearCalendar);
+    header.calendaroffset = store_calendaroffset(contentlen);
+    padlen = header.calendaroffset - (long) sizeof(header) - contentlen;
+    memset(padding, 0, sizeof(padding));
+
+    ok = fwrite(&header, sizeof(header), 1, storefile) == 1 &&
+        fwrite(content, 1, (size_t) contentlen, storefile) ==
+        (size_t) contentlen &&
+        fwrite(padding, 1, (size_t) padlen, storefile) == (size_t) padlen;
+    for (year = storefirstyear; ok && year <= storelastyear; year++) {
+        calendar_compile(rules, &cal, year);
+        ok = fwrite(&cal, sizeof(cal), 1, storefile) == 1;
+    }
+    ok = ok && fflush(storefile) == 0 && fsync(fileno(storefile)) == 0;
+
+    if (fclose(storefile) != 0 || !ok || rename(tmppath, path) != 0)
+        unlink(tmppath);
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+ * Store Management
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Attaches the on-disk store for a freshly loaded rule file,
+ * writing it first if no valid one exists.  Does nothing unless a cache
+ * directory has been set, and any failure just leaves the rules without a
+ * store; the in-memory cache works as before.
+ */
+
+void calendar_store_open(struct RuleSet *rules, FILE *holidayrulefile)
+{
+    char path[FILENAME_MAX + 32];
+    char *content;
+    long contentlen;
+    unsigned long hash;
+    int span[3];
+
+    calendar_store_close(&rules->store);
+    if (storedir[0] == NULCHAR)
+        return;
+
+    content = store_readrules(holidayrulefile, &contentlen);
+    if (content == NULL)
+        return;
+
+    span[0] = storefirstyear;
+    span[1] = storelastyear;
+    span[2] = (int) sizeof(struct YearCalendar);
+    /* only names the file; the contents are verified when mapped */
+    hash = hash_bytes(content, (size_t) contentlen, HASH_INIT);
+    hash = hash_bytes(LIBVERSION, strlen(LIBVERSION), hash);
+    hash = hash_bytes(span, sizeof(span), hash);
+    sprintf(path, "%s/calendars-%08lx.dtc", storedir, hash);
+
+    if (!store_map(&rules->store, path, content, contentlen, hash)) {
+        store_write(rules, path, content, contentlen, hash);
+        store_map(&rules->store, path, content, contentlen, hash);
+    }
+    free(content);
+    return;
+}
+
+void calendar_store_close(struct CalendarStore *store)
+{
+    if (store->map != NULL)
+        munmap(store->map, store->maplen);
+    store->map = NULL;
+    store->maplen = 0;
+    store->years = NULL;
+    return;
+}
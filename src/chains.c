@@ -0,0 +1,949 @@
+/*
+ * Filename: chains.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 20:04:17
+ * Last Modified: Mon Oct 19 20:04:17 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Deadline chains: templates of deadlines that count from a trigger
+ * date or from one another (e.g., "opposition due 9 court days before the
+ * hearing, reply 5 court days before"), worked out in one pass, and across
+ * many cases at once on a work-stealing pool of threads.
+ */
+
+#define _POSIX_C_SOURCE 200809L /* sysconf */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "datetimetools_pvt.h"
+
+#define CHAINCHUNK 64 /* cases a worker takes from its own range at a time */
+
+/* A batch of cases shared out among workers.  Each worker starts with an
+ * equal range of the cases and takes them a chunk at a time from the front;
+ * once its range is empty, it steals the back half of another worker's. */
+
+struct ChainBatch;
+
+struct ChainWorker {
+    pthread_mutex_t lock; /* guards next and end */
+    int next; /* first case not yet taken */
+    int end; /* one past the last case */
+    int self;
+    pthread_t thread;
+    struct ChainBatch *batch;
+    struct HolidayChainWorkerStats stats;
+};
+
+struct ChainBatch {
+    struct RuleSet *rules;
+    const struct HolidayChain *chain;
+    const int *triggerjdns;
+    int *jdns;
+    int numworkers;
+    struct ChainWorker *workers;
+};
+
+/*-----------------------------------------------------------------------------
+ * Chain Helpers
+ *----------------------------------------------------------------------------*/
+
+/* Whether a JDN falls within 1753 - 9999 */
+static int chain_inrange(int jdn)
+{
+    struct DateTime dt;
+
+    jdn2greg(jdn, &dt);
+    return dt.year >= CAL_MINYEAR && dt.year <= CAL_MAXYEAR;
+}
+
+/* Calendar days a step is likely to cover, at most: court days are allowed
+ * two calendar days each, plus a week for a run of holidays */
+static int chain_reach(const struct DeadlineSpec *deadline)
+{
+    int amount = deadline->amount < 0 ? -deadline->amount : deadline->amount;
+
+    if (deadline->step == STEP_COURTDAYS)
+        return 2 * amount + 7;
+    return amount + 7;
+}
+
+/*
+ * Description: Orders a chain's deadlines so that each comes after the one it
+ * counts from: by depth, the number of steps back to the trigger date.  Also
+ * works out how far the chain is likely to reach.
+ *
+ * Return: 0, or -1 if the deadlines form a cycle or out of memory.
+ */
+
+static int chain_sort(struct HolidayChain *chain)
+{
+    int *depth;
+    int maxdepth = 0;
+    int reach;
+    int deadline;
+    int steps;
+    int pos = 0;
+    int idx;
+
+    depth = malloc((size_t) chain->numdeadlines * sizeof(int));
+    if (depth == NULL)
+        return -1;
+    chain->reach = 0;
+    for (idx = 0; idx < chain->numdeadlines; idx++) {
+        steps = 0;
+        reach = chain_reach(&chain->deadlines[idx]);
+        for (deadline = idx; chain->deadlines[deadline].from != CHAINTRIGGER;
+                deadline = chain->deadlines[deadline].from) {
+            if (++steps > chain->numdeadlines) { /* a cycle */
+                free(depth);
+                return -1;
+            }
+            reach += chain_reach(&chain->deadlines[
+                chain->deadlines[deadline].from]);
+        }
+        depth[idx] = steps;
+        if (steps > maxdepth)
+            maxdepth = steps;
+        if (reach > chain->reach)
+            chain->reach = reach;
+    }
+    for (steps = 0; steps <= maxdepth; steps++) {
+        for (idx = 0; idx < chain->numdeadlines; idx++) {
+            if (depth[idx] == steps)
+                chain->order[pos++] = idx;
+        }
+    }
+    free(depth);
+    return 0;
+}
+
+/*
+ * Description: Counts one deadline from the date it depends on.
+ *
+ * Return: The deadline's JDN, or -1 if it (or the date it counts from) is not
+ * within 1753 - 9999.
+ */
+
+int chain_step(struct RuleSet *rules, const struct DeadlineSpec *deadline,
+               int fromjdn)
+{
+    int jdn;
+
+    if (fromjdn < 0)
+        return -1;
+    if (deadline->step == STEP_COURTDAYS)
+        return ruleset_courtday_offset(rules, fromjdn, deadline->amount);
+    jdn = fromjdn + deadline->amount;
+    if (!chain_inrange(jdn))
+        return -1;
+    switch (deadline->step) {
+        case STEP_ROLLFORWARD:
+            return ruleset_scan_courtday(rules, jdn, 1);
+        case STEP_ROLLBACKWARD:
+            return ruleset_scan_courtday(rules, jdn, -1);
+        default: /* STEP_CALENDARDAYS */
+            return jdn;
+    }
+}
+
+/* Works out a chain from a trigger date's JDN */
+static int chain_evaluate(struct RuleSet *rules,
+                          const struct HolidayChain *chain, int triggerjdn,
+                          int jdns[])
+{
+    const struct DeadlineSpec *deadline;
+    int status = 0;
+    int idx;
+
+    if (!chain_inrange(triggerjdn))
+        triggerjdn = -1;
+    for (idx = 0; idx < chain->numdeadlines; idx++) {
+        deadline = &chain->deadlines[chain->order[idx]];
+        jdns[chain->order[idx]] = chain_step(rules, deadline,
+            deadline->from == CHAINTRIGGER ? triggerjdn :
+            jdns[deadline->from]);
+        if (jdns[chain->order[idx]] < 0)
+            status = -1;
+    }
+    return status;
+}
+
+/*
+ * Description: Takes the next chunk of a worker's own cases or, if it has
+ * none left, steals the back half of the first other worker's range that has
+ * any, and takes a chunk of that.
+ *
+ * Return: The number of cases taken (0 once every range is empty), the first
+ * of them in *first.
+ */
+
+static int chain_take(struct ChainWorker *worker, int *first)
+{
+    struct ChainBatch *batch = worker->batch;
+    struct ChainWorker *victim;
+    int count;
+    int half;
+    int stolen;
+    int idx;
+
+    pthread_mutex_lock(&worker->lock);
+    count = worker->end - worker->next < CHAINCHUNK ?
+        worker->end - worker->next : CHAINCHUNK;
+    *first = worker->next;
+    worker->next += count;
+    pthread_mutex_unlock(&worker->lock);
+    if (count > 0)
+        return count;
+
+    for (idx = 1; idx < batch->numworkers; idx++) {
+        victim = &batch->workers[(worker->self + idx) % batch->numworkers];
+        pthread_mutex_lock(&victim->lock);
+        half = (victim->end - victim->next + 1) / 2;
+        victim->end -= half;
+        stolen = victim->end;
+        pthread_mutex_unlock(&victim->lock);
+        if (half == 0)
+            continue;
+
+        worker->stats.steals++;
+        count = half < CHAINCHUNK ? half : CHAINCHUNK;
+        *first = stolen;
+        pthread_mutex_lock(&worker->lock);
+        worker->next = stolen + count;
+        worker->end = stolen + half;
+        pthread_mutex_unlock(&worker->lock);
+        return count;
+    }
+    return 0;
+}
+
+static void *chain_worker(void *arg)
+{
+    struct ChainWorker *worker = arg;
+    struct ChainBatch *batch = worker->batch;
+    int numdeadlines = batch->chain->numdeadlines;
+    int count;
+    int first;
+    int idx;
+
+    while ((count = chain_take(worker, &first)) > 0) {
+        worker->stats.chunks++;
+        worker->stats.cases += count;
+        for (idx = first; idx < first + count; idx++) {
+            if (chain_evaluate(batch->rules, batch->chain,
+                               batch->triggerjdns[idx],
+                               &batch->jdns[(long) idx * numdeadlines]) != 0)
+                worker->stats.failures++;
+        }
+    }
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Chain Interface
+ *----------------------------------------------------------------------------*/
+
+struct HolidayChain *holiday_chain_build(const struct DeadlineSpec deadlines[],
+                                         int numdeadlines)
+{
+    struct HolidayChain *chain;
+    int idx;
+
+    if (numdeadlines < 1)
+        return NULL;
+    for (idx = 0; idx < numdeadlines; idx++) {
+        if (deadlines[idx].from < CHAINTRIGGER ||
+                deadlines[idx].from >= numdeadlines ||
+                deadlines[idx].step < STEP_CALENDARDAYS ||
+                deadlines[idx].step > STEP_ROLLBACKWARD)
+            return NULL;
+    }
+
+    chain = calloc(1, sizeof(*chain));
+    if (chain == NULL)
+        return NULL;
+    chain->numdeadlines = numdeadlines;
+    chain->deadlines = malloc((size_t) numdeadlines * sizeof(deadlines[0]));
+    chain->order = malloc((size_t) numdeadlines * sizeof(int));
+    if (chain->deadlines == NULL || chain->order == NULL) {
+        holiday_chain_release(chain);
+        return NULL;
+    }
+    memcpy(chain->deadlines, deadlines,
+           (size_t) numdeadlines * sizeof(deadlines[0]));
+    for (idx = 0; idx < numdeadlines; idx++) {
+        chain->deadlines[idx].name = stringpool_intern(
+            deadlines[idx].name != NULL ? deadlines[idx].name : "");
+    }
+    if (chain_sort(chain) != 0) {
+        holiday_chain_release(chain);
+        return NULL;
+    }
+    return chain;
+}
+
+void holiday_chain_release(struct HolidayChain *chain)
+{
+    if (chain == NULL)
+        return;
+    free(chain->deadlines);
+    free(chain->order);
+    free(chain);
+    return;
+}
+
+int holiday_ruleset_evaluate_deadlines(struct RuleSet *rules,
+                                       const struct HolidayChain *chain,
+                                       struct DateTime *trigger, int jdns[])
+{
+    return chain_evaluate(rules, chain, jdncnvrt(trigger), jdns);
+}
+
+int holiday_ruleset_evaluate_deadlines_batch(struct RuleSet *rules,
+        const struct HolidayChain *chain, const int triggerjdns[],
+        int numcases, int jdns[], int numthreads,
+        struct HolidayChainWorkerStats stats[])
+{
+    struct ChainBatch batch;
+    int started;
+    int idx;
+
+    if (numcases < 0)
+        return -1;
+    if (numthreads <= 0)
+        numthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (numthreads <= 0)
+        numthreads = 1;
+    if (numthreads > MAXCHAINTHREADS)
+        numthreads = MAXCHAINTHREADS;
+    if (numthreads > numcases / CHAINCHUNK + 1)
+        numthreads = numcases / CHAINCHUNK + 1; /* not worth more */
+
+    batch.rules = rules;
+    batch.chain = chain;
+    batch.triggerjdns = triggerjdns;
+    batch.jdns = jdns;
+    batch.numworkers = numthreads;
+    batch.workers = calloc((size_t) numthreads, sizeof(struct ChainWorker));
+    if (batch.workers == NULL)
+        return -1;
+    for (idx = 0; idx < numthreads; idx++) {
+        pthread_mutex_init(&batch.workers[idx].lock, NULL);
+        batch.workers[idx].next = (int) ((long) numcases * idx / numthreads);
+        batch.workers[idx].end = (int) ((long) numcases * (idx + 1) /
+                                        numthreads);
+        batch.workers[idx].self = idx;
+        batch.workers[idx].batch = &batch;
+    }
+
+    /* This thread is worker 0.  A worker that cannot be started leaves its
+     * range to be stolen by the others. */
+    for (started = 1; started < numthreads; started++) {
+        if (pthread_create(&batch.workers[started].thread, NULL,
+                           chain_worker, &batch.workers[started]) != 0)
+            break;
+    }
+    chain_worker(&batch.workers[0]);
+    for (idx = 1; idx < started; idx++)
+        pthread_join(batch.workers[idx].thread, NULL);
+
+    for (idx = 0; idx < numthreads; idx++) {
+        if (stats != NULL)
+            stats[idx] = batch.workers[idx].stats;
+        pthread_mutex_destroy(&batch.workers[idx].lock);
+    }
+    free(batch.workers);
+    return numthreads;
+}
+
+/*-----------------------------------------------------------------------------
+ * Chain Instances
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Marks the deadlines downstream of a change: the changed
+ * deadline itself (source), or those counted from the trigger date
+ * (CHAINTRIGGER), and everything counted from a marked deadline, except
+ * pinned ones.  One pass in template order finds them, since each deadline
+ * comes after the one it counts from.
+ *
+ * Return: The number of deadlines newly marked.
+ */
+
+static int chain_mark(struct HolidayChainInstance *instance, int source)
+{
+    const struct HolidayChain *chain = instance->chain;
+    const struct DeadlineSpec *deadline;
+    int marked = 0;
+    int stale;
+    int idx;
+    int d;
+
+    for (idx = 0; idx < chain->numdeadlines; idx++) {
+        d = chain->order[idx];
+        deadline = &chain->deadlines[d];
+        stale = d == source || (!(instance->flags[d] & CHAINPINNED) &&
+                (deadline->from == source ||
+                 (deadline->from != CHAINTRIGGER &&
+                  (instance->flags[deadline->from] & CHAINDIRTY))));
+        if (stale && !(instance->flags[d] & CHAINDIRTY)) {
+            instance->flags[d] |= CHAINDIRTY;
+            marked++;
+        }
+    }
+    return marked;
+}
+
+/* Marks every deadline if the rules have changed since they were worked out */
+static void chain_checkrules(struct HolidayChainInstance *instance)
+{
+    unsigned long generation = ruleset_generation(instance->rules);
+    int d;
+
+    if (generation == instance->generation)
+        return;
+    instance->generation = generation;
+    for (d = 0; d < instance->chain->numdeadlines; d++)
+        instance->flags[d] |= CHAINDIRTY;
+    return;
+}
+
+/* A deadline's JDN, working it out (and what it counts from) if marked */
+static int chain_refresh(struct HolidayChainInstance *instance, int d)
+{
+    const struct DeadlineSpec *deadline = &instance->chain->deadlines[d];
+
+    if (!(instance->flags[d] & CHAINDIRTY))
+        return instance->jdns[d];
+    if (instance->flags[d] & CHAINPINNED)
+        instance->jdns[d] = instance->pinned[d];
+    else
+        instance->jdns[d] = chain_step(instance->rules, deadline,
+            deadline->from == CHAINTRIGGER ? instance->triggerjdn :
+            chain_refresh(instance, deadline->from));
+    instance->flags[d] &= (unsigned char) ~CHAINDIRTY;
+    return instance->jdns[d];
+}
+
+static int chain_triggerjdn(struct DateTime *trigger)
+{
+    int jdn = jdncnvrt(trigger);
+
+    return chain_inrange(jdn) ? jdn : -1;
+}
+
+struct HolidayChainInstance *holiday_chain_instance_create(
+        struct RuleSet *rules, const struct HolidayChain *chain,
+        struct DateTime *trigger)
+{
+    struct HolidayChainInstance *instance;
+    int numdeadlines = chain->numdeadlines;
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL)
+        return NULL;
+    instance->rules = rules;
+    instance->chain = chain;
+    instance->triggerjdn = chain_triggerjdn(trigger);
+    instance->jdns = malloc((size_t) numdeadlines * 3 * sizeof(int));
+    instance->flags = calloc((size_t) numdeadlines, 1);
+    if (instance->jdns == NULL || instance->flags == NULL) {
+        holiday_chain_instance_release(instance);
+        return NULL;
+    }
+    instance->reported = instance->jdns + numdeadlines;
+    instance->pinned = instance->jdns + 2 * numdeadlines;
+
+    instance->generation = ruleset_generation(rules);
+    chain_evaluate(rules, chain, instance->triggerjdn, instance->jdns);
+    memcpy(instance->reported, instance->jdns,
+           (size_t) numdeadlines * sizeof(int));
+    return instance;
+}
+
+void holiday_chain_instance_release(struct HolidayChainInstance *instance)
+{
+    if (instance == NULL)
+        return;
+    free(instance->jdns);
+    free(instance->flags);
+    free(instance);
+    return;
+}
+
+int holiday_chain_instance_set_trigger(struct HolidayChainInstance *instance,
+                                       struct DateTime *trigger)
+{
+    int triggerjdn = chain_triggerjdn(trigger);
+
+    if (triggerjdn == instance->triggerjdn)
+        return 0;
+    instance->triggerjdn = triggerjdn;
+    return chain_mark(instance, CHAINTRIGGER);
+}
+
+int holiday_chain_instance_pin(struct HolidayChainInstance *instance,
+                               int deadline, struct DateTime *dt)
+{
+    if (deadline < 0 || deadline >= instance->chain->numdeadlines)
+        return -1;
+    if (dt == NULL) {
+        if (!(instance->flags[deadline] & CHAINPINNED))
+            return 0;
+        instance->flags[deadline] &= (unsigned char) ~CHAINPINNED;
+    } else {
+        instance->flags[deadline] |= CHAINPINNED;
+        instance->pinned[deadline] = chain_triggerjdn(dt);
+    }
+    return chain_mark(instance, deadline);
+}
+
+int holiday_chain_instance_deadline(struct HolidayChainInstance *instance,
+                                    int deadline)
+{
+    if (deadline < 0 || deadline >= instance->chain->numdeadlines)
+        return -1;
+    chain_checkrules(instance);
+    return chain_refresh(instance, deadline);
+}
+
+int holiday_chain_instance_changes(struct HolidayChainInstance *instance,
+                                   int changed[], int maxchanged)
+{
+    int count = 0;
+    int d;
+
+    chain_checkrules(instance);
+    for (d = 0; d < instance->chain->numdeadlines; d++) {
+        if (chain_refresh(instance, d) == instance->reported[d])
+            continue;
+        if (count < maxchanged) {
+            changed[count] = d;
+            instance->reported[d] = instance->jdns[d];
+        }
+        count++;
+    }
+    return count;
+}
+
+/*-----------------------------------------------------------------------------
+ * Chains by Column
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Lays out the years from firstyear through lastyear for
+ * column-at-a-time evaluation, a year calendar at a time.
+ *
+ * Return: 0, or -1 if out of memory.
+ */
+
+static int chain_span_build(struct RuleSet *rules, struct ChainSpan *span,
+                            int firstyear, int lastyear)
+{
+    struct YearCalendar cal;
+    struct DateTime dt;
+    int year;
+    int day = 0;
+    int doy;
+
+    dt.year = firstyear;
+    dt.month = JANUARY;
+    dt.day = 1;
+    span->firstjdn = jdncnvrt(&dt);
+    dt.year = lastyear + 1;
+    span->numdays = jdncnvrt(&dt) - span->firstjdn;
+    span->numopen = 0;
+    span->before = malloc((size_t) (span->numdays + 1) * sizeof(int));
+    span->open = malloc((size_t) span->numdays * sizeof(int));
+    if (span->before == NULL || span->open == NULL) {
+        free(span->before);
+        free(span->open);
+        return -1;
+    }
+    for (year = firstyear; year <= lastyear; year++) {
+        ruleset_getyear(rules, year, &cal);
+        for (doy = 0; doy < cal.numdays; doy++, day++) {
+            span->before[day] = span->numopen;
+            if (!calendar_testday(&cal, doy))
+                span->open[span->numopen++] = span->firstjdn + day;
+        }
+    }
+    span->before[day] = span->numopen;
+    return 0;
+}
+
+/* A step counted the slow way, for a case that leaves the span */
+static int chain_step_outside(struct RuleSet *rules,
+                              const struct DeadlineSpec *deadline, int fromjdn)
+{
+    if (deadline->from == CHAINTRIGGER && !chain_inrange(fromjdn))
+        fromjdn = -1;
+    return chain_step(rules, deadline, fromjdn);
+}
+
+/*
+ * Description: Works out one deadline for every case, from the column of the
+ * dates it counts from.  Each step is an add, or a rank and a select: every
+ * kind of step comes down to open[before[day + shift] + bias], so the loop has
+ * no branches on the kind of step and is a plain gather the compiler can
+ * vectorize.  Cases that leave the span are counted one at a time.
+ */
+
+static void chain_column(struct RuleSet *rules, const struct ChainSpan *span,
+                         const struct DeadlineSpec *deadline, const int from[],
+                         int to[], int numcases)
+{
+    const int *before = span->before;
+    const int *open = span->open;
+    int amount = deadline->amount;
+    int offset = 0; /* calendar days to count first */
+    int shift = 0; /* count court days through the day (1) or before it (0) */
+    int bias = 0;
+    int day;
+    int rank;
+    int idx;
+
+    if (deadline->step == STEP_CALENDARDAYS ||
+            (deadline->step == STEP_COURTDAYS && amount == 0)) {
+        for (idx = 0; idx < numcases; idx++) {
+            day = from[idx] - span->firstjdn + amount;
+            to[idx] = from[idx] >= 0 && day >= 0 && day < span->numdays ?
+                from[idx] + amount :
+                chain_step_outside(rules, deadline, from[idx]);
+        }
+        return;
+    }
+    switch (deadline->step) {
+        case STEP_COURTDAYS: /* the court day amount ranks away */
+            shift = amount > 0;
+            bias = amount > 0 ? amount - 1 : amount;
+            break;
+        case STEP_ROLLFORWARD: /* the first court day not before the day */
+            offset = amount;
+            break;
+        default: /* STEP_ROLLBACKWARD: the last court day through the day */
+            offset = amount;
+            shift = 1;
+            bias = -1;
+            break;
+    }
+    for (idx = 0; idx < numcases; idx++) {
+        day = from[idx] - span->firstjdn + offset;
+        rank = from[idx] >= 0 && day >= 0 && day < span->numdays ?
+            before[day + shift] + bias : -1;
+        to[idx] = rank >= 0 && rank < span->numopen ? open[rank] :
+            chain_step_outside(rules, deadline, from[idx]);
+    }
+    return;
+}
+
+int holiday_ruleset_evaluate_deadlines_columns(struct RuleSet *rules,
+        const struct HolidayChain *chain, const int triggerjdns[],
+        int numcases, int *columns[])
+{
+    const struct DeadlineSpec *deadline;
+    struct ChainSpan span;
+    struct DateTime dt;
+    int firstjdn;
+    int lastjdn;
+    int firstyear;
+    int lastyear;
+    int status = 0;
+    int idx;
+    int d;
+
+    if (numcases < 1)
+        return 0;
+    firstjdn = lastjdn = triggerjdns[0];
+    for (idx = 1; idx < numcases; idx++) {
+        if (triggerjdns[idx] < firstjdn)
+            firstjdn = triggerjdns[idx];
+        if (triggerjdns[idx] > lastjdn)
+            lastjdn = triggerjdns[idx];
+    }
+    jdn2greg(firstjdn - chain->reach, &dt);
+    firstyear = dt.year < CAL_MINYEAR ? CAL_MINYEAR : dt.year;
+    jdn2greg(lastjdn + chain->reach, &dt);
+    lastyear = dt.year > CAL_MAXYEAR ? CAL_MAXYEAR : dt.year;
+    if (firstyear > lastyear || chain_span_build(rules, &span, firstyear,
+                                                 lastyear) != 0) {
+        span.firstjdn = 0; /* an empty span: every case the slow way */
+        span.numdays = 0;
+        span.numopen = 0;
+    }
+
+    for (idx = 0; idx < chain->numdeadlines; idx++) {
+        d = chain->order[idx];
+        deadline = &chain->deadlines[d];
+        chain_column(rules, &span, deadline, deadline->from == CHAINTRIGGER ?
+                     triggerjdns : columns[deadline->from], columns[d],
+                     numcases);
+    }
+    if (span.numdays > 0) {
+        free(span.before);
+        free(span.open);
+    }
+    for (d = 0; d < chain->numdeadlines && status == 0; d++) {
+        for (idx = 0; idx < numcases; idx++) {
+            if (columns[d][idx] < 0) {
+                status = -1;
+                break;
+            }
+        }
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------------------------
+ * Offset Fan-Out
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Counts sorted court-day offsets from one day in a single sweep
+ * of the court-day index: the start's rank in its year is looked up once,
+ * and each offset is then selected from the year it falls in, moving only
+ * away from the start.  direction is 1 for the positive offsets (from first
+ * up) or -1 for the negative ones (from last down).
+ */
+
+static void fanout_courtdays(struct RuleSet *rules, int startjdn,
+                             const int offsets[], int first, int last,
+                             int direction, struct DateTime results[])
+{
+    struct YearCalendar cal;
+    struct DateTime dt;
+    int base; /* start's rank, less the court days of the years passed */
+    int target;
+    int idx;
+
+    jdn2greg(startjdn, &dt);
+    ruleset_getyear(rules, dt.year, &cal);
+    base = calendar_courtdays_before(&cal, startjdn - cal.jdn +
+                                     (direction > 0));
+    for (idx = direction > 0 ? first : last;
+            idx >= first && idx <= last; idx += direction) {
+        target = base + offsets[idx] - (direction > 0);
+        while (target < 0 || target >= cal.courtdays) {
+            if (cal.year + direction < CAL_MINYEAR ||
+                    cal.year + direction > CAL_MAXYEAR)
+                break;
+            if (direction > 0)
+                base -= cal.courtdays;
+            ruleset_getyear(rules, cal.year + direction, &cal);
+            if (direction < 0)
+                base += cal.courtdays;
+            target = base + offsets[idx] - (direction > 0);
+        }
+        if (target < 0 || target >= cal.courtdays) { /* past 1753 - 9999 */
+            for (; idx >= first && idx <= last; idx += direction)
+                results[idx].jdn = -1;
+            break;
+        }
+        results[idx].jdn = cal.jdn + calendar_select_open(&cal, target);
+    }
+    return;
+}
+
+int holiday_ruleset_offset_fanout(struct RuleSet *rules,
+                                  struct DateTime *orig_date, int step,
+                                  const int offsets[], int count,
+                                  struct DateTime results[])
+{
+    struct DeadlineSpec deadline;
+    int startjdn;
+    int firstpositive;
+    int lastnegative;
+    int status = 0;
+    int idx;
+
+    if (count < 1 || step < STEP_CALENDARDAYS || step > STEP_ROLLBACKWARD)
+        return -1;
+    for (idx = 1; idx < count; idx++) {
+        if (offsets[idx] < offsets[idx - 1])
+            return -1;
+    }
+    startjdn = jdncnvrt(orig_date);
+    if (!chain_inrange(startjdn)) {
+        for (idx = 0; idx < count; idx++) {
+            memset(&results[idx], 0, sizeof(results[idx]));
+            results[idx].jdn = -1;
+        }
+        return -1;
+    }
+
+    /* the JDNs go in results[].jdn first, then become dates; the negative
+     * offsets are swept backward and the positive ones forward */
+    for (lastnegative = -1; lastnegative + 1 < count &&
+            offsets[lastnegative + 1] < 0; lastnegative++)
+        ;
+    for (firstpositive = lastnegative + 1; firstpositive < count &&
+            offsets[firstpositive] == 0; firstpositive++)
+        ;
+    deadline.name = "";
+    deadline.from = CHAINTRIGGER;
+    deadline.step = step;
+    for (idx = 0; idx < count; idx++) {
+        if (step != STEP_COURTDAYS) { /* an add, then at most a short scan */
+            deadline.amount = offsets[idx];
+            results[idx].jdn = chain_step(rules, &deadline, startjdn);
+        } else if (idx > lastnegative && idx < firstpositive) {
+            results[idx].jdn = startjdn;
+        }
+    }
+    if (step == STEP_COURTDAYS) {
+        fanout_courtdays(rules, startjdn, offsets, 0, lastnegative, -1,
+                         results);
+        fanout_courtdays(rules, startjdn, offsets, firstpositive, count - 1,
+                         1, results);
+    }
+    for (idx = 0; idx < count; idx++) {
+        if (ruleset_courtday_result(results[idx].jdn, &results[idx]) != 0) {
+            memset(&results[idx], 0, sizeof(results[idx]));
+            results[idx].jdn = -1;
+            status = -1;
+        }
+    }
+    return status;
+}
+
+/*-----------------------------------------------------------------------------
+ * Reverse Solving
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Undoes one step: finds the latest day from which the step
+ * lands on or before target (latest 1), or the earliest from which it lands
+ * on or after it (latest 0).  Every step only ever moves later as the day it
+ * counts from does, so the answer is the edge of a run of days, found with a
+ * scan to the nearest court day and a rank and select.  E.g., for one court
+ * day forward to land by Tuesday, the start may be as late as Monday; every
+ * day of the weekend before lands on Monday, and the earliest start to land
+ * on or after Monday is the Friday.
+ *
+ * Return: The JDN, or -1 if there is none within 1753 - 9999.
+ */
+
+static int chain_invert(struct RuleSet *rules,
+                        const struct DeadlineSpec *deadline, int target,
+                        int latest)
+{
+    int amount = deadline->amount;
+    int edge;
+
+    if (target < 0)
+        return -1;
+    switch (deadline->step) {
+        case STEP_COURTDAYS:
+            if (amount == 0)
+                return target;
+            /* from the last court day through the target (or the first
+             * from it on), count back to the start's court day */
+            edge = ruleset_scan_courtday(rules, target, latest ? -1 : 1);
+            if (edge < 0)
+                return -1;
+            if (latest)
+                edge = ruleset_courtday_offset(rules, edge,
+                    amount > 0 ? 1 - amount : -amount);
+            else
+                edge = ruleset_courtday_offset(rules, edge,
+                    amount > 0 ? -amount : -amount - 1);
+            if (edge < 0)
+                return -1;
+            if (latest && amount > 0)
+                edge--; /* the day before the next start's court day */
+            else if (!latest && amount < 0)
+                edge++; /* the day after the last start's court day */
+            break;
+        case STEP_ROLLFORWARD: /* lands on the first court day from x + a */
+            edge = ruleset_scan_courtday(rules, latest ? target : target - 1,
+                                         -1);
+            if (edge < 0)
+                return -1;
+            edge = (latest ? edge : edge + 1) - amount;
+            break;
+        case STEP_ROLLBACKWARD: /* lands on the last court day through x + a */
+            edge = ruleset_scan_courtday(rules, latest ? target + 1 : target,
+                                         1);
+            if (edge < 0)
+                return -1;
+            edge = (latest ? edge - 1 : edge) - amount;
+            break;
+        default: /* STEP_CALENDARDAYS */
+            edge = target - amount;
+            break;
+    }
+    return chain_inrange(edge) ? edge : -1;
+}
+
+/* Undoes every step from a deadline back to the trigger date */
+static int chain_solve(struct RuleSet *rules, const struct HolidayChain *chain,
+                       int deadline, struct DateTime *target, int latest,
+                       struct DateTime *trigger)
+{
+    int jdn;
+
+    if (deadline < 0 || deadline >= chain->numdeadlines)
+        return -1;
+    jdn = jdncnvrt(target);
+    if (!chain_inrange(jdn))
+        return -1;
+    for (; deadline != CHAINTRIGGER && jdn >= 0;
+            deadline = chain->deadlines[deadline].from)
+        jdn = chain_invert(rules, &chain->deadlines[deadline], jdn, latest);
+    return ruleset_courtday_result(jdn, trigger);
+}
+
+int holiday_ruleset_latest_trigger(struct RuleSet *rules,
+                                   const struct HolidayChain *chain,
+                                   int deadline, struct DateTime *target,
+                                   struct DateTime *trigger)
+{
+    return chain_solve(rules, chain, deadline, target, 1, trigger);
+}
+
+int holiday_ruleset_earliest_trigger(struct RuleSet *rules,
+                                     const struct HolidayChain *chain,
+                                     int deadline, struct DateTime *target,
+                                     struct DateTime *trigger)
+{
+    return chain_solve(rules, chain, deadline, target, 0, trigger);
+}
+
+int holiday_ruleset_latest_courtday_start(struct RuleSet *rules,
+                                          struct DateTime *target,
+                                          int numdays,
+                                          struct DateTime *result)
+{
+    struct DeadlineSpec deadline = {"", CHAINTRIGGER, STEP_COURTDAYS, 0};
+    int jdn = jdncnvrt(target);
+
+    deadline.amount = numdays;
+    return ruleset_courtday_result(chain_inrange(jdn) ?
+        chain_invert(rules, &deadline, jdn, 1) : -1, result);
+}
+
+int holiday_ruleset_earliest_courtday_start(struct RuleSet *rules,
+                                            struct DateTime *target,
+                                            int numdays,
+                                            struct DateTime *result)
+{
+    struct DeadlineSpec deadline = {"", CHAINTRIGGER, STEP_COURTDAYS, 0};
+    int jdn = jdncnvrt(target);
+
+    deadline.amount = numdays;
+    return ruleset_courtday_result(chain_inrange(jdn) ?
+        chain_invert(rules, &deadline, jdn, 0) : -1, result);
+}
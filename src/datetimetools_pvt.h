@@ -39,6 +39,8 @@
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <limits.h>
+#include <pthread.h>
 #include "../include/datetools.h"
 
 /*-----------------------------------------------------------------------------
@@ -71,17 +73,37 @@
      */
 
 
+/*
+ * The calendar cache is read without taking a lock, so the few shared words it
+ * publishes are accessed through the GCC/Clang __atomic builtins. Relaxed
+ * operations are used for statistics counters, where ordering does not matter.
+ */
+
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(p,v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_STORE_RELAXED(p,v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_ADD(p,v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define ATOMIC_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+
+/* Thread-local storage, also a GCC/Clang extension */
+
+#define THREAD_LOCAL __thread
+
 /*-----------------------------------------------------------------------------
  * Symbolic Constants: Holiday File Field Codes 
  *----------------------------------------------------------------------------*/
 
 /*  Define field codes for the holiday CSV File */
 
-const char *HF_MONTH     = "Month";
-const char *HF_RTYPE     = "Rule Type";
-const char *HF_RULE      = "Rule";
-const char *HF_HOLIDAY   = "Holiday";
-const char *HF_AUTHORITY = "Authority";
+extern const char *HF_MONTH;
+extern const char *HF_RTYPE;
+extern const char *HF_RULE;
+extern const char *HF_HOLIDAY;
+extern const char *HF_AUTHORITY;
+extern const char *HF_FROM;
+extern const char *HF_UNTIL;
 
 /*  Sizes and numbers of records and fields */
 
@@ -101,10 +123,10 @@ const char *HF_AUTHORITY = "Authority";
 
 /*  Token processing flags */
 
-const unsigned char BEGIN_FIELD = (1<<0); /* Set when the first field delimiter is reached. */
-const unsigned char BEGIN_TSTRING = (1<<1); /* Set when the first text delimiter is reached. */
-const unsigned char END_TSTRING = (1<<2); /* Set when the end text delimter is reached. */
-const unsigned char TOKEN_FOUND = (1<<7); /* Set when the token was found */
+extern const unsigned char BEGIN_FIELD; /* Set when the first field delimiter is reached. */
+extern const unsigned char BEGIN_TSTRING; /* Set when the first text delimiter is reached. */
+extern const unsigned char END_TSTRING; /* Set when the end text delimter is reached. */
+extern const unsigned char TOKEN_FOUND; /* Set when the token was found */
 
 /* Macro definitions for error codes */
 
@@ -118,12 +140,137 @@ const unsigned char TOKEN_FOUND = (1<<7); /* Set when the token was found */
  * EXPORTED, BUT PRIVATE, DATA TYPES 
  *----------------------------------------------------------------------------*/
 
-/* rulefile state */
+/* Compiled year calendars.
+ *
+ * A year calendar is the holiday rules resolved for every day of one year and
+ * stored as a bitmap: bit n is set when day n of the year (January 1 = 0) is a
+ * holiday or weekend.  Alongside the bitmap, rank[] holds the number of court
+ * days that precede each bitmap word, which is the court-day index used to
+ * count court days without visiting each date.  Calendars are only compiled
+ * for the years in which derive_weekday() is accurate.
+ */
+
+#define CAL_MINYEAR 1753
+#define CAL_MAXYEAR 9999
+#define CAL_NUMYEARS (CAL_MAXYEAR - CAL_MINYEAR + 1)
+#define CAL_MAXDAYS 366
+#define CAL_WORDBITS ((int) (CHAR_BIT * sizeof(unsigned long)))
+#define CAL_WORDS ((CAL_MAXDAYS + (CHAR_BIT * sizeof(unsigned long)) - 1) / \
+                   (CHAR_BIT * sizeof(unsigned long)))
+
+#define CAL_DEFAULTBUDGET (64 * 1024) /* bytes of year calendars per ruleset */
+
+struct YearCalendar {
+    int year;
+    int jdn; /* Julian Day Number of January 1 */
+    int numdays; /* 365 or 366 */
+    int courtdays; /* total court days in the year */
+    unsigned long closed[CAL_WORDS]; /* bit set = holiday or weekend */
+    unsigned short rank[CAL_WORDS]; /* court days before each word */
+};
+
+/* The calendar cache holds a fixed number of slots, sized from the memory
+ * budget, and evicts with the CLOCK algorithm.  Readers never lock: they find
+ * the slot through yearindex[], copy the calendar out, and use the slot's
+ * sequence number to detect a concurrent rewrite (an odd sequence number means
+ * a writer is busy).  A hit only sets the slot's reference bit, so readers do
+ * not relink any shared list the way an LRU list would require.  Misses build
+ * the calendar outside the lock and take the lock only to install it.
+ */
+
+struct CalendarSlot {
+    unsigned long seq; /* even = stable; odd = being rewritten */
+    unsigned char referenced; /* CLOCK reference bit */
+    struct YearCalendar cal;
+};
+
+/* In front of the shared cache, each thread keeps its own few most recently
+ * used calendars (CAL_HOTYEARS of them), so that the years nearly every query
+ * lands on are answered without touching any shared memory but the cache's
+ * generation number.  Every flush or resize of a cache gives it a new
+ * generation, drawn from a counter shared by all caches, and a thread's copy
+ * is only used while its generation still matches.  Hits on a thread's copies
+ * are tallied locally and added to the shared count every CAL_HOTFOLD hits.
+ */
+
+#define CAL_HOTYEARS 8
+#define CAL_HOTFOLD 256
+
+struct CalendarCache {
+    struct CalendarSlot *slots;
+    short *yearindex; /* slot holding each year, or -1 */
+    int numslots; /* slots that fit in the budget */
+    int inuse; /* slots filled so far */
+    int hand; /* the CLOCK hand */
+    size_t budget; /* bytes of calendars allowed */
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long generation; /* changes whenever the calendars may have */
+    pthread_mutex_t lock; /* serializes writers only */
+    int initialized;
+};
+
+/* The on-disk calendar store.  A span of compiled years is written once to a
+ * file in the cache directory and mapped read-only by later processes.  The
+ * file name is a hash of the rule file's contents, the library version, the
+ * span, and the calendar layout, so a changed rule file (or a new release)
+ * simply looks for a different file.  The rule file's contents are also kept
+ * in the store and compared on load, so a hash collision cannot hand back the
+ * wrong calendars.  Writers publish with rename(), which is atomic.
+ */
+
+#define LIBVERSION "1.0.0" /* rewritten from VERSION by bumpversion.sh */
+#define STOREMAGIC "DTCALV1"
+
+struct CalendarStoreHeader {
+    char magic[8];
+    char libversion[16];
+    unsigned long contenthash;
+    long contentlen; /* rule file bytes following the header */
+    int firstyear;
+    int lastyear;
+    int calendarsize; /* sizeof(struct YearCalendar) when written */
+    long calendaroffset; /* file offset of the first calendar */
+};
+
+struct CalendarStore {
+    void *map; /* the mapped file, or NULL */
+    size_t maplen;
+    const struct YearCalendar *years;
+    int firstyear;
+    int lastyear;
+};
+
+/* rulefile state
+ *
+ * A rule set is either the rules loaded from one file (holidays points to its
+ * hash table, described below) or a composite of two other rule sets: their
+ * union, where a day is closed if it is closed in either, or their
+ * intersection, where it must be closed in both.  A composite compiles each
+ * year by combining its operands' year calendars word by word, and caches the
+ * result like any other rule set, so querying it costs no more than querying
+ * a single set of rules.  Rule sets other than the active one are kept on a
+ * list, so that reloading a rule set can find the composites built on it.
+ */
+
 struct RuleSet {
     FILE *rulefile;
     char headerfields[MAXNUMFIELDS][MAXFIELDLEN];
     int totalnumfields;
     enum {CLOSED, OPEN} openstatus;
+    struct CalendarCache cache; /* compiled year calendars for these rules */
+    struct CalendarStore store; /* years mapped from the cache directory */
+    struct HolidayNode **holidays; /* the rules' hash table, or NULL */
+    enum {RULESET_RULES, RULESET_UNION, RULESET_INTERSECTION} kind;
+    struct RuleSet *left; /* operands of a composite */
+    struct RuleSet *right;
+    struct RuleSet *calendars; /* rule set whose calendars these rules use,
+                                  or NULL to use their own */
+    int registered; /* owned by the jurisdiction registry */
+    struct RuleIndex *ruleindex; /* which rule closes each day, built on
+                                    demand */
+    struct RuleSet *nextruleset; /* the list of rule sets */
 };
 
 /* The holiday rules are maintained in a chained hash table data structure.
@@ -138,8 +285,9 @@ struct RuleSet {
 struct HolidayRule{
     int month;
     char ruletype;
-        /* holds one of three possible values: 'w' for a weekend rule, 'r'
-         * for a relative rule, and 'a' for an absolute rule
+        /* 'w' for a weekend rule, 'r' for a relative rule, 'a' for an
+         * absolute rule, 'o' for an absolute rule observed on a weekday,
+         * and 'e' for a rule relative to Easter Sunday
          */
     unsigned int wkday;
         /* the day of the wk to which the rule applies. if the rule is
@@ -149,20 +297,195 @@ struct HolidayRule{
         /* the week number to which the rule applies if the rule is
          * relative.
          */
-    int day; /* the day of the holiday if the ruletype is 'a' */
-    char holidayname[40]; /* the title of the holiday */
-    char authority[100]; /* the statutory authority for the holiday */
+    int day; /* the day of the holiday if the ruletype is 'a' or 'o' */
+    const char *holidayname; /* the title of the holiday */
+    const char *authority; /* the statutory authority for the holiday */
+        /* both strings are kept in the string pool, which stores each
+         * distinct string once however many rule sets use it */
+    int effective_from; /* first date in effect, as YYYYMMDD, or 0 */
+    int effective_until; /* last date in effect, as YYYYMMDD, or 0 */
+        /* checked as each year is compiled, so a rule file can carry every
+         * version of its rules and still answer for any year */
+    int shift; /* an OBSERVEDSHIFT, if the ruletype is 'o' */
+    int offset; /* days from Easter Sunday, if the ruletype is 'e' */
 };
 
 struct HolidayNode { /* structure for linked list to hold court holidays */
     struct HolidayRule rule; 
+    unsigned long checks; /* times the rule has been tested */
+    unsigned long hits; /* times it matched */
     struct HolidayNode *nextrule; 
 };
 
+/* A compile tallies each rule's checks and hits here, by the rule's place in
+ * its list, and adds them to the shared counts once at the end, so threads
+ * compiling at the same time do not contend for the rules' counters.  Rules
+ * past the first RULETALLY of a list are counted directly. */
+
+#define RULETALLY 32
+
+struct RuleTally {
+    unsigned long checks[TTLMONTHS][RULETALLY];
+    unsigned long hits[TTLMONTHS][RULETALLY];
+};
+
+/* The jurisdiction registry maps jurisdiction IDs to rule files, loading
+ * each file the first time its jurisdiction is asked for.  Jurisdictions whose
+ * rules are identical once parsed (the same months, types, and days, in any
+ * order, whatever the names and authorities) compile to identical calendars,
+ * so a jurisdiction found to match one already loaded keeps its own rules but
+ * uses the other's calendar cache (RuleSet.calendars).  Sharing is decided
+ * for whole rule sets: jurisdictions whose rules differ share nothing, even
+ * in years where they happen to compile to the same calendar.  Each
+ * jurisdiction keeps a hash of its sorted rule keys, taken when it loads, so
+ * a new one only compares keys with those that hash the same.  Names and
+ * authorities are interned in the string pool.
+ */
+
+#define REGISTRYBUCKETS 512
+#define STRINGPOOLBUCKETS 4096
+#define HASH_INIT 2166136261UL /* FNV-1a offset basis */
+
+struct Jurisdiction {
+    const char *id; /* interned */
+    const char *rulefilename; /* interned */
+    struct RuleSet *rules; /* NULL until first used */
+    unsigned long keyhash; /* of the rule keys, as loaded */
+    struct Jurisdiction *next; /* bucket chain */
+};
+
+struct PooledString {
+    struct PooledString *next; /* bucket chain */
+    unsigned long hash;
+    char text[1]; /* allocated to fit */
+};
+
+/* Bit-sliced calendars.  For a span of years and up to CAL_WORDBITS rule
+ * sets (the lanes), closed[] holds one word per day: bit n is set when the day
+ * is closed under rule set n.  So one load answers for every lane, and lanes
+ * can be counted together with word-wide operations.
+ */
+
+struct HolidayLanes {
+    int numlanes;
+    unsigned long lanemask; /* a bit for each lane in use */
+    int firstjdn; /* January 1 of the first year */
+    int numdays;
+    struct RuleSet *rules[CAL_WORDBITS];
+    unsigned long *closed;
+};
+
+/* Deadline chain templates.  The deadlines are kept in the caller's order,
+ * and order[] lists them so that each comes after the one it is counted from,
+ * so a chain is evaluated in one pass over order[].
+ */
+
+struct HolidayChain {
+    int numdeadlines;
+    struct DeadlineSpec *deadlines; /* names are pooled */
+    int *order;
+    int reach; /* calendar days any deadline is likely to fall from the
+                * trigger date, at most */
+};
+
+/* A span of days laid out for evaluating chains a column at a time: before[i]
+ * is the number of court days in the span before day i, and open[k] is the
+ * JDN of its k-th court day, so rank and select are each one array read.
+ */
+
+struct ChainSpan {
+    int firstjdn;
+    int numdays;
+    int numopen;
+    int *before; /* numdays + 1 counts */
+    int *open;
+};
+
+/* A case's deadlines under a chain template, kept up to date as its dates
+ * change.  Deadlines affected by a change are flagged CHAINDIRTY and worked
+ * out again only when next asked for; a CHAINPINNED deadline is held to a
+ * date set by the caller (e.g., a hearing the court has continued).
+ */
+
+#define CHAINDIRTY 1
+#define CHAINPINNED 2
+
+struct HolidayChainInstance {
+    struct RuleSet *rules;
+    const struct HolidayChain *chain;
+    unsigned long generation; /* of the rules, when last worked out */
+    int triggerjdn;
+    int *jdns; /* each deadline, as last worked out */
+    int *reported; /* each deadline, as last reported changed */
+    int *pinned; /* the date each pinned deadline is held to */
+    unsigned char *flags; /* CHAINDIRTY, CHAINPINNED */
+};
+
+/* Closure overlays.  The one-off closures (and forced openings) layered on a
+ * rule set are kept in an AVL tree keyed by Julian Day Number, so setting or
+ * clearing a date is O(log n).  Each node also records how the date changes
+ * the court-day count against the base (delta: -1 for a closure of a court
+ * day, +1 for an opening of a closed day, 0 if it changes nothing), and sum
+ * totals delta over the node's subtree, so the court days in a range are the
+ * base's count plus two O(log n) prefix sums.  The deltas hold while the
+ * base's calendar generation matches; after the base changes they are worked
+ * out again on the next query.
+ */
+
+struct OverlayNode {
+    int jdn;
+    int state; /* OVERLAY_CLOSED or OVERLAY_OPEN */
+    int delta; /* court days this date adds to the base's count */
+    int sum; /* delta summed over this subtree */
+    int height; /* of this subtree, for balancing */
+    struct OverlayNode *left;
+    struct OverlayNode *right;
+};
+
+struct HolidayOverlay {
+    struct RuleSet *base;
+    unsigned long basegeneration; /* the deltas are good while this matches */
+    struct OverlayNode *root;
+    int numdates;
+    pthread_mutex_t lock;
+};
+
+/* Rule indexes.  For a few recently explained years, ruleid[] gives the rule
+ * closing each day of the year as a small ID (0 for a court day), and the
+ * ID's name and authority are looked up in the year's own table, so saying
+ * why a day is closed is one array read.  An entry is good while the rule
+ * set's calendar generation matches, since an edit or reload may change the
+ * rules.  Names and authorities come from the string pool and outlive the
+ * rules.  Each rule set's index has its own lock, so explaining days under
+ * one rule set does not wait for another's.
+ */
+
+#define RULEINDEXYEARS 8 /* years indexed per rule set */
+#define RULEINDEXRULES 64 /* distinct rules closing days in a year */
+#define RULEINDEXOTHER 255 /* ID of a day whose rule is found by evaluation */
+
+struct RuleIndexYear {
+    int year; /* 0 if unused */
+    unsigned long generation;
+    int numrules;
+    const char *holidayname[RULEINDEXRULES]; /* of ID n at [n - 1] */
+    const char *authority[RULEINDEXRULES];
+    unsigned char ruleid[CAL_MAXDAYS];
+};
+
+struct RuleIndex {
+    pthread_mutex_t lock; /* held while a year is found, built, or read */
+    int next; /* entry to reuse next */
+    struct RuleIndexYear years[RULEINDEXYEARS];
+};
+
 /* The hash table itself: an array to hold an individual holiday-node linked
 list for each month of the year + the ALLMONTHS rules */
 extern struct HolidayNode *holidayhashtable[13];
 
+/* The rule set loaded by holiday_rules_open() */
+extern struct RuleSet activerules_h;
+
 /*-----------------------------------------------------------------------------
  * Holiday Hashtable Handler Functions
  *----------------------------------------------------------------------------*/
@@ -176,6 +499,8 @@ void holiday_rules_get_tokens(FILE *holidayrulefile,
 char *holiday_rules_tokenize(char *string, int *lasttoken);
 void holiday_rules_parse_token(char *token, char *cur_field,
                                 struct HolidayRule *newholiday);
+int holiday_rules_parse_date(const char *token, int endofrange);
+int holiday_rule_slot(const struct HolidayRule *rule);
 void holiday_table_addrule(struct HolidayNode **elementhandle,
                                           struct HolidayRule *newrule);
 void holiday_table_release(struct HolidayNode *holidayhashtable[]);
@@ -193,7 +518,86 @@ int holiday_rules_closefile(FILE *holidayrulefile);
  * Process Holiday Rules
  *----------------------------------------------------------------------------*/
 
-int holiday_tbl_checkrule(struct DateTime *dt, struct HolidayNode *rulenode);
+int holiday_tbl_checkrule(struct DateTime *dt, struct HolidayNode *rulenode,
+                          unsigned long checks[], unsigned long hits[]);
+int holiday_rule_matches(struct DateTime *dt, const struct HolidayRule *rule);
+int holiday_tbl_evaluate(struct DateTime *dt,
+                         struct HolidayNode *holidayhashtable[]);
+int holiday_tbl_evaluate_tallied(struct DateTime *dt,
+                                 struct HolidayNode *holidayhashtable[],
+                                 struct RuleTally *tally);
+void holiday_tally_fold(struct RuleTally *tally,
+                        struct HolidayNode *holidayhashtable[]);
+
+/*-----------------------------------------------------------------------------
+ * Compiled Year Calendars and the Calendar Cache
+ *----------------------------------------------------------------------------*/
+
+void calendar_build(struct YearCalendar *cal, int year,
+                    struct HolidayNode *holidayhashtable[]);
+void calendar_rank(struct YearCalendar *cal);
+void calendar_close_days(struct YearCalendar *cal, int firstdoy,
+                         int lastdoy);
+int calendar_dayofyear(int year, int month, int day);
+int calendar_testday(const struct YearCalendar *cal, int dayofyear);
+int calendar_courtdays_before(const struct YearCalendar *cal, int dayofyear);
+int calendar_next_open(const struct YearCalendar *cal, int dayofyear);
+int calendar_prev_open(const struct YearCalendar *cal, int dayofyear);
+int calendar_period_bounds(const struct YearCalendar *cal, int periodkind,
+                           int period, int *firstdoy, int *enddoy);
+int calendar_select_open(const struct YearCalendar *cal, int courtdays);
+void calendar_month_courtdays(const struct YearCalendar *cal,
+                              int courtdays[TTLMONTHS]);
+int calendar_enumerate(const struct YearCalendar *cal, int firstdoy,
+                       int lastdoy, int flags, int dates[], int maxdates,
+                       int *nextdoy);
+void calendar_cache_init(struct CalendarCache *cache, size_t budget);
+void calendar_cache_flush(struct CalendarCache *cache);
+void calendar_cache_release(struct CalendarCache *cache);
+const struct YearCalendar *calendar_cache_get(struct RuleSet *rules, int year,
+                                              struct YearCalendar *scratch);
+int calendar_cache_put(struct CalendarCache *cache,
+                       const struct YearCalendar *cal);
+int calendar_cache_holds(struct RuleSet *rules, int year);
+int calendar_cache_patch(struct CalendarCache *cache,
+                         struct HolidayNode *holidayhashtable[],
+                         const struct HolidayRule *rule);
+void calendar_cache_recompile(struct RuleSet *rules);
+void calendar_compile(struct RuleSet *rules, struct YearCalendar *cal,
+                      int year);
+int ruleset_evaluate(struct RuleSet *rules, struct DateTime *dt);
+const struct HolidayRule *ruleset_matchrule(struct RuleSet *rules,
+                                            struct DateTime *dt);
+const char *ruleset_rulename(struct RuleSet *rules, struct DateTime *dt);
+void ruleindex_release(struct RuleIndex *index);
+void ruleset_getyear(struct RuleSet *rules, int year,
+                     struct YearCalendar *cal);
+void ruleset_invalidate(struct RuleSet *rules);
+struct RuleSet *ruleset_read(FILE *rulefile);
+void ruleset_attach_calendars(struct RuleSet *rules, FILE *rulefile);
+void ruleset_register(struct RuleSet *rules);
+size_t ruleset_rule_bytes(struct RuleSet *rules);
+int ruleset_courtdays(struct RuleSet *rules, int firstjdn, int lastjdn);
+int ruleset_scan_courtday(struct RuleSet *rules, int jdn, int direction);
+int ruleset_courtday_offset(struct RuleSet *rules, int jdn, int numdays);
+int ruleset_courtday_result(int jdn, struct DateTime *result);
+int tolling_courtday_offset(struct RuleSet *rules, int jdn, int numdays,
+                            const struct HolidayTolledPeriod tolled[],
+                            int numtolled);
+int chain_step(struct RuleSet *rules, const struct DeadlineSpec *deadline,
+               int fromjdn);
+unsigned long ruleset_generation(struct RuleSet *rules);
+size_t calendar_cache_resident_bytes(struct CalendarCache *cache);
+
+/*-----------------------------------------------------------------------------
+ * String Pool and Hashing
+ *----------------------------------------------------------------------------*/
+
+unsigned long hash_bytes(const void *bytes, size_t len, unsigned long hash);
+const char *stringpool_intern(const char *text);
+size_t stringpool_bytes(void);
+void calendar_store_open(struct RuleSet *rules, FILE *holidayrulefile);
+void calendar_store_close(struct CalendarStore *store);
 
 /*-----------------------------------------------------------------------------
  *  Error Handling
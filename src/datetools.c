@@ -29,6 +29,23 @@
 struct HolidayNode *holidayhashtable[13];
 struct RuleSet activerules_h;
 
+/*  Field codes for the holiday CSV File */
+
+const char *HF_MONTH     = "Month";
+const char *HF_RTYPE     = "Rule Type";
+const char *HF_RULE      = "Rule";
+const char *HF_HOLIDAY   = "Holiday";
+const char *HF_AUTHORITY = "Authority";
+const char *HF_FROM      = "Effective From"; /* optional */
+const char *HF_UNTIL     = "Effective Until"; /* optional */
+
+/*  Token processing flags */
+
+const unsigned char BEGIN_FIELD = (1<<0);
+const unsigned char BEGIN_TSTRING = (1<<1);
+const unsigned char END_TSTRING = (1<<2);
+const unsigned char TOKEN_FOUND = (1<<7);
+
 /*-----------------------------------------------------------------------------
  * Holidy Hashtable Handler Functions
  *----------------------------------------------------------------------------*/   
@@ -47,6 +64,14 @@ int holiday_rules_open(const char *receivedrulefilename, int close_on_success)
     if ((valid_file == holiday_rules_validatefile(holidayrulefile))) {
         holiday_rules_getfields(holidayrulefile, &activerules_h);
         holiday_tbl_build(holidayrulefile, holidayhashtable);
+        activerules_h.holidays = holidayhashtable;
+
+        /* calendars compiled from any earlier rules are now stale */
+        if (!activerules_h.cache.initialized)
+            calendar_cache_init(&activerules_h.cache, CAL_DEFAULTBUDGET);
+        else
+            ruleset_invalidate(&activerules_h);
+        calendar_store_open(&activerules_h, holidayrulefile);
     }
     else
         /* address failure */;
@@ -63,6 +88,7 @@ int holiday_rules_open(const char *receivedrulefilename, int close_on_success)
 void holiday_tbl_build(FILE *receivedrulefile,
                        struct HolidayNode *holidayhashtable[])
 {
+    holiday_table_release(holidayhashtable); /* drop any rules loaded before */
     holiday_tbl_init(holidayhashtable);
     holiday_rules_get_tokens(receivedrulefile, holidayhashtable,
                              &activerules_h);
@@ -105,6 +131,12 @@ void holiday_rules_get_tokens(FILE *holidayrulefile,
     struct HolidayRule newholiday;
 
     while (fgets(tokenbuf, sizeof(tokenbuf), holidayrulefile) != NULL) {
+        newholiday.holidayname = ""; /* in case the record lacks them */
+        newholiday.authority = "";
+        newholiday.effective_from = 0; /* in effect for all time */
+        newholiday.effective_until = 0;
+        newholiday.shift = SHIFT_NONE;
+        newholiday.offset = 0;
         do {
             cur_token = holiday_rules_tokenize(tokenbuf, &lasttoken);
             holiday_rules_parse_token(cur_token,
@@ -116,7 +148,10 @@ void holiday_rules_get_tokens(FILE *holidayrulefile,
                 cur_field = 0; /* Reset once we reach the end of the fields */
              }
         } while (!lasttoken);
-        holiday_table_addrule(&holidayhashtable[newholiday.month], &newholiday);
+        if (newholiday.ruletype != 'x') /* skip records with a bad Rule */
+            holiday_table_addrule(
+                &holidayhashtable[holiday_rule_slot(&newholiday)],
+                &newholiday);
         lasttoken=0;
     }
 }
@@ -202,8 +237,9 @@ char *holiday_rules_tokenize(char *string, int *lasttoken)
                                    token. */
                     SET_FLAG(flags, BEGIN_TSTRING);
                     tokenptr = cur_char; /* Set the tokenpointer to the begin of
-                                            the token. */
-                    cur_char++;
+                                            the token, which may be the
+                                            closing delimiter if the token
+                                            is empty. */
                 } else { /* we are at the end of the token */
                     *cur_char = '\0'; /* terminate the token string */
                     SET_FLAG(flags, TOKEN_FOUND);
@@ -259,7 +295,6 @@ void holiday_rules_parse_token(char *token, char *cur_field,
                                 struct HolidayRule *newholiday)
 {
     char *currentchar = token;
-    int idx = 0;
 
     if (*token == NULCHAR) {
         /* THIS SIGNALS AN EMPTY FIELD */
@@ -320,33 +355,93 @@ void holiday_rules_parse_token(char *token, char *cur_field,
                         currentchar++; /* get rid of the dash */
                         newholiday->wknum = ASCII2DECIMAL(*++currentchar);
                         break;
-            case 'x':   /* rule has not been populated yet
-                            error to be handled */
+            case 'o':   /* Absolute Rules Observed on a Weekday */
+                        /* fall through */
+            case 'O':
+                newholiday->wkday = 999;
+                newholiday->wknum = 999;
+                newholiday->day = 0;
+                newholiday->shift = SHIFT_NONE;
+                if (sscanf(currentchar, "%d-%d", &newholiday->day,
+                           &newholiday->shift) != 2 ||
+                        newholiday->day < 1 || newholiday->day > 31 ||
+                        newholiday->shift < SHIFT_NONE ||
+                        newholiday->shift > SHIFT_SATURDAYTOFRIDAY)
+                    newholiday->ruletype = 'x'; /* rejected */
+                break;
+            case 'e':   /* Easter-Relative Rules */
+                        /* fall through */
+            case 'E':
+                newholiday->wkday = 999;
+                newholiday->wknum = 999;
+                newholiday->day = 0;
+                newholiday->offset = 0;
+                if (sscanf(currentchar, "%d", &newholiday->offset) != 1 ||
+                        newholiday->offset < EASTERMINOFFSET ||
+                        newholiday->offset > EASTERMAXOFFSET)
+                    newholiday->ruletype = 'x'; /* rejected */
+                break;
+            case 'x':   /* rule has not been populated yet, or its Rule
+                            field was rejected; the record is skipped */
             default:
                         /* TODO (Thomas#1#): Add error processing in case the
                             rule is not in the proper format. */
                         break;
                 }
     } else if (strcmp(cur_field, HF_HOLIDAY) == 0) {
-        while(*currentchar) {
-            newholiday->holidayname[idx] = *currentchar;
-            currentchar++;
-            idx++; 
-        }
-        newholiday->holidayname[idx] = '\0';    
+        newholiday->holidayname = stringpool_intern(token);
     }  else if (strcmp(cur_field, HF_AUTHORITY) == 0) {
-        while(*currentchar) {
-            newholiday->authority[idx] = *currentchar;
-            currentchar++;
-            idx++; 
-        }
-        newholiday->authority[idx] = '\0';    
+        newholiday->authority = stringpool_intern(token);
+    }  else if (strcmp(cur_field, HF_FROM) == 0) {
+        newholiday->effective_from = holiday_rules_parse_date(token, 0);
+    }  else if (strcmp(cur_field, HF_UNTIL) == 0) {
+        newholiday->effective_until = holiday_rules_parse_date(token, 1);
     }  else {
 	    /* Error field name not defined */
     } 
     return;
 }
 
+/*
+ * Description: Returns the hash table list a rule belongs in: its month, or
+ * ALLMONTHS for the rules whose dates can fall in other months (an observed
+ * holiday can move into the month before or after, and Easter moves).
+ */
+
+int holiday_rule_slot(const struct HolidayRule *rule)
+{
+    switch (rule->ruletype) {
+        case 'o': /* fall through */
+        case 'O': /* fall through */
+        case 'e': /* fall through */
+        case 'E':
+            return ALLMONTHS;
+        default:
+            return rule->month;
+    }
+}
+
+/*
+ * Description: Parses an effective date, either YYYY-MM-DD or just YYYY, into
+ * the YYYYMMDD form the rules keep.  A year alone means January 1 of that
+ * year, or December 31 if it ends a range.
+ *
+ * Returns: The date, or 0 (no limit) if the field is empty or not a date.
+ */
+
+int holiday_rules_parse_date(const char *token, int endofrange)
+{
+    int year;
+    int month = endofrange ? DECEMBER : JANUARY;
+    int day = endofrange ? 31 : 1;
+
+    if (sscanf(token, "%d-%d-%d", &year, &month, &day) < 1 ||
+            year < 1 || year > 9999 || month < JANUARY || month > DECEMBER ||
+            day < 1 || day > 31)
+        return 0;
+    return year * 10000 + month * 100 + day;
+}
+
 void holiday_table_addrule(struct HolidayNode **elementhandle,
                                     struct HolidayRule *newrule)
 {
@@ -360,16 +455,21 @@ void holiday_table_addrule(struct HolidayNode **elementhandle,
     newnode->rule.wkday  = newrule->wkday;
     newnode->rule.wknum = newrule->wknum;
     newnode->rule.day = newrule->day;
-    strcpy(newnode->rule.holidayname, newrule->holidayname);
-    strcpy(newnode->rule.authority, newrule->authority);
-
-    if (*elementhandle == NULL) {
-        (*elementhandle) = newnode; /* makes the new node the first node */
-        newnode->nextrule = NULL; /* newnode is the end of the list. */
-    } else {
-        newnode->nextrule = (*elementhandle)->nextrule;
-        (*elementhandle)->nextrule = newnode; /* inserts new node as first node */
-    }
+    newnode->rule.holidayname = newrule->holidayname;
+    newnode->rule.authority = newrule->authority;
+    newnode->rule.effective_from = newrule->effective_from;
+    newnode->rule.effective_until = newrule->effective_until;
+    newnode->rule.shift = newrule->shift;
+    newnode->rule.offset = newrule->offset;
+    newnode->checks = 0;
+    newnode->hits = 0;
+    newnode->nextrule = NULL; /* newnode is the end of the list. */
+
+    /* append, so rules are tested in the order they appear in the file until
+     * holiday_rules_reorder() says otherwise */
+    while (*elementhandle != NULL)
+        elementhandle = &(*elementhandle)->nextrule;
+    *elementhandle = newnode;
 
     return;
 }
@@ -526,58 +626,296 @@ int holiday_rules_closefile(FILE *holidayrulefile)
  * sub-field of the rule can contain (1) the week number e.g., 4 for the 4th
  * week, (2) the word "all" for every week- day of the month (e.g., all
  * Saturdays), (3) "last" for the last week-day (e.g., last Monday), or (4)
- * "first" for the first week-day (e.g., first Tuesday).
+ * "first" for the first week-day (e.g., first Tuesday).  An observed (O)
+ * rule is Day-Shift, the shift being an OBSERVEDSHIFT, and an Easter (E)
+ * rule is the number of days from Easter Sunday, e.g., -2 for Good Friday.
  */
 
-int holiday_tbl_checkrule(struct DateTime *dt, struct HolidayNode *rulenode)
+/*
+ * Description: Tests a date against a list of rules, counting each rule's
+ * checks and hits in the rule itself or, if checks and hits are given, in
+ * those arrays by the rule's place in the list (see struct RuleTally).
+ */
+
+int holiday_tbl_checkrule(struct DateTime *dt, struct HolidayNode *rulenode,
+                          unsigned long checks[], unsigned long hits[])
 {
 
     struct HolidayNode *rulecheck;
+    int place = 0;
     
     rulecheck = rulenode;
     while (rulecheck != NULL) {
-        switch (rulecheck->rule.ruletype)
-            {
-                case 'a': /* fall through */
-                case 'A':
-                    if (rulecheck->rule.day == dt->day)
-                        return 1;
-                    break;
-                case 'r': /* fall through */
-                case 'R':
-                    if (rulecheck->rule.wkday == dt->day_of_week)
+        if (checks != NULL && place < RULETALLY)
+            checks[place]++;
+        else
+            ATOMIC_ADD(&rulecheck->checks, 1UL);
+        if (holiday_rule_matches(dt, &rulecheck->rule)) {
+            if (hits != NULL && place < RULETALLY)
+                hits[place]++;
+            else
+                ATOMIC_ADD(&rulecheck->hits, 1UL);
+            return 1;
+        }
+        rulecheck = rulecheck->nextrule;
+        place++;
+    }
+    return 0;
+}
+
+/* Adds a compile's tallies to the rules' counts, and clears them */
+void holiday_tally_fold(struct RuleTally *tally,
+                        struct HolidayNode *holidayhashtable[])
+{
+    struct HolidayNode *node;
+    int monthctr;
+    int place;
+
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = holidayhashtable[monthctr], place = 0;
+                node != NULL && place < RULETALLY;
+                node = node->nextrule, place++) {
+            if (tally->checks[monthctr][place] != 0)
+                ATOMIC_ADD(&node->checks, tally->checks[monthctr][place]);
+            if (tally->hits[monthctr][place] != 0)
+                ATOMIC_ADD(&node->hits, tally->hits[monthctr][place]);
+        }
+    }
+    memset(tally, 0, sizeof(*tally));
+    return;
+}
+
+/* Whether a date falls within a rule's effective dates */
+static int holiday_rule_ineffect(const struct DateTime *dt,
+                                 const struct HolidayRule *rule)
+{
+    int date = dt->year * 10000 + dt->month * 100 + dt->day;
+
+    if (rule->effective_from != 0 && date < rule->effective_from)
+        return 0;
+    if (rule->effective_until != 0 && date > rule->effective_until)
+        return 0;
+    return 1;
+}
+
+/*
+ * Description: The JDN of Easter Sunday in a Gregorian year.
+ *
+ * References: The "anonymous Gregorian algorithm" (Meeus, "Astronomical
+ * Algorithms", ch. 8), which needs no tables and holds for every year of
+ * the Gregorian calendar.
+ */
+
+static int easter_jdn(int year)
+{
+    struct DateTime easter;
+    int a, b, c, d, e, f, g, h, i, k, l, m;
+
+    a = year % 19;
+    b = year / 100;
+    c = year % 100;
+    d = b / 4;
+    e = b % 4;
+    f = (b + 8) / 25;
+    g = (b - f + 1) / 3;
+    h = (19 * a + b - d - g + 15) % 30;
+    i = c / 4;
+    k = c % 4;
+    l = (32 + 2 * e + 2 * i - h - k) % 7;
+    m = (a + 11 * h + 22 * l) / 451;
+
+    easter.year = year;
+    easter.month = (h + l - 7 * m + 114) / 31;
+    easter.day = (h + l - 7 * m + 114) % 31 + 1;
+    return jdncnvrt(&easter);
+}
+
+/*
+ * Description: Tests an observed-holiday rule: the holiday itself, or the
+ * Friday before or the Monday after it if it falls on a weekend and the
+ * rule's shift moves it there.  The holiday may be in the next month or year
+ * (New Year's Day observed on December 31) or the one before.
+ */
+
+static int holiday_rule_observed(struct DateTime *dt,
+                                 const struct HolidayRule *rule)
+{
+    struct DateTime holiday;
+
+    if (dt->month == rule->month && dt->day == rule->day)
+        return 1;
+    if (dt->day_of_week == FRIDAY && (rule->shift == SHIFT_NEAREST ||
+                rule->shift == SHIFT_SATURDAYTOFRIDAY))
+        jdn2greg(jdncnvrt(dt) + 1, &holiday);
+    else if (dt->day_of_week == MONDAY && (rule->shift == SHIFT_NEAREST ||
+                rule->shift == SHIFT_SUNDAYTOMONDAY))
+        jdn2greg(jdncnvrt(dt) - 1, &holiday);
+    else
+        return 0;
+    return holiday.month == rule->month && holiday.day == rule->day;
+}
+
+/*
+ * Description: Tests a single rule against a date, without touching the
+ * rule's statistics.
+ *
+ * Precondition: the day_of_week member of dt must be set.
+ */
+
+int holiday_rule_matches(struct DateTime *dt, const struct HolidayRule *rule)
+{
+    switch (rule->ruletype)
+        {
+            case 'a': /* fall through */
+            case 'A':
+                if (rule->day == dt->day)
+                    return holiday_rule_ineffect(dt, rule);
+                break;
+            case 'r': /* fall through */
+            case 'R':
+                if (rule->wkday == dt->day_of_week)
+                {
+                    /* previous line tests to see if day of week matches. */
+                    if ((rule->wknum == LASTWEEK) && islastxdom(dt))
+                    {
+                        return holiday_rule_ineffect(dt, rule);
+                    }
+                    else if (dt->day >= ((rule->wknum-1) * WEEKDAYS+1) &&
+                            dt->day <= (rule->wknum * WEEKDAYS))
                     {
-                        /* previous line tests to see if day of week matches. */
-                        if ((rulecheck->rule.wknum == LASTWEEK)
-                             && islastxdom(dt))
-                        {
-                            return 1;
-                        }
-                        else if (dt->day >=
-                                ((rulecheck->rule.wknum-1) * WEEKDAYS+1) &&
-                                dt->day <= (rulecheck->rule.wknum * WEEKDAYS))
-                        {
-                            /* Prev. line tests to see if the day is in the
-                            proper week. The formula "(wknum-1)*7+1" gets the
-                            first day of the applicable week; "wknum*7"
-                            calculates the last day of the applicable week.  */
-
-                            return 1;
-                        }
+                        /* Prev. line tests to see if the day is in the
+                        proper week. The formula "(wknum-1)*7+1" gets the
+                        first day of the applicable week; "wknum*7"
+                        calculates the last day of the applicable week.  */
+
+                        return holiday_rule_ineffect(dt, rule);
                     }
-                    break;
-                case 'w': /* fall through */
-                case 'W':
-                    if(rulecheck->rule.wkday == dt->day_of_week)
-                        return 1;
-                    break;
-                default:
-                    /* fall through */
-                    break;
+                }
+                break;
+            case 'w': /* fall through */
+            case 'W':
+                if(rule->wkday == dt->day_of_week)
+                    return holiday_rule_ineffect(dt, rule);
+                break;
+            case 'o': /* fall through */
+            case 'O':
+                if (holiday_rule_observed(dt, rule))
+                    return holiday_rule_ineffect(dt, rule);
+                break;
+            case 'e': /* fall through */
+            case 'E':
+                if (jdncnvrt(dt) == easter_jdn(dt->year) + rule->offset)
+                    return holiday_rule_ineffect(dt, rule);
+                break;
+            default:
+                /* fall through */
+                break;
+        }
+    return 0;
+}
+
+/*
+ * Description: Relative cost of testing a rule; relative rules may have to
+ * work out whether the date falls in the last week of the month, and observed
+ * and Easter rules convert dates to day numbers.
+ */
+
+static int holiday_rule_cost(const struct HolidayRule *rule)
+{
+    switch (rule->ruletype) {
+        case 'r': /* fall through */
+        case 'R':
+            return 1;
+        case 'o': /* fall through */
+        case 'O': /* fall through */
+        case 'e': /* fall through */
+        case 'E':
+            return 2; /* date arithmetic */
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Description: Reorders each list of rules so that the rules that have
+ * matched the most dates come first, and among rules that have matched
+ * equally often, the cheaper ones.  Since a date is a holiday as soon as any
+ * rule matches, the order never changes a result, only how many rules are
+ * tested to reach it.
+ *
+ * Algorithm: Insertion sort of each linked list.  The lists are short and,
+ * after the first pass, already nearly in order.
+ */
+
+void holiday_rules_reorder(void)
+{
+    struct HolidayNode *sorted;
+    struct HolidayNode *node;
+    struct HolidayNode **link;
+    int monthctr;
+
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        sorted = NULL;
+        while (holidayhashtable[monthctr] != NULL) {
+            node = holidayhashtable[monthctr];
+            holidayhashtable[monthctr] = node->nextrule;
+
+            link = &sorted;
+            while (*link != NULL && ((*link)->hits > node->hits ||
+                        ((*link)->hits == node->hits &&
+                         holiday_rule_cost(&(*link)->rule) <=
+                         holiday_rule_cost(&node->rule))))
+                link = &(*link)->nextrule;
+            node->nextrule = *link;
+            *link = node;
+        }
+        holidayhashtable[monthctr] = sorted;
+    }
+    return;
+}
+
+int holiday_rules_get_stats(struct HolidayRuleStats stats[], int maxrules)
+{
+    struct HolidayNode *node;
+    int monthctr;
+    int numrules = 0;
+
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = holidayhashtable[monthctr]; node != NULL;
+                node = node->nextrule) {
+            if (numrules < maxrules) {
+                strncpy(stats[numrules].holidayname, node->rule.holidayname,
+                        sizeof(stats[numrules].holidayname) - 1);
+                stats[numrules].holidayname[
+                    sizeof(stats[numrules].holidayname) - 1] = NULCHAR;
+                strncpy(stats[numrules].authority, node->rule.authority,
+                        sizeof(stats[numrules].authority) - 1);
+                stats[numrules].authority[
+                    sizeof(stats[numrules].authority) - 1] = NULCHAR;
+                stats[numrules].month = node->rule.month;
+                stats[numrules].ruletype = node->rule.ruletype;
+                stats[numrules].checks = ATOMIC_LOAD_RELAXED(&node->checks);
+                stats[numrules].hits = ATOMIC_LOAD_RELAXED(&node->hits);
             }
-        rulecheck = rulecheck->nextrule;
+            numrules++;
+        }
     }
-    return 0;
+    return numrules;
+}
+
+void holiday_rules_reset_stats(void)
+{
+    struct HolidayNode *node;
+    int monthctr;
+
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = holidayhashtable[monthctr]; node != NULL;
+                node = node->nextrule) {
+            ATOMIC_STORE_RELAXED(&node->checks, 0UL);
+            ATOMIC_STORE_RELAXED(&node->hits, 0UL);
+        }
+    }
+    return;
 }
 
 
@@ -1074,38 +1412,159 @@ int islastweek(struct DateTime *dt)
     return 0;
 }
 
+/*
+ * Description: Determines whether a date is a holiday or weekend under the
+ * rules loaded by holiday_rules_open().  See holiday_ruleset_isholiday().
+ */
+
 int isholiday(struct DateTime *dt)
 {
-    struct HolidayNode *nodecheckptr;
+    return holiday_ruleset_isholiday(&activerules_h, dt);
+}
 
-    /* First, calculate whether this date falls on a weekend */ 
-    set_weekday(dt);
-    /* if (isweekend(dt))
-        return 1;
-        commented out because I need to see if when there is an official "rule"
-        version picks up the weekend as a holiday. */
+int next_courtday(struct DateTime *dt, struct DateTime *result)
+{
+    return holiday_ruleset_next_courtday(&activerules_h, dt, result);
+}
 
-    /* Second, calculate whether an ALLMONTHS rule applies and whether this date
-    falls on a weekend */
+int prev_courtday(struct DateTime *dt, struct DateTime *result)
+{
+    return holiday_ruleset_prev_courtday(&activerules_h, dt, result);
+}
 
-    nodecheckptr = holidayhashtable[ALLMONTHS];
-    while(nodecheckptr != NULL)
-        {
-            if (holiday_tbl_checkrule(dt,nodecheckptr) == 1)
-                return 1;
-            nodecheckptr = nodecheckptr->nextrule;
-        }
+int nearest_courtday(struct DateTime *dt, struct DateTime *result)
+{
+    return holiday_ruleset_nearest_courtday(&activerules_h, dt, result);
+}
+
+int nth_courtday_in_period(int year, int periodkind, int period, int n,
+                           struct DateTime *result)
+{
+    return holiday_ruleset_nth_courtday(&activerules_h, year, periodkind,
+                                        period, n, result);
+}
 
-    /* Third, calculate whether there are any holidays on the month of the
-        argument's date */
+int courtday_ordinal(struct DateTime *dt, int periodkind)
+{
+    return holiday_ruleset_courtday_ordinal(&activerules_h, dt, periodkind);
+}
 
-    nodecheckptr = holidayhashtable[dt->month];
-    while(nodecheckptr != NULL)
-        {
-            if (holiday_tbl_checkrule(dt,nodecheckptr) == 1)
-                return 1;
-            nodecheckptr = nodecheckptr->nextrule;
-        }
+int evaluate_deadlines(const struct HolidayChain *chain,
+                       struct DateTime *trigger, int jdns[])
+{
+    return holiday_ruleset_evaluate_deadlines(&activerules_h, chain, trigger,
+                                              jdns);
+}
+
+int latest_courtday_start(struct DateTime *target, int numdays,
+                          struct DateTime *result)
+{
+    return holiday_ruleset_latest_courtday_start(&activerules_h, target,
+                                                 numdays, result);
+}
+
+int earliest_courtday_start(struct DateTime *target, int numdays,
+                            struct DateTime *result)
+{
+    return holiday_ruleset_earliest_courtday_start(&activerules_h, target,
+                                                   numdays, result);
+}
+
+int tolled_courtday_offset(struct DateTime *orig_date,
+                           struct DateTime *calc_date, int numdays,
+                           const struct HolidayTolledPeriod tolled[],
+                           int numtolled)
+{
+    return holiday_ruleset_tolled_courtday_offset(&activerules_h, orig_date,
+                                                  calc_date, numdays, tolled,
+                                                  numtolled);
+}
+
+int latest_trigger(const struct HolidayChain *chain, int deadline,
+                   struct DateTime *target, struct DateTime *trigger)
+{
+    return holiday_ruleset_latest_trigger(&activerules_h, chain, deadline,
+                                          target, trigger);
+}
+
+int earliest_trigger(const struct HolidayChain *chain, int deadline,
+                     struct DateTime *target, struct DateTime *trigger)
+{
+    return holiday_ruleset_earliest_trigger(&activerules_h, chain, deadline,
+                                            target, trigger);
+}
+
+int offset_fanout(struct DateTime *orig_date, int step, const int offsets[],
+                  int count, struct DateTime results[])
+{
+    return holiday_ruleset_offset_fanout(&activerules_h, orig_date, step,
+                                         offsets, count, results);
+}
+
+int evaluate_deadlines_columns(const struct HolidayChain *chain,
+                               const int triggerjdns[], int numcases,
+                               int *columns[])
+{
+    return holiday_ruleset_evaluate_deadlines_columns(&activerules_h, chain,
+                                                      triggerjdns, numcases,
+                                                      columns);
+}
+
+struct HolidayChainInstance *track_deadlines(const struct HolidayChain *chain,
+                                             struct DateTime *trigger)
+{
+    return holiday_chain_instance_create(&activerules_h, chain, trigger);
+}
+
+int evaluate_deadlines_batch(const struct HolidayChain *chain,
+                             const int triggerjdns[], int numcases,
+                             int jdns[], int numthreads,
+                             struct HolidayChainWorkerStats stats[])
+{
+    return holiday_ruleset_evaluate_deadlines_batch(&activerules_h, chain,
+                                                    triggerjdns, numcases,
+                                                    jdns, numthreads, stats);
+}
+
+int holiday_explain(struct DateTime *dt, struct HolidayExplanation *why)
+{
+    return holiday_ruleset_explain(&activerules_h, dt, why);
+}
+
+int enumerate_days(struct HolidayEnumeration *cursor, int dates[],
+                   int maxdates)
+{
+    return holiday_ruleset_enumerate(&activerules_h, cursor, dates, maxdates);
+}
+
+/*
+ * Description: Checks a date against the holiday rules, first the ALLMONTHS
+ * rules (e.g., weekends) and then the rules for the date's month.
+ *
+ * Precondition: the day_of_week member of dt must be set.
+ */
+
+int holiday_tbl_evaluate(struct DateTime *dt,
+                         struct HolidayNode *holidayhashtable[])
+{
+    return holiday_tbl_evaluate_tallied(dt, holidayhashtable, NULL);
+}
+
+/* holiday_tbl_evaluate(), tallying the rules' statistics if tally is given */
+int holiday_tbl_evaluate_tallied(struct DateTime *dt,
+                                 struct HolidayNode *holidayhashtable[],
+                                 struct RuleTally *tally)
+{
+    if (holiday_tbl_checkrule(dt, holidayhashtable[ALLMONTHS],
+                tally != NULL ? tally->checks[ALLMONTHS] : NULL,
+                tally != NULL ? tally->hits[ALLMONTHS] : NULL) == 1)
+        return 1;
+
+    if (dt->month >= JANUARY && dt->month <= DECEMBER &&
+            holiday_tbl_checkrule(dt, holidayhashtable[dt->month],
+                tally != NULL ? tally->checks[dt->month] : NULL,
+                tally != NULL ? tally->hits[dt->month] : NULL) == 1)
+        return 1;
 
     return 0;
 }
@@ -1222,7 +1681,19 @@ void printholidayrules(void)
                    tempnode->rule.holidayname);
             printf("The applicable ruletype is %c.\n",
                    tempnode->rule.ruletype);
-            if ((tempnode->rule.ruletype != 'a') &&
+            if ((tempnode->rule.ruletype == 'o') ||
+                    (tempnode->rule.ruletype == 'O'))
+            {
+                printf("The Day is %d, observed with shift %d.\n",
+                       tempnode->rule.day, tempnode->rule.shift);
+            }
+            else if ((tempnode->rule.ruletype == 'e') ||
+                    (tempnode->rule.ruletype == 'E'))
+            {
+                printf("The Day is %d days from Easter Sunday.\n",
+                       tempnode->rule.offset);
+            }
+            else if ((tempnode->rule.ruletype != 'a') &&
                     (tempnode->rule.ruletype != 'A'))
             {
                 printf("The applicable weekday is %d.\n",
@@ -1236,6 +1707,12 @@ void printholidayrules(void)
             }
             printf("The governing authority is %s.\n",
                    tempnode->rule.authority);
+            if (tempnode->rule.effective_from != 0)
+                printf("In effect from %d.\n",
+                       tempnode->rule.effective_from);
+            if (tempnode->rule.effective_until != 0)
+                printf("In effect until %d.\n",
+                       tempnode->rule.effective_until);
             printf("\n");
             /* move to the next node */
             tempnode = tempnode->nextrule;
@@ -0,0 +1,241 @@
+/*
+ * Filename: lanes.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 17:02:51
+ * Last Modified: Mon Oct 19 17:02:51 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Bit-sliced calendars, which answer a question about a date for up
+ * to one machine word's worth of rule sets (one per bit lane) at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+#define LANECOUNTERBITS 32 /* bit planes in the court-day counters */
+
+/*-----------------------------------------------------------------------------
+ * Lane Helpers
+ *----------------------------------------------------------------------------*/
+
+/* Works out a day's lane mask from the rule sets, for days outside the span */
+static unsigned long lanes_compute(const struct HolidayLanes *lanes, int jdn)
+{
+    struct DateTime dt;
+    unsigned long closed = 0;
+    int lane;
+
+    jdn2greg(jdn, &dt);
+    for (lane = 0; lane < lanes->numlanes; lane++) {
+        if (holiday_ruleset_isholiday(lanes->rules[lane], &dt))
+            closed |= 1UL << lane;
+    }
+    return closed;
+}
+
+static unsigned long lanes_closed_jdn(const struct HolidayLanes *lanes,
+                                      int jdn)
+{
+    if (jdn >= lanes->firstjdn && jdn - lanes->firstjdn < lanes->numdays)
+        return lanes->closed[jdn - lanes->firstjdn];
+    return lanes_compute(lanes, jdn);
+}
+
+/*
+ * Description: Transposes one lane's year calendar into the lane bitmaps,
+ * visiting only the closed days.
+ */
+
+static void lanes_transpose(struct HolidayLanes *lanes,
+                            const struct YearCalendar *cal, int lane)
+{
+    unsigned long *day;
+    unsigned long bits;
+    int word;
+
+    day = &lanes->closed[cal->jdn - lanes->firstjdn];
+    for (word = 0; word < (int) CAL_WORDS; word++) {
+        bits = cal->closed[word];
+        while (bits != 0) {
+            day[word * CAL_WORDBITS + __builtin_ctzl(bits)] |= 1UL << lane;
+            bits &= bits - 1; /* clear the lowest set bit */
+        }
+    }
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Lane Interface
+ *----------------------------------------------------------------------------*/
+
+struct HolidayLanes *holiday_lanes_build(struct RuleSet *rules[], int numlanes,
+                                         int firstyear, int lastyear)
+{
+    struct HolidayLanes *lanes;
+    struct YearCalendar scratch;
+    const struct YearCalendar *cal;
+    struct DateTime dt;
+    int year;
+    int lane;
+
+    if (numlanes < 1 || numlanes > CAL_WORDBITS || firstyear < CAL_MINYEAR ||
+            lastyear > CAL_MAXYEAR || firstyear > lastyear)
+        return NULL;
+    for (lane = 0; lane < numlanes; lane++) {
+        if (rules[lane] == NULL)
+            return NULL;
+    }
+
+    lanes = calloc(1, sizeof(*lanes));
+    if (lanes == NULL)
+        return NULL;
+    lanes->numlanes = numlanes;
+    lanes->lanemask = numlanes == CAL_WORDBITS ? ~0UL :
+        (1UL << numlanes) - 1;
+    memcpy(lanes->rules, rules, (size_t) numlanes * sizeof(rules[0]));
+
+    dt.year = firstyear;
+    dt.month = JANUARY;
+    dt.day = 1;
+    lanes->firstjdn = jdncnvrt(&dt);
+    dt.year = lastyear + 1;
+    lanes->numdays = jdncnvrt(&dt) - lanes->firstjdn;
+    lanes->closed = calloc((size_t) lanes->numdays, sizeof(unsigned long));
+    if (lanes->closed == NULL) {
+        free(lanes);
+        return NULL;
+    }
+
+    for (year = firstyear; year <= lastyear; year++) {
+        for (lane = 0; lane < numlanes; lane++) {
+            cal = calendar_cache_get(rules[lane], year, &scratch);
+            if (cal == NULL) { /* no cache budget; compile it here */
+                calendar_compile(rules[lane], &scratch, year);
+                cal = &scratch;
+            }
+            lanes_transpose(lanes, cal, lane);
+        }
+    }
+    return lanes;
+}
+
+void holiday_lanes_release(struct HolidayLanes *lanes)
+{
+    if (lanes == NULL)
+        return;
+    free(lanes->closed);
+    free(lanes);
+    return;
+}
+
+unsigned long holiday_lanes_closed(const struct HolidayLanes *lanes,
+                                   struct DateTime *dt)
+{
+    return lanes_closed_jdn(lanes, jdncnvrt(dt));
+}
+
+void holiday_lanes_closed_batch(const struct HolidayLanes *lanes,
+                                const int jdns[], unsigned long closed[],
+                                int count)
+{
+    int idx;
+
+    for (idx = 0; idx < count; idx++)
+        closed[idx] = lanes_closed_jdn(lanes, jdns[idx]);
+    return;
+}
+
+/*
+ * Description: courtday_offset() in every lane at once.
+ *
+ * Algorithm: Each lane's count of court days so far is kept bit-sliced:
+ * plane[k] holds bit k of every lane's counter.  Each day, the lanes for
+ * which the day is a court day are incremented together by a ripple-carry
+ * add across the planes, and the lanes whose counters now equal numdays are
+ * found by comparing the planes against numdays' bits.  Those lanes have
+ * their answer and drop out; the walk stops once every lane has dropped out,
+ * or at the end of 1753 - 9999, where the lanes still counting are given a
+ * jdn of -1.  A day costs a few word operations per counter bit, however
+ * many lanes there are.
+ */
+
+int holiday_lanes_courtday_offset(const struct HolidayLanes *lanes,
+                                  struct DateTime *orig_date, int numdays,
+                                  struct DateTime results[])
+{
+    unsigned long plane[LANECOUNTERBITS];
+    unsigned long active;
+    unsigned long carry;
+    unsigned long reached;
+    unsigned long target;
+    unsigned long newcarry;
+    struct DateTime edge;
+    int numplanes;
+    int fwd_back;
+    int edgejdn;
+    int jdn;
+    int lane;
+    int bit;
+
+    orig_date->jdn = jdncnvrt(orig_date);
+    if (numdays == 0) {
+        for (lane = 0; lane < lanes->numlanes; lane++)
+            ruleset_courtday_result(orig_date->jdn, &results[lane]);
+        return 0;
+    }
+    fwd_back = numdays > 0 ? 1 : -1;
+    target = (unsigned long) (numdays > 0 ? numdays : -numdays);
+    for (numplanes = 0; numplanes < LANECOUNTERBITS &&
+            (target >> numplanes) != 0; numplanes++)
+        plane[numplanes] = 0;
+    edge.year = numdays > 0 ? CAL_MAXYEAR : CAL_MINYEAR;
+    edge.month = numdays > 0 ? DECEMBER : JANUARY;
+    edge.day = numdays > 0 ? 31 : 1;
+    edgejdn = jdncnvrt(&edge);
+
+    active = lanes->lanemask;
+    jdn = orig_date->jdn;
+    while (active != 0 && (edgejdn - jdn) * fwd_back > 0) {
+        jdn += fwd_back;
+        carry = ~lanes_closed_jdn(lanes, jdn) & active;
+        if (carry == 0)
+            continue;
+
+        reached = carry; /* only lanes that just counted can reach target */
+        for (bit = 0; bit < numplanes; bit++) {
+            newcarry = plane[bit] & carry;
+            plane[bit] ^= carry;
+            carry = newcarry;
+            reached &= (target >> bit) & 1UL ? plane[bit] : ~plane[bit];
+        }
+
+        active &= ~reached;
+        while (reached != 0) {
+            lane = __builtin_ctzl(reached);
+            ruleset_courtday_result(jdn, &results[lane]);
+            reached &= reached - 1;
+        }
+    }
+
+    if (active == 0)
+        return 0;
+    while (active != 0) { /* ran off the end of the calendar */
+        lane = __builtin_ctzl(active);
+        memset(&results[lane], 0, sizeof(results[lane]));
+        results[lane].jdn = -1;
+        active &= active - 1;
+    }
+    return -1;
+}
@@ -0,0 +1,359 @@
+/*
+ * Filename: overlay.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 18:20:37
+ * Last Modified: Mon Oct 19 18:20:37 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Closure overlays: one-off closed and forced-open dates layered on a
+ * rule set's calendar, e.g., for a fire, a power outage, or a courtroom's
+ * dark days.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+/*-----------------------------------------------------------------------------
+ * The Overlay Tree
+ *----------------------------------------------------------------------------*/
+
+static int overlay_height(const struct OverlayNode *node)
+{
+    return node != NULL ? node->height : 0;
+}
+
+static int overlay_sum(const struct OverlayNode *node)
+{
+    return node != NULL ? node->sum : 0;
+}
+
+/* Recomputes a node's height and subtree sum from its children */
+static void overlay_update(struct OverlayNode *node)
+{
+    int left = overlay_height(node->left);
+    int right = overlay_height(node->right);
+
+    node->height = 1 + (left > right ? left : right);
+    node->sum = node->delta + overlay_sum(node->left) + overlay_sum(node->right);
+    return;
+}
+
+static struct OverlayNode *overlay_rotate_right(struct OverlayNode *node)
+{
+    struct OverlayNode *pivot = node->left;
+
+    node->left = pivot->right;
+    pivot->right = node;
+    overlay_update(node);
+    overlay_update(pivot);
+    return pivot;
+}
+
+static struct OverlayNode *overlay_rotate_left(struct OverlayNode *node)
+{
+    struct OverlayNode *pivot = node->right;
+
+    node->right = pivot->left;
+    pivot->left = node;
+    overlay_update(node);
+    overlay_update(pivot);
+    return pivot;
+}
+
+/* Restores the AVL balance at a node whose subtrees differ in height by at
+ * most two, returning the subtree's new root */
+static struct OverlayNode *overlay_balance(struct OverlayNode *node)
+{
+    int balance;
+
+    overlay_update(node);
+    balance = overlay_height(node->left) - overlay_height(node->right);
+    if (balance > 1) {
+        if (overlay_height(node->left->left) <
+                overlay_height(node->left->right))
+            node->left = overlay_rotate_left(node->left);
+        return overlay_rotate_right(node);
+    }
+    if (balance < -1) {
+        if (overlay_height(node->right->right) <
+                overlay_height(node->right->left))
+            node->right = overlay_rotate_right(node->right);
+        return overlay_rotate_left(node);
+    }
+    return node;
+}
+
+/*
+ * Description: Sets a date's state, using *spare for the node if the date is
+ * not in the tree yet (and then setting *spare to NULL).
+ *
+ * Return: The subtree's new root.
+ */
+
+static struct OverlayNode *overlay_put(struct OverlayNode *node, int jdn,
+                                       int state, int delta,
+                                       struct OverlayNode **spare)
+{
+    if (node == NULL) {
+        node = *spare;
+        *spare = NULL;
+        node->jdn = jdn;
+        node->state = state;
+        node->delta = delta;
+        node->left = NULL;
+        node->right = NULL;
+        overlay_update(node);
+        return node;
+    }
+    if (jdn < node->jdn) {
+        node->left = overlay_put(node->left, jdn, state, delta, spare);
+    } else if (jdn > node->jdn) {
+        node->right = overlay_put(node->right, jdn, state, delta, spare);
+    } else {
+        node->state = state;
+        node->delta = delta;
+    }
+    return overlay_balance(node);
+}
+
+static struct OverlayNode *overlay_remove_min(struct OverlayNode *node,
+                                              struct OverlayNode **min)
+{
+    if (node->left == NULL) {
+        *min = node;
+        return node->right;
+    }
+    node->left = overlay_remove_min(node->left, min);
+    return overlay_balance(node);
+}
+
+/* Unlinks a date's node, if any, into *removed */
+static struct OverlayNode *overlay_remove(struct OverlayNode *node, int jdn,
+                                          struct OverlayNode **removed)
+{
+    struct OverlayNode *successor;
+    struct OverlayNode *right;
+
+    if (node == NULL)
+        return NULL;
+    if (jdn < node->jdn) {
+        node->left = overlay_remove(node->left, jdn, removed);
+    } else if (jdn > node->jdn) {
+        node->right = overlay_remove(node->right, jdn, removed);
+    } else {
+        *removed = node;
+        if (node->left == NULL)
+            return node->right;
+        if (node->right == NULL)
+            return node->left;
+        right = overlay_remove_min(node->right, &successor);
+        successor->left = node->left;
+        successor->right = right;
+        return overlay_balance(successor);
+    }
+    return overlay_balance(node);
+}
+
+static const struct OverlayNode *overlay_find(const struct OverlayNode *node,
+                                              int jdn)
+{
+    while (node != NULL && node->jdn != jdn)
+        node = jdn < node->jdn ? node->left : node->right;
+    return node;
+}
+
+/* Totals delta over the dates up to and including jdn */
+static int overlay_prefix(const struct OverlayNode *node, int jdn)
+{
+    int sum = 0;
+
+    while (node != NULL) {
+        if (node->jdn <= jdn) {
+            sum += overlay_sum(node->left) + node->delta;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+    return sum;
+}
+
+static void overlay_free(struct OverlayNode *node)
+{
+    if (node == NULL)
+        return;
+    overlay_free(node->left);
+    overlay_free(node->right);
+    free(node);
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+ * Overlay Helpers
+ *----------------------------------------------------------------------------*/
+
+/* How many court days a date in the given state adds to the base's count */
+static int overlay_delta(struct RuleSet *base, int jdn, int state)
+{
+    struct DateTime dt;
+    int closed;
+
+    jdn2greg(jdn, &dt);
+    closed = holiday_ruleset_isholiday(base, &dt);
+    if (state == OVERLAY_CLOSED)
+        return closed ? 0 : -1;
+    return closed ? 1 : 0;
+}
+
+static void overlay_refresh_tree(struct RuleSet *base, struct OverlayNode *node)
+{
+    if (node == NULL)
+        return;
+    overlay_refresh_tree(base, node->left);
+    overlay_refresh_tree(base, node->right);
+    node->delta = overlay_delta(base, node->jdn, node->state);
+    overlay_update(node);
+    return;
+}
+
+/* Works the deltas out again if the base has changed since they were.
+ * Caller holds overlay->lock. */
+static void overlay_refresh(struct HolidayOverlay *overlay)
+{
+    unsigned long generation;
+
+    generation = ruleset_generation(overlay->base);
+    if (generation == overlay->basegeneration)
+        return;
+    overlay_refresh_tree(overlay->base, overlay->root);
+    overlay->basegeneration = generation;
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Overlay Interface
+ *----------------------------------------------------------------------------*/
+
+struct HolidayOverlay *holiday_overlay_create(struct RuleSet *base)
+{
+    struct HolidayOverlay *overlay;
+
+    if (base == NULL)
+        return NULL;
+    overlay = calloc(1, sizeof(*overlay));
+    if (overlay == NULL)
+        return NULL;
+    overlay->base = base;
+    overlay->basegeneration = ruleset_generation(base);
+    pthread_mutex_init(&overlay->lock, NULL);
+    return overlay;
+}
+
+void holiday_overlay_release(struct HolidayOverlay *overlay)
+{
+    if (overlay == NULL)
+        return;
+    overlay_free(overlay->root);
+    pthread_mutex_destroy(&overlay->lock);
+    free(overlay);
+    return;
+}
+
+int holiday_overlay_set(struct HolidayOverlay *overlay, struct DateTime *dt,
+                        int state)
+{
+    struct OverlayNode *spare = NULL;
+    struct OverlayNode *removed = NULL;
+    int jdn;
+
+    if (state != OVERLAY_NONE && state != OVERLAY_CLOSED &&
+            state != OVERLAY_OPEN)
+        return -1;
+    jdn = jdncnvrt(dt);
+    if (state != OVERLAY_NONE) {
+        spare = malloc(sizeof(*spare));
+        if (spare == NULL)
+            return -1;
+    }
+
+    pthread_mutex_lock(&overlay->lock);
+    overlay_refresh(overlay);
+    if (state == OVERLAY_NONE) {
+        overlay->root = overlay_remove(overlay->root, jdn, &removed);
+        if (removed != NULL)
+            overlay->numdates--;
+    } else {
+        overlay->root = overlay_put(overlay->root, jdn, state,
+                                    overlay_delta(overlay->base, jdn, state),
+                                    &spare);
+        if (spare == NULL)
+            overlay->numdates++;
+    }
+    pthread_mutex_unlock(&overlay->lock);
+
+    free(spare); /* the date was already in the tree */
+    free(removed);
+    return 0;
+}
+
+int holiday_overlay_isholiday(struct HolidayOverlay *overlay,
+                              struct DateTime *dt)
+{
+    const struct OverlayNode *node;
+    int state = OVERLAY_NONE;
+
+    set_weekday(dt); /* callers rely on it, as with isholiday() */
+    pthread_mutex_lock(&overlay->lock);
+    node = overlay_find(overlay->root, jdncnvrt(dt));
+    if (node != NULL)
+        state = node->state;
+    pthread_mutex_unlock(&overlay->lock);
+
+    if (state != OVERLAY_NONE)
+        return state == OVERLAY_CLOSED;
+    return holiday_ruleset_isholiday(overlay->base, dt);
+}
+
+int holiday_overlay_courtdays(struct HolidayOverlay *overlay,
+                              struct DateTime *first, struct DateTime *last)
+{
+    int firstjdn;
+    int lastjdn;
+    int count;
+
+    firstjdn = jdncnvrt(first);
+    lastjdn = jdncnvrt(last);
+    if (firstjdn > lastjdn)
+        return 0;
+    count = ruleset_courtdays(overlay->base, firstjdn, lastjdn);
+
+    pthread_mutex_lock(&overlay->lock);
+    overlay_refresh(overlay);
+    count += overlay_prefix(overlay->root, lastjdn) -
+        overlay_prefix(overlay->root, firstjdn - 1);
+    pthread_mutex_unlock(&overlay->lock);
+
+    return count;
+}
+
+int holiday_overlay_numdates(struct HolidayOverlay *overlay)
+{
+    int numdates;
+
+    pthread_mutex_lock(&overlay->lock);
+    numdates = overlay->numdates;
+    pthread_mutex_unlock(&overlay->lock);
+    return numdates;
+}
@@ -0,0 +1,157 @@
+/*
+ * Filename: precompute.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 13:40:05
+ * Last Modified: Mon Oct 19 13:40:05 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Compiles a span of years into the calendar cache on a pool of
+ * worker threads while the caller carries on.
+ */
+
+#define _POSIX_C_SOURCE 200809L /* sysconf */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "datetimetools_pvt.h"
+
+#define MAXPRECOMPUTETHREADS 64
+
+struct HolidayPrecompute {
+    struct RuleSet *rules;
+    int firstyear;
+    int lastyear;
+    int nextyear; /* next year to hand to a worker */
+    int running; /* references: busy workers, plus the starter */
+    int ready; /* set once every year is compiled */
+    int numthreads;
+    pthread_t threads[MAXPRECOMPUTETHREADS];
+    void (*ready_callback)(void *userdata);
+    void *userdata;
+};
+
+/*
+ * Description: Drops one reference to the job.  The last one out (worker or
+ * the thread that started the job) marks it ready and runs the callback.
+ */
+
+static void precompute_release(struct HolidayPrecompute *job)
+{
+    if (ATOMIC_ADD(&job->running, -1) == 1) {
+        ATOMIC_STORE(&job->ready, 1);
+        if (job->ready_callback != NULL)
+            job->ready_callback(job->userdata);
+    }
+    return;
+}
+
+/*
+ * Description: Claims years one at a time from the shared counter, compiles
+ * each without any lock, and installs it in the cache.  Years that are already
+ * cached (e.g., because a query got there first) are skipped.
+ */
+
+static void precompute_years(struct HolidayPrecompute *job)
+{
+    struct YearCalendar cal;
+    int year;
+
+    while ((year = ATOMIC_ADD(&job->nextyear, 1)) <= job->lastyear) {
+        if (calendar_cache_holds(job->rules, year))
+            continue;
+        calendar_compile(job->rules, &cal, year);
+        calendar_cache_put(&job->rules->cache, &cal);
+    }
+    return;
+}
+
+static void *precompute_worker(void *arg)
+{
+    struct HolidayPrecompute *job = arg;
+
+    precompute_years(job);
+    precompute_release(job);
+    return NULL;
+}
+
+struct HolidayPrecompute *holiday_cache_precompute(int firstyear, int lastyear,
+                                                   int numthreads,
+                                                   void (*ready)(void *),
+                                                   void *userdata)
+{
+    struct HolidayPrecompute *job;
+    struct CalendarCache *cache = &activerules_h.cache;
+    int started;
+
+    if (firstyear < CAL_MINYEAR)
+        firstyear = CAL_MINYEAR;
+    if (lastyear > CAL_MAXYEAR)
+        lastyear = CAL_MAXYEAR;
+    if (lastyear - firstyear + 1 > cache->numslots)
+        lastyear = firstyear + cache->numslots - 1; /* more would evict */
+    if (numthreads <= 0)
+        numthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (numthreads <= 0)
+        numthreads = 1;
+    if (numthreads > MAXPRECOMPUTETHREADS)
+        numthreads = MAXPRECOMPUTETHREADS;
+    if (numthreads > lastyear - firstyear + 1)
+        numthreads = lastyear - firstyear + 1; /* zero if nothing to do */
+
+    job = calloc(1, sizeof(*job));
+    if (job == NULL)
+        return NULL;
+    job->rules = &activerules_h;
+    job->firstyear = firstyear;
+    job->lastyear = lastyear;
+    job->nextyear = firstyear;
+    job->ready_callback = ready;
+    job->userdata = userdata;
+
+    /* This thread holds a reference until every worker has been started, so
+     * that a quick worker cannot mark the job ready too early. */
+    job->running = 1;
+    for (started = 0; started < numthreads; started++) {
+        ATOMIC_ADD(&job->running, 1);
+        if (pthread_create(&job->threads[started], NULL, precompute_worker,
+                           job) != 0) {
+            ATOMIC_ADD(&job->running, -1);
+            break;
+        }
+    }
+    job->numthreads = started;
+    if (started == 0)
+        precompute_years(job); /* no threads to be had; do it here */
+    precompute_release(job);
+
+    return job;
+}
+
+int holiday_precompute_isready(struct HolidayPrecompute *job)
+{
+    return ATOMIC_LOAD(&job->ready);
+}
+
+void holiday_precompute_wait(struct HolidayPrecompute *job)
+{
+    int idx;
+
+    if (job == NULL)
+        return;
+    for (idx = 0; idx < job->numthreads; idx++)
+        pthread_join(job->threads[idx], NULL);
+    free(job);
+    return;
+}
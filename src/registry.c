@@ -0,0 +1,416 @@
+/*
+ * Filename: registry.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 16:10:22
+ * Last Modified: Mon Oct 19 16:10:22 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: The jurisdiction registry, which loads rule files on first use and
+ * lets jurisdictions with identical rules share compiled calendars, and the
+ * string pool that holds the rules' names and authorities.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+static struct Jurisdiction *registry[REGISTRYBUCKETS];
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t registry_load_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct PooledString *stringpool[STRINGPOOLBUCKETS];
+static size_t stringpoolbytes;
+static pthread_mutex_t stringpool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* What a rule contributes to a calendar, without its name or authority */
+struct RuleKey {
+    int month;
+    int ruletype; /* upper case */
+    int wkday;
+    int wknum;
+    int day;
+    int effective_from;
+    int effective_until;
+    int shift;
+    int offset;
+};
+
+/*-----------------------------------------------------------------------------
+ * Hashing and the String Pool
+ *----------------------------------------------------------------------------*/
+
+/* 32-bit FNV-1a; start with HASH_INIT, or a hash to extend */
+unsigned long hash_bytes(const void *bytes, size_t len, unsigned long hash)
+{
+    const unsigned char *byte = bytes;
+
+    while (len-- > 0) {
+        hash ^= *byte++;
+        hash = (hash * 16777619UL) & 0xffffffffUL;
+    }
+    return hash;
+}
+
+/*
+ * Description: Returns the pool's copy of a string, adding it on first use.
+ * Pooled strings are never freed, so the pointer stays good for the life of
+ * the process.
+ *
+ * Return: The pooled string, or "" if out of memory.
+ */
+
+const char *stringpool_intern(const char *text)
+{
+    struct PooledString *entry;
+    unsigned long hash;
+    size_t len;
+    size_t size;
+
+    len = strlen(text);
+    hash = hash_bytes(text, len, HASH_INIT);
+
+    pthread_mutex_lock(&stringpool_lock);
+    for (entry = stringpool[hash % STRINGPOOLBUCKETS]; entry != NULL;
+            entry = entry->next) {
+        if (entry->hash == hash && strcmp(entry->text, text) == 0) {
+            pthread_mutex_unlock(&stringpool_lock);
+            return entry->text;
+        }
+    }
+    size = offsetof(struct PooledString, text) + len + 1;
+    entry = malloc(size);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&stringpool_lock);
+        return "";
+    }
+    entry->hash = hash;
+    memcpy(entry->text, text, len + 1);
+    entry->next = stringpool[hash % STRINGPOOLBUCKETS];
+    stringpool[hash % STRINGPOOLBUCKETS] = entry;
+    stringpoolbytes += size;
+    pthread_mutex_unlock(&stringpool_lock);
+
+    return entry->text;
+}
+
+size_t stringpool_bytes(void)
+{
+    size_t bytes;
+
+    pthread_mutex_lock(&stringpool_lock);
+    bytes = stringpoolbytes;
+    pthread_mutex_unlock(&stringpool_lock);
+    return bytes;
+}
+
+/*-----------------------------------------------------------------------------
+ * Rule Set Signatures
+ *----------------------------------------------------------------------------*/
+
+/* Fills in only the fields the rule's type uses, so unused ones compare equal */
+static void rule_key(const struct HolidayRule *rule, struct RuleKey *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->month = rule->month;
+    key->ruletype = rule->ruletype;
+    key->effective_from = rule->effective_from;
+    key->effective_until = rule->effective_until;
+    if (key->ruletype >= 'a' && key->ruletype <= 'z')
+        key->ruletype -= 'a' - 'A';
+    switch (key->ruletype) {
+        case 'A':
+            key->day = rule->day;
+            break;
+        case 'R':
+            key->wkday = (int) rule->wkday;
+            key->wknum = rule->wknum;
+            break;
+        case 'W':
+            key->wkday = (int) rule->wkday;
+            break;
+        case 'O':
+            key->day = rule->day;
+            key->shift = rule->shift;
+            break;
+        case 'E':
+            key->offset = rule->offset;
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+static int rule_key_compare(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(struct RuleKey));
+}
+
+/*
+ * Description: Lists a rule set's rule keys in a canonical order, so that two
+ * rule sets compile to the same calendars if their lists are equal.
+ *
+ * Return: The number of keys; *keys must be freed.  -1 if out of memory.
+ */
+
+static int ruleset_keys(struct RuleSet *rules, struct RuleKey **keys)
+{
+    struct HolidayNode *node;
+    int numrules = 0;
+    int monthctr;
+
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = rules->holidays[monthctr]; node != NULL;
+                node = node->nextrule)
+            numrules++;
+    }
+    *keys = malloc((size_t) (numrules + 1) * sizeof(struct RuleKey));
+    if (*keys == NULL)
+        return -1;
+
+    numrules = 0;
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = rules->holidays[monthctr]; node != NULL;
+                node = node->nextrule)
+            rule_key(&node->rule, &(*keys)[numrules++]);
+    }
+    qsort(*keys, (size_t) numrules, sizeof(struct RuleKey), rule_key_compare);
+    return numrules;
+}
+
+/* Hashes a rule set's sorted keys, so most rule sets can be told apart
+ * without listing their keys again */
+static unsigned long rule_keys_hash(const struct RuleKey *keys, int numkeys)
+{
+    return hash_bytes(keys, (size_t) numkeys * sizeof(struct RuleKey),
+                      HASH_INIT);
+}
+
+/*
+ * Description: Finds a loaded jurisdiction with its own calendars whose rules
+ * are the same as those just read, given their sorted keys and the keys'
+ * hash.  Only jurisdictions whose rules hashed the same when they were loaded
+ * have their keys listed and compared; a rule set edited since then is
+ * compared as it is now.  Caller holds registry_lock.
+ */
+
+static struct RuleSet *registry_find_twin(const struct RuleKey *keys,
+                                          int numkeys, unsigned long keyhash)
+{
+    struct Jurisdiction *other;
+    struct RuleKey *otherkeys;
+    struct RuleSet *twin = NULL;
+    int othernumkeys;
+    int bucket;
+
+    for (bucket = 0; bucket < REGISTRYBUCKETS && twin == NULL; bucket++) {
+        for (other = registry[bucket]; other != NULL && twin == NULL;
+                other = other->next) {
+            if (other->rules == NULL || other->rules->calendars != NULL ||
+                    other->keyhash != keyhash)
+                continue;
+            othernumkeys = ruleset_keys(other->rules, &otherkeys);
+            if (othernumkeys == numkeys &&
+                    memcmp(keys, otherkeys,
+                        (size_t) numkeys * sizeof(struct RuleKey)) == 0)
+                twin = other->rules;
+            if (othernumkeys >= 0)
+                free(otherkeys);
+        }
+    }
+    return twin;
+}
+
+/*-----------------------------------------------------------------------------
+ * Jurisdiction Registry
+ *----------------------------------------------------------------------------*/
+
+/* Caller holds registry_lock */
+static struct Jurisdiction *registry_find(const char *jurisdiction)
+{
+    struct Jurisdiction *entry;
+    unsigned long hash;
+
+    hash = hash_bytes(jurisdiction, strlen(jurisdiction), HASH_INIT);
+    for (entry = registry[hash % REGISTRYBUCKETS]; entry != NULL;
+            entry = entry->next) {
+        if (strcmp(entry->id, jurisdiction) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+/*
+ * Description: Reads a jurisdiction's rule file and publishes its rules.
+ * Caller holds registry_load_lock, so one file is read at a time, but not
+ * registry_lock, which is only taken to look for a twin and to publish; the
+ * file is read, and any calendar store opened, without it.
+ */
+
+static void registry_load(struct Jurisdiction *entry)
+{
+    struct RuleSet *rules;
+    struct RuleSet *twin = NULL;
+    struct RuleKey *keys;
+    unsigned long keyhash = 0;
+    int numkeys;
+    FILE *rulefile;
+
+    rulefile = fopen(entry->rulefilename, "r");
+    if (rulefile == NULL)
+        return;
+    rules = ruleset_read(rulefile);
+    if (rules != NULL) {
+        numkeys = ruleset_keys(rules, &keys);
+        if (numkeys >= 0) {
+            keyhash = rule_keys_hash(keys, numkeys);
+            pthread_mutex_lock(&registry_lock);
+            twin = registry_find_twin(keys, numkeys, keyhash);
+            pthread_mutex_unlock(&registry_lock);
+            free(keys);
+        }
+        if (twin != NULL)
+            rules->calendars = twin;
+        else
+            ruleset_attach_calendars(rules, rulefile);
+        rules->registered = 1;
+        ruleset_register(rules);
+
+        pthread_mutex_lock(&registry_lock);
+        entry->keyhash = keyhash;
+        entry->rules = rules;
+        pthread_mutex_unlock(&registry_lock);
+    }
+    fclose(rulefile);
+    return;
+}
+
+int holiday_registry_add(const char *jurisdiction, const char *rulefilename)
+{
+    struct Jurisdiction *entry;
+    unsigned long hash;
+
+    if (jurisdiction == NULL || rulefilename == NULL)
+        return -1;
+
+    pthread_mutex_lock(&registry_lock);
+    if (registry_find(jurisdiction) != NULL) {
+        pthread_mutex_unlock(&registry_lock);
+        return -1;
+    }
+    entry = calloc(1, sizeof(*entry));
+    if (entry == NULL) {
+        pthread_mutex_unlock(&registry_lock);
+        return -1;
+    }
+    entry->id = stringpool_intern(jurisdiction);
+    entry->rulefilename = stringpool_intern(rulefilename);
+    hash = hash_bytes(jurisdiction, strlen(jurisdiction), HASH_INIT);
+    entry->next = registry[hash % REGISTRYBUCKETS];
+    registry[hash % REGISTRYBUCKETS] = entry;
+    pthread_mutex_unlock(&registry_lock);
+
+    return 0;
+}
+
+struct RuleSet *holiday_registry_get(const char *jurisdiction)
+{
+    struct Jurisdiction *entry;
+    struct RuleSet *rules = NULL;
+
+    pthread_mutex_lock(&registry_lock);
+    entry = registry_find(jurisdiction);
+    if (entry != NULL)
+        rules = entry->rules;
+    pthread_mutex_unlock(&registry_lock);
+    if (entry == NULL || rules != NULL)
+        return rules;
+
+    /* entries are never removed, so entry stays good without the lock */
+    pthread_mutex_lock(&registry_load_lock);
+    pthread_mutex_lock(&registry_lock);
+    rules = entry->rules; /* another thread may have loaded it meanwhile */
+    pthread_mutex_unlock(&registry_lock);
+    if (rules == NULL) {
+        registry_load(entry);
+        pthread_mutex_lock(&registry_lock);
+        rules = entry->rules;
+        pthread_mutex_unlock(&registry_lock);
+    }
+    pthread_mutex_unlock(&registry_load_lock);
+
+    return rules;
+}
+
+int holiday_registry_get_stats(const char *jurisdiction,
+                               struct HolidayJurisdictionStats *stats)
+{
+    struct Jurisdiction *entry;
+    struct Jurisdiction *other;
+    struct RuleSet *calendars;
+    struct HolidayNode *node;
+    int monthctr;
+    int bucket;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->pool_bytes = stringpool_bytes();
+
+    pthread_mutex_lock(&registry_lock);
+    entry = registry_find(jurisdiction);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&registry_lock);
+        return -1;
+    }
+    if (entry->rules == NULL) { /* not used yet */
+        pthread_mutex_unlock(&registry_lock);
+        return 0;
+    }
+
+    stats->loaded = 1;
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = entry->rules->holidays[monthctr]; node != NULL;
+                node = node->nextrule)
+            stats->numrules++;
+    }
+    stats->rule_bytes = ruleset_rule_bytes(entry->rules);
+
+    calendars = entry->rules->calendars != NULL ?
+        entry->rules->calendars : entry->rules;
+    holiday_ruleset_get_cache_stats(entry->rules, &stats->cache);
+    stats->calendar_bytes = stats->cache.resident_bytes;
+    for (bucket = 0; bucket < REGISTRYBUCKETS; bucket++) {
+        for (other = registry[bucket]; other != NULL; other = other->next) {
+            if (other->rules != NULL && (other->rules == calendars ||
+                        other->rules->calendars == calendars))
+                stats->sharers++;
+        }
+    }
+    stats->resident_bytes = stats->rule_bytes +
+        stats->calendar_bytes / (size_t) stats->sharers;
+    pthread_mutex_unlock(&registry_lock);
+
+    return 0;
+}
+
+int holiday_registry_set_cache_budget(const char *jurisdiction,
+                                      size_t budget_bytes)
+{
+    struct RuleSet *rules;
+
+    rules = holiday_registry_get(jurisdiction);
+    if (rules == NULL)
+        return -1;
+    return holiday_ruleset_set_cache_budget(rules, budget_bytes);
+}
@@ -0,0 +1,264 @@
+/*
+ * Filename: ruleindex.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 19:26:48
+ * Last Modified: Mon Oct 19 19:26:48 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Says which rule closes a day (e.g., "Thanksgiving Day, 5 U.S.C.
+ * 6103(a)"), from a per-year index of the rule closing each day.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+/* Only taken to give a rule set its index; each index has its own lock */
+static pthread_mutex_t ruleindex_create_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*-----------------------------------------------------------------------------
+ * Building the Index
+ *----------------------------------------------------------------------------*/
+
+/* Fills in an explanation from a rule, or NULL for a court day */
+static int ruleindex_fill(struct HolidayExplanation *why,
+                          const struct HolidayRule *rule)
+{
+    why->holidayname = rule != NULL ? rule->holidayname : "";
+    why->authority = rule != NULL ? rule->authority : "";
+    return rule != NULL;
+}
+
+/* Explains a day by evaluating the rules, for days the index does not cover */
+static int ruleindex_evaluate(struct RuleSet *rules, int jdn,
+                              struct HolidayExplanation *why)
+{
+    struct DateTime dt;
+
+    jdn2greg(jdn, &dt);
+    set_weekday(&dt);
+    why->jdn = jdn;
+    return ruleindex_fill(why, ruleset_matchrule(rules, &dt));
+}
+
+/*
+ * Description: The ID of a rule within a year's index, adding it if it is
+ * new.  Rules are told apart by name and authority, which are pooled strings,
+ * so comparing the pointers is enough.
+ *
+ * Return: The ID, or RULEINDEXOTHER if the year's table is full.
+ */
+
+static int ruleindex_id(struct RuleIndexYear *entry,
+                        const struct HolidayRule *rule)
+{
+    int id;
+
+    if (rule == NULL)
+        return RULEINDEXOTHER;
+    for (id = 0; id < entry->numrules; id++) {
+        if (entry->holidayname[id] == rule->holidayname &&
+                entry->authority[id] == rule->authority)
+            return id + 1;
+    }
+    if (entry->numrules == RULEINDEXRULES)
+        return RULEINDEXOTHER;
+    entry->holidayname[entry->numrules] = rule->holidayname;
+    entry->authority[entry->numrules] = rule->authority;
+    return ++entry->numrules;
+}
+
+/* Indexes a year, finding the rule for each closed day of its calendar */
+static void ruleindex_build(struct RuleSet *rules, struct RuleIndexYear *entry,
+                            int year, unsigned long generation)
+{
+    struct YearCalendar cal;
+    struct DateTime dt;
+    unsigned long bits;
+    int word;
+    int doy;
+
+    ruleset_getyear(rules, year, &cal);
+    entry->year = year;
+    entry->generation = generation;
+    entry->numrules = 0;
+    memset(entry->ruleid, 0, sizeof(entry->ruleid));
+    for (word = 0; word < (int) CAL_WORDS; word++) {
+        bits = cal.closed[word];
+        while (bits != 0) {
+            doy = word * CAL_WORDBITS + __builtin_ctzl(bits);
+            jdn2greg(cal.jdn + doy, &dt);
+            set_weekday(&dt);
+            entry->ruleid[doy] = (unsigned char)
+                ruleindex_id(entry, ruleset_matchrule(rules, &dt));
+            bits &= bits - 1; /* clear the lowest set bit */
+        }
+    }
+    return;
+}
+
+/*
+ * Description: Returns a rule set's index, creating it on first use.
+ *
+ * Return: The index, or NULL if out of memory.
+ */
+
+static struct RuleIndex *ruleindex_get(struct RuleSet *rules)
+{
+    struct RuleIndex *index;
+
+    index = ATOMIC_LOAD(&rules->ruleindex);
+    if (index != NULL)
+        return index;
+
+    pthread_mutex_lock(&ruleindex_create_lock);
+    index = rules->ruleindex; /* another thread may have created it */
+    if (index == NULL) {
+        index = calloc(1, sizeof(struct RuleIndex));
+        if (index != NULL) {
+            pthread_mutex_init(&index->lock, NULL);
+            ATOMIC_STORE(&rules->ruleindex, index);
+        }
+    }
+    pthread_mutex_unlock(&ruleindex_create_lock);
+    return index;
+}
+
+/*
+ * Description: Finds a rule set's index of a year, indexing the year (in
+ * place of the entry used longest ago) if it is not indexed or the rules
+ * have changed since.  Caller holds index->lock.
+ */
+
+static struct RuleIndexYear *ruleindex_year(struct RuleSet *rules,
+                                            struct RuleIndex *index, int year)
+{
+    struct RuleIndexYear *entry;
+    unsigned long generation;
+    int idx;
+
+    generation = ruleset_generation(rules);
+    for (idx = 0; idx < RULEINDEXYEARS; idx++) {
+        if (index->years[idx].year == year &&
+                index->years[idx].generation == generation)
+            return &index->years[idx];
+    }
+    entry = &index->years[index->next];
+    index->next = (index->next + 1) % RULEINDEXYEARS;
+    ruleindex_build(rules, entry, year, generation);
+    return entry;
+}
+
+/* Explains one day of an indexed year.  Caller holds the index's lock. */
+static int ruleindex_lookup(struct RuleSet *rules,
+                            const struct RuleIndexYear *entry, int doy,
+                            int jdn, struct HolidayExplanation *why)
+{
+    int id = entry->ruleid[doy];
+
+    if (id == RULEINDEXOTHER)
+        return ruleindex_evaluate(rules, jdn, why);
+    why->jdn = jdn;
+    why->holidayname = id != 0 ? entry->holidayname[id - 1] : "";
+    why->authority = id != 0 ? entry->authority[id - 1] : "";
+    return id != 0;
+}
+
+void ruleindex_release(struct RuleIndex *index)
+{
+    if (index != NULL)
+        pthread_mutex_destroy(&index->lock);
+    free(index);
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Interface
+ *----------------------------------------------------------------------------*/
+
+int holiday_ruleset_explain(struct RuleSet *rules, struct DateTime *dt,
+                            struct HolidayExplanation *why)
+{
+    const struct RuleIndexYear *entry;
+    struct RuleIndex *index;
+    int closed;
+    int doy;
+
+    doy = calendar_dayofyear(dt->year, dt->month, dt->day);
+    if (doy < 0)
+        return -1;
+    index = ruleindex_get(rules);
+    if (dt->year < CAL_MINYEAR || dt->year > CAL_MAXYEAR || index == NULL)
+        return ruleindex_evaluate(rules, jdncnvrt(dt), why);
+
+    pthread_mutex_lock(&index->lock);
+    entry = ruleindex_year(rules, index, dt->year);
+    closed = ruleindex_lookup(rules, entry, doy, jdncnvrt(dt), why);
+    pthread_mutex_unlock(&index->lock);
+
+    return closed;
+}
+
+/*
+ * Description: Explains every closed day from first through last, a year's
+ * index at a time.
+ */
+
+int holiday_ruleset_explain_range(struct RuleSet *rules,
+                                  struct DateTime *first,
+                                  struct DateTime *last,
+                                  struct HolidayExplanation why[], int maxwhy)
+{
+    struct HolidayExplanation scratch;
+    const struct RuleIndexYear *entry;
+    struct RuleIndex *index;
+    struct DateTime dt;
+    int count = 0;
+    int lastjdn;
+    int jan1;
+    int doy;
+    int lastdoy;
+    int jdn;
+
+    jdn = jdncnvrt(first);
+    lastjdn = jdncnvrt(last);
+    index = ruleindex_get(rules);
+    while (jdn <= lastjdn) {
+        jdn2greg(jdn, &dt);
+        if (dt.year < CAL_MINYEAR || dt.year > CAL_MAXYEAR || index == NULL) {
+            /* a day at a time */
+            if (ruleindex_evaluate(rules, jdn, count < maxwhy ?
+                                   &why[count] : &scratch))
+                count++;
+            jdn++;
+            continue;
+        }
+        pthread_mutex_lock(&index->lock);
+        entry = ruleindex_year(rules, index, dt.year);
+        doy = calendar_dayofyear(dt.year, dt.month, dt.day);
+        jan1 = jdn - doy;
+        lastdoy = calendar_dayofyear(dt.year, DECEMBER, 31);
+        if (lastjdn - jan1 < lastdoy)
+            lastdoy = lastjdn - jan1;
+        for (; doy <= lastdoy; doy++) {
+            if (entry->ruleid[doy] != 0 &&
+                    ruleindex_lookup(rules, entry, doy, jan1 + doy,
+                                     count < maxwhy ? &why[count] : &scratch))
+                count++;
+        }
+        pthread_mutex_unlock(&index->lock);
+        jdn = jan1 + lastdoy + 1;
+    }
+    return count;
+}
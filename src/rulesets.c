@@ -0,0 +1,915 @@
+/*
+ * Filename: rulesets.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 15:05:48
+ * Last Modified: Mon Oct 19 15:05:48 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Rule sets beyond the one loaded by holiday_rules_open(), and
+ * composites (unions and intersections) of rule sets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+/* Every rule set made by the functions below, most recent first */
+static struct RuleSet *rulesets;
+static pthread_mutex_t rulesets_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Stands in for the hash table of a rule set with no rules loaded yet */
+static struct HolidayNode *norules[TTLMONTHS];
+
+/*-----------------------------------------------------------------------------
+ * Rule Set Helpers
+ *----------------------------------------------------------------------------*/
+
+static struct HolidayNode **ruleset_table(struct RuleSet *rules)
+{
+    return rules->holidays != NULL ? rules->holidays : norules;
+}
+
+void ruleset_register(struct RuleSet *rules)
+{
+    pthread_mutex_lock(&rulesets_lock);
+    rules->nextruleset = rulesets;
+    rulesets = rules;
+    pthread_mutex_unlock(&rulesets_lock);
+    return;
+}
+
+/* Flushes a rule set's calendars and those of every composite built on it
+ * (or on a rule set sharing its calendars).  Caller holds rulesets_lock. */
+static void ruleset_invalidate_locked(struct RuleSet *rules)
+{
+    struct RuleSet *composite;
+
+    if (rules->cache.initialized)
+        calendar_cache_flush(&rules->cache);
+    for (composite = rulesets; composite != NULL;
+            composite = composite->nextruleset) {
+        if (composite->left == rules || composite->right == rules ||
+                composite->calendars == rules)
+            ruleset_invalidate_locked(composite);
+    }
+    return;
+}
+
+/*
+ * Description: Discards the compiled calendars of a rule set whose rules have
+ * changed, along with those of any composite that depends on it.
+ *
+ * Notes: Like calendar_cache_flush(), must not run while other threads are
+ * querying the rule sets concerned.
+ */
+
+void ruleset_invalidate(struct RuleSet *rules)
+{
+    pthread_mutex_lock(&rulesets_lock);
+    ruleset_invalidate_locked(rules);
+    pthread_mutex_unlock(&rulesets_lock);
+    return;
+}
+
+/*
+ * Description: Checks a date against a rule set without using any compiled
+ * calendar.
+ *
+ * Precondition: the day_of_week member of dt must be set.
+ */
+
+int ruleset_evaluate(struct RuleSet *rules, struct DateTime *dt)
+{
+    switch (rules->kind) {
+        case RULESET_UNION:
+            return ruleset_evaluate(rules->left, dt) ||
+                ruleset_evaluate(rules->right, dt);
+        case RULESET_INTERSECTION:
+            return ruleset_evaluate(rules->left, dt) &&
+                ruleset_evaluate(rules->right, dt);
+        default:
+            return holiday_tbl_evaluate(dt, ruleset_table(rules));
+    }
+}
+
+/* The first rule in a list that matches a date, or NULL */
+static const struct HolidayRule *ruleset_findrule(struct HolidayNode *node,
+                                                  struct DateTime *dt)
+{
+    for (; node != NULL; node = node->nextrule) {
+        if (holiday_rule_matches(dt, &node->rule))
+            return &node->rule;
+    }
+    return NULL;
+}
+
+/*
+ * Description: Finds the rule that closes a date under a rule set: the rule
+ * holiday_tbl_evaluate() would stop at, or for a composite the left operand's
+ * rule if it has one.  Does not touch the rules' statistics.
+ *
+ * Precondition: the day_of_week member of dt must be set.
+ *
+ * Return: The rule, or NULL if the date is open.
+ */
+
+const struct HolidayRule *ruleset_matchrule(struct RuleSet *rules,
+                                            struct DateTime *dt)
+{
+    const struct HolidayRule *rule;
+
+    switch (rules->kind) {
+        case RULESET_UNION:
+            rule = ruleset_matchrule(rules->left, dt);
+            return rule != NULL ? rule : ruleset_matchrule(rules->right, dt);
+        case RULESET_INTERSECTION:
+            if (ruleset_matchrule(rules->right, dt) == NULL)
+                return NULL;
+            return ruleset_matchrule(rules->left, dt);
+        default:
+            rule = ruleset_findrule(ruleset_table(rules)[ALLMONTHS], dt);
+            if (rule == NULL && dt->month >= JANUARY && dt->month <= DECEMBER)
+                rule = ruleset_findrule(ruleset_table(rules)[dt->month], dt);
+            return rule;
+    }
+}
+
+/* The name of the rule closing a date, or "" if it is open */
+const char *ruleset_rulename(struct RuleSet *rules, struct DateTime *dt)
+{
+    const struct HolidayRule *rule;
+
+    rule = ruleset_matchrule(rules, dt);
+    return rule != NULL ? rule->holidayname : "";
+}
+
+/* Copies a rule set's calendar for a year into cal, compiling it if needed */
+void ruleset_getyear(struct RuleSet *rules, int year,
+                     struct YearCalendar *cal)
+{
+    const struct YearCalendar *cached;
+
+    cached = calendar_cache_get(rules, year, cal);
+    if (cached == NULL)
+        calendar_compile(rules, cal, year);
+    else if (cached != cal)
+        memcpy(cal, cached, sizeof(*cal));
+    return;
+}
+
+/*
+ * Description: Compiles one year of a rule set.  Rules are evaluated for
+ * each day of the year; a composite instead takes its operands' calendars
+ * (from their caches where possible) and combines the bitmaps a word at a
+ * time, then recounts the court-day index.
+ */
+
+void calendar_compile(struct RuleSet *rules, struct YearCalendar *cal,
+                      int year)
+{
+    struct YearCalendar left;
+    int word;
+
+    if (rules->kind == RULESET_RULES) {
+        calendar_build(cal, year, ruleset_table(rules));
+        return;
+    }
+
+    ruleset_getyear(rules->left, year, &left);
+    ruleset_getyear(rules->right, year, cal);
+    if (rules->kind == RULESET_UNION) {
+        for (word = 0; word < (int) CAL_WORDS; word++)
+            cal->closed[word] |= left.closed[word];
+    } else {
+        for (word = 0; word < (int) CAL_WORDS; word++)
+            cal->closed[word] &= left.closed[word];
+    }
+    calendar_rank(cal);
+    return;
+}
+
+static struct RuleSet *ruleset_combine(struct RuleSet *left,
+                                       struct RuleSet *right, int kind)
+{
+    struct RuleSet *rules;
+
+    if (left == NULL || right == NULL)
+        return NULL;
+    rules = calloc(1, sizeof(*rules));
+    if (rules == NULL)
+        return NULL;
+    rules->kind = kind;
+    rules->left = left;
+    rules->right = right;
+    calendar_cache_init(&rules->cache, CAL_DEFAULTBUDGET);
+    ruleset_register(rules);
+    return rules;
+}
+
+/*
+ * Description: Gives a rule set about to be edited calendars of its own.  If
+ * it was using another rule set's calendars, it stops; if others were using
+ * its calendars, the first of them takes over as the owner of a fresh cache
+ * and the rest share that one.  Caller holds rulesets_lock, and no thread may
+ * be querying any of these rule sets, since the twins are repointed without
+ * waiting for their readers.
+ */
+
+static void ruleset_unshare_locked(struct RuleSet *rules)
+{
+    struct RuleSet *other;
+    struct RuleSet *owner = NULL;
+
+    if (rules->calendars != NULL) { /* keeps the shared cache's budget */
+        calendar_cache_init(&rules->cache, rules->calendars->cache.budget);
+        rules->calendars = NULL;
+    }
+    for (other = rulesets; other != NULL; other = other->nextruleset) {
+        if (other->calendars != rules)
+            continue;
+        if (owner == NULL) {
+            owner = other;
+            other->calendars = NULL;
+            calendar_cache_init(&other->cache, rules->cache.budget);
+        } else {
+            other->calendars = owner;
+        }
+    }
+    return;
+}
+
+/* Compiles again the cached years of every composite built on an edited rule
+ * set, operands before the composites built on them.  Caller holds
+ * rulesets_lock. */
+static void ruleset_recompile_dependents_locked(struct RuleSet *rules)
+{
+    struct RuleSet *composite;
+
+    for (composite = rulesets; composite != NULL;
+            composite = composite->nextruleset) {
+        if (composite->left == rules || composite->right == rules) {
+            calendar_cache_recompile(composite);
+            ruleset_recompile_dependents_locked(composite);
+        }
+    }
+    return;
+}
+
+/* Converts a rule as given to the API into the form the rule file produces */
+static int ruleset_makerule(const struct HolidayRuleSpec *spec,
+                            struct HolidayRule *rule)
+{
+    memset(rule, 0, sizeof(*rule));
+    if (spec->month < ALLMONTHS || spec->month > DECEMBER)
+        return -1;
+    rule->month = spec->month;
+    rule->ruletype = spec->ruletype;
+    switch (spec->ruletype) {
+        case 'a': /* fall through */
+        case 'A':
+            if (spec->day < 1 || spec->day > 31)
+                return -1;
+            rule->wkday = 999;
+            rule->wknum = 999;
+            rule->day = spec->day;
+            break;
+        case 'r': /* fall through */
+        case 'R':
+            if (spec->wkday < SUNDAY || spec->wkday > SATURDAY ||
+                    ((spec->wknum < 1 || spec->wknum > 5) &&
+                     spec->wknum != LASTWEEK))
+                return -1;
+            rule->wkday = (unsigned int) spec->wkday;
+            rule->wknum = spec->wknum;
+            break;
+        case 'w': /* fall through */
+        case 'W':
+            if (spec->wkday < SUNDAY || spec->wkday > SATURDAY)
+                return -1;
+            rule->wkday = (unsigned int) spec->wkday;
+            rule->wknum = ALLDAYS;
+            break;
+        case 'o': /* fall through */
+        case 'O':
+            if (spec->month == ALLMONTHS || spec->day < 1 || spec->day > 31 ||
+                    spec->shift < SHIFT_NONE ||
+                    spec->shift > SHIFT_SATURDAYTOFRIDAY)
+                return -1;
+            rule->wkday = 999;
+            rule->wknum = 999;
+            rule->day = spec->day;
+            rule->shift = spec->shift;
+            break;
+        case 'e': /* fall through */
+        case 'E':
+            /* keeps the holiday in Easter's year, so it is found when that
+             * year is compiled */
+            if (spec->offset < EASTERMINOFFSET ||
+                    spec->offset > EASTERMAXOFFSET)
+                return -1;
+            rule->month = ALLMONTHS;
+            rule->wkday = 999;
+            rule->wknum = 999;
+            rule->offset = spec->offset;
+            break;
+        default:
+            return -1;
+    }
+    if (spec->effective_from != 0 && spec->effective_until != 0 &&
+            spec->effective_from > spec->effective_until)
+        return -1;
+    rule->effective_from = spec->effective_from;
+    rule->effective_until = spec->effective_until;
+    rule->holidayname = stringpool_intern(spec->holidayname != NULL ?
+                                          spec->holidayname : "");
+    rule->authority = stringpool_intern(spec->authority != NULL ?
+                                        spec->authority : "");
+    return 0;
+}
+
+/*
+ * Description: Removes the rule named holidayname (if not NULL) and adds the
+ * rule described by spec (if not NULL), then patches the calendars already
+ * compiled from the rule set instead of discarding them.
+ *
+ * Algorithm: A rule can only affect the days it matches, so each cached year
+ * is patched by evaluating those days again (see calendar_patch()), and the
+ * court-day index is adjusted from the first changed day onward.  The years
+ * mapped from the on-disk store were compiled from the rule file as it was,
+ * so the store is let go.  Composites built on the rule set recompile their
+ * cached years from the patched ones.
+ */
+
+static int ruleset_edit(struct RuleSet *rules, const char *holidayname,
+                        const struct HolidayRuleSpec *spec)
+{
+    struct HolidayNode **link = NULL;
+    struct HolidayNode *removed = NULL;
+    struct HolidayRule newrule;
+    int monthctr;
+
+    if (rules == NULL || rules->kind != RULESET_RULES ||
+            rules->holidays == NULL)
+        return -1;
+    if (spec != NULL && ruleset_makerule(spec, &newrule) != 0)
+        return -1;
+    if (holidayname != NULL) {
+        for (monthctr = 0; monthctr < TTLMONTHS && removed == NULL;
+                monthctr++) {
+            for (link = &rules->holidays[monthctr]; *link != NULL;
+                    link = &(*link)->nextrule) {
+                if (strcmp((*link)->rule.holidayname, holidayname) == 0) {
+                    removed = *link;
+                    break;
+                }
+            }
+        }
+        if (removed == NULL)
+            return -1;
+    }
+
+    pthread_mutex_lock(&rulesets_lock);
+    ruleset_unshare_locked(rules);
+    calendar_store_close(&rules->store);
+
+    if (removed != NULL)
+        *link = removed->nextrule;
+    if (spec != NULL)
+        holiday_table_addrule(&rules->holidays[holiday_rule_slot(&newrule)],
+                              &newrule);
+    if (removed != NULL)
+        calendar_cache_patch(&rules->cache, rules->holidays, &removed->rule);
+    if (spec != NULL)
+        calendar_cache_patch(&rules->cache, rules->holidays, &newrule);
+    free(removed);
+
+    ruleset_recompile_dependents_locked(rules);
+    pthread_mutex_unlock(&rulesets_lock);
+    return 0;
+}
+
+/*
+ * Description: Counts the court days from firstjdn through lastjdn under a
+ * rule set.  Within compiled years the count comes from the court-day index,
+ * two lookups per year; other days are checked one at a time.
+ */
+
+int ruleset_courtdays(struct RuleSet *rules, int firstjdn, int lastjdn)
+{
+    struct YearCalendar scratch;
+    const struct YearCalendar *cal;
+    struct DateTime dt;
+    int count = 0;
+    int doy;
+    int last;
+
+    while (firstjdn <= lastjdn) {
+        jdn2greg(firstjdn, &dt);
+        cal = calendar_cache_get(rules, dt.year, &scratch);
+        if (cal == NULL) {
+            count += !holiday_ruleset_isholiday(rules, &dt);
+            firstjdn++;
+            continue;
+        }
+        doy = firstjdn - cal->jdn;
+        last = lastjdn - cal->jdn < cal->numdays - 1 ?
+            lastjdn - cal->jdn : cal->numdays - 1;
+        count += calendar_courtdays_before(cal, last + 1) -
+            calendar_courtdays_before(cal, doy);
+        firstjdn = cal->jdn + last + 1;
+    }
+    return count;
+}
+
+/*
+ * Description: Finds the first court day on or after (direction 1) or on or
+ * before (direction -1) a day under a rule set.  Each year's calendar is
+ * scanned a word at a time, moving on to the next (or previous) year if the
+ * rest of the year is closed, so no date is converted along the way.  Years
+ * the cache cannot hold are checked a day at a time.
+ *
+ * Return: The court day's JDN, or -1 if there is none within 1753 - 9999.
+ */
+
+int ruleset_scan_courtday(struct RuleSet *rules, int jdn, int direction)
+{
+    struct YearCalendar scratch;
+    const struct YearCalendar *cal;
+    struct DateTime dt;
+    int doy;
+
+    jdn2greg(jdn, &dt);
+    while (dt.year >= CAL_MINYEAR && dt.year <= CAL_MAXYEAR) {
+        cal = calendar_cache_get(rules, dt.year, &scratch);
+        if (cal == NULL) {
+            jdn2greg(jdn, &dt);
+            set_weekday(&dt);
+            if (!ruleset_evaluate(rules, &dt))
+                return jdn;
+            jdn += direction;
+            jdn2greg(jdn, &dt);
+            continue;
+        }
+        doy = direction > 0 ? calendar_next_open(cal, jdn - cal->jdn) :
+            calendar_prev_open(cal, jdn - cal->jdn);
+        if (doy >= 0)
+            return cal->jdn + doy;
+        jdn = direction > 0 ? cal->jdn + cal->numdays : cal->jdn - 1;
+        dt.year += direction;
+    }
+    return -1;
+}
+
+/*
+ * Description: courtday_offset() under a rule set, from the court-day index
+ * (see tolling_courtday_offset(), with nothing tolled).
+ *
+ * Return: The JDN numdays court days from jdn, or -1 if it is not within
+ * 1753 - 9999.
+ */
+
+int ruleset_courtday_offset(struct RuleSet *rules, int jdn, int numdays)
+{
+    return tolling_courtday_offset(rules, jdn, numdays, NULL, 0);
+}
+
+/* The generation of the calendars a rule set uses, which changes whenever
+ * its rules (or those of a composite's operands) may have */
+unsigned long ruleset_generation(struct RuleSet *rules)
+{
+    if (rules->calendars != NULL)
+        rules = rules->calendars;
+    return ATOMIC_LOAD_RELAXED(&rules->cache.generation);
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Rule Set Interface
+ *----------------------------------------------------------------------------*/
+
+struct RuleSet *holiday_ruleset_active(void)
+{
+    return &activerules_h;
+}
+
+/*
+ * Description: Reads the rules from an open, not yet validated rule file into
+ * a new rule set, leaving the file open.  The rule set has no calendars until
+ * ruleset_attach_calendars() is called and is not yet on the list.
+ *
+ * Return: The rule set, or NULL if the file is invalid or out of memory.
+ */
+
+struct RuleSet *ruleset_read(FILE *rulefile)
+{
+    struct RuleSet *rules;
+
+    rules = calloc(1, sizeof(*rules));
+    if (rules != NULL)
+        rules->holidays = calloc(TTLMONTHS, sizeof(struct HolidayNode *));
+    if (rules == NULL || rules->holidays == NULL ||
+            holiday_rules_validatefile(rulefile) != 1) {
+        if (rules != NULL)
+            free(rules->holidays);
+        free(rules);
+        return NULL;
+    }
+
+    holiday_rules_getfields(rulefile, rules);
+    holiday_tbl_init(rules->holidays);
+    holiday_rules_get_tokens(rulefile, rules->holidays, rules);
+    rules->openstatus = CLOSED;
+    return rules;
+}
+
+/* Gives a rule set its own calendar cache, and its store if one is set up */
+void ruleset_attach_calendars(struct RuleSet *rules, FILE *rulefile)
+{
+    calendar_cache_init(&rules->cache, CAL_DEFAULTBUDGET);
+    calendar_store_open(rules, rulefile);
+    return;
+}
+
+/* Memory held by a rule set's own rules: the hash table and its nodes */
+size_t ruleset_rule_bytes(struct RuleSet *rules)
+{
+    struct HolidayNode *node;
+    size_t bytes = 0;
+    int monthctr;
+
+    if (rules->holidays == NULL)
+        return 0;
+    bytes += TTLMONTHS * sizeof(struct HolidayNode *);
+    for (monthctr = 0; monthctr < TTLMONTHS; monthctr++) {
+        for (node = rules->holidays[monthctr]; node != NULL;
+                node = node->nextrule)
+            bytes += sizeof(*node);
+    }
+    return bytes;
+}
+
+struct RuleSet *holiday_ruleset_load(const char *rulefilename)
+{
+    struct RuleSet *rules;
+    FILE *rulefile;
+
+    rulefile = fopen(rulefilename, "r");
+    if (rulefile == NULL)
+        return NULL;
+    rules = ruleset_read(rulefile);
+    if (rules != NULL) {
+        ruleset_attach_calendars(rules, rulefile);
+        ruleset_register(rules);
+    }
+    fclose(rulefile);
+    return rules;
+}
+
+struct RuleSet *holiday_ruleset_union(struct RuleSet *left,
+                                      struct RuleSet *right)
+{
+    return ruleset_combine(left, right, RULESET_UNION);
+}
+
+struct RuleSet *holiday_ruleset_intersection(struct RuleSet *left,
+                                             struct RuleSet *right)
+{
+    return ruleset_combine(left, right, RULESET_INTERSECTION);
+}
+
+int holiday_ruleset_close(struct RuleSet *rules)
+{
+    struct RuleSet **link;
+    struct RuleSet *other;
+
+    if (rules == NULL || rules == &activerules_h || rules->registered)
+        return -1;
+
+    pthread_mutex_lock(&rulesets_lock);
+    for (other = rulesets; other != NULL; other = other->nextruleset) {
+        if (other->left == rules || other->right == rules ||
+                other->calendars == rules) {
+            pthread_mutex_unlock(&rulesets_lock);
+            return -1; /* a composite still depends on it */
+        }
+    }
+    for (link = &rulesets; *link != NULL; link = &(*link)->nextruleset) {
+        if (*link == rules) {
+            *link = rules->nextruleset;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rulesets_lock);
+
+    if (rules->holidays != NULL) {
+        holiday_table_release(rules->holidays);
+        free(rules->holidays);
+    }
+    calendar_store_close(&rules->store);
+    calendar_cache_release(&rules->cache);
+    pthread_mutex_destroy(&rules->cache.lock);
+    ruleindex_release(rules->ruleindex);
+    free(rules);
+    return 0;
+}
+
+int holiday_ruleset_add_rule(struct RuleSet *rules,
+                             const struct HolidayRuleSpec *rule)
+{
+    if (rule == NULL)
+        return -1;
+    return ruleset_edit(rules, NULL, rule);
+}
+
+int holiday_ruleset_remove_rule(struct RuleSet *rules, const char *holidayname)
+{
+    if (holidayname == NULL)
+        return -1;
+    return ruleset_edit(rules, holidayname, NULL);
+}
+
+int holiday_ruleset_replace_rule(struct RuleSet *rules,
+                                 const char *holidayname,
+                                 const struct HolidayRuleSpec *rule)
+{
+    if (holidayname == NULL || rule == NULL)
+        return -1;
+    return ruleset_edit(rules, holidayname, rule);
+}
+
+/* Fills in a date found by a search (a JDN, or -1 if there is none), weekday
+ * included; shared by every search that returns a DateTime */
+int ruleset_courtday_result(int jdn, struct DateTime *result)
+{
+    if (jdn < 0)
+        return -1;
+    jdn2greg(jdn, result);
+    result->jdn = jdn;
+    set_weekday(result);
+    return 0;
+}
+
+int holiday_ruleset_next_courtday(struct RuleSet *rules, struct DateTime *dt,
+                                  struct DateTime *result)
+{
+    return ruleset_courtday_result(ruleset_scan_courtday(rules, jdncnvrt(dt),
+                                                         1), result);
+}
+
+int holiday_ruleset_prev_courtday(struct RuleSet *rules, struct DateTime *dt,
+                                  struct DateTime *result)
+{
+    return ruleset_courtday_result(ruleset_scan_courtday(rules, jdncnvrt(dt),
+                                                         -1), result);
+}
+
+int holiday_ruleset_nearest_courtday(struct RuleSet *rules,
+                                     struct DateTime *dt,
+                                     struct DateTime *result)
+{
+    int jdn;
+    int next;
+    int prev;
+
+    jdn = jdncnvrt(dt);
+    next = ruleset_scan_courtday(rules, jdn, 1);
+    if (next == jdn)
+        return ruleset_courtday_result(next, result);
+    prev = ruleset_scan_courtday(rules, jdn, -1);
+    if (next < 0 || (prev >= 0 && jdn - prev < next - jdn))
+        return ruleset_courtday_result(prev, result);
+    return ruleset_courtday_result(next, result);
+}
+
+int holiday_ruleset_nth_courtday(struct RuleSet *rules, int year,
+                                 int periodkind, int period, int n,
+                                 struct DateTime *result)
+{
+    struct YearCalendar cal;
+    int firstdoy;
+    int enddoy;
+    int before;
+    int inperiod;
+
+    if (year < CAL_MINYEAR || year > CAL_MAXYEAR || n == 0)
+        return -1;
+    ruleset_getyear(rules, year, &cal);
+    if (calendar_period_bounds(&cal, periodkind, period, &firstdoy,
+                               &enddoy) != 0)
+        return -1;
+    before = calendar_courtdays_before(&cal, firstdoy);
+    inperiod = calendar_courtdays_before(&cal, enddoy) - before;
+    if (n > inperiod || -n > inperiod)
+        return -1;
+    return ruleset_courtday_result(cal.jdn + calendar_select_open(&cal,
+                before + (n > 0 ? n - 1 : inperiod + n)), result);
+}
+
+int holiday_ruleset_courtday_ordinal(struct RuleSet *rules,
+                                     struct DateTime *dt, int periodkind)
+{
+    struct YearCalendar cal;
+    int firstdoy;
+    int enddoy;
+    int doy;
+
+    doy = calendar_dayofyear(dt->year, dt->month, dt->day);
+    if (doy < 0 || dt->year < CAL_MINYEAR || dt->year > CAL_MAXYEAR)
+        return -1;
+    ruleset_getyear(rules, dt->year, &cal);
+    if (calendar_period_bounds(&cal, periodkind, periodkind == PERIOD_MONTH ?
+                               dt->month : (dt->month - 1) / 3 + 1,
+                               &firstdoy, &enddoy) != 0)
+        return -1;
+    if (calendar_testday(&cal, doy))
+        return 0;
+    return calendar_courtdays_before(&cal, doy) -
+        calendar_courtdays_before(&cal, firstdoy) + 1;
+}
+
+void holiday_enumerate_begin(struct HolidayEnumeration *cursor,
+                             struct DateTime *first, struct DateTime *last,
+                             int flags)
+{
+    cursor->nextjdn = jdncnvrt(first);
+    cursor->lastjdn = jdncnvrt(last);
+    cursor->flags = flags;
+    return;
+}
+
+/*
+ * Description: Lists the next dates of an enumeration into the caller's
+ * buffer.  Compiled years are listed straight from their bitmaps by
+ * calendar_enumerate(), with one date conversion per year rather than per
+ * day; years the cache cannot hold are checked a day at a time.
+ */
+
+int holiday_ruleset_enumerate(struct RuleSet *rules,
+                              struct HolidayEnumeration *cursor,
+                              int dates[], int maxdates)
+{
+    struct YearCalendar scratch;
+    const struct YearCalendar *cal;
+    struct DateTime dt;
+    int count = 0;
+    int nextdoy;
+    int last;
+
+    while (count < maxdates && cursor->nextjdn <= cursor->lastjdn) {
+        jdn2greg(cursor->nextjdn, &dt);
+        cal = calendar_cache_get(rules, dt.year, &scratch);
+        if (cal == NULL) {
+            set_weekday(&dt);
+            if (ruleset_evaluate(rules, &dt) ==
+                    ((cursor->flags & ENUM_HOLIDAYS) != 0))
+                dates[count++] = cursor->flags & ENUM_PACKED ?
+                    dt.year * 10000 + dt.month * 100 + dt.day :
+                    cursor->nextjdn;
+            cursor->nextjdn++;
+            continue;
+        }
+        last = cursor->lastjdn - cal->jdn < cal->numdays - 1 ?
+            cursor->lastjdn - cal->jdn : cal->numdays - 1;
+        count += calendar_enumerate(cal, cursor->nextjdn - cal->jdn, last,
+                                    cursor->flags, &dates[count],
+                                    maxdates - count, &nextdoy);
+        cursor->nextjdn = cal->jdn + nextdoy;
+    }
+    return count;
+}
+
+/* Periods a year is reported in */
+static int ruleset_periods_per_year(int period)
+{
+    switch (period) {
+        case PERIOD_MONTH:
+            return 12;
+        case PERIOD_QUARTER:
+            return 4;
+        case PERIOD_YEAR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Description: Fills in the statistics for one year's periods.  The monthly
+ * court-day counts are added up into quarters or the year, and a period's
+ * closed days are its length less its court days.
+ */
+
+static void ruleset_year_stats(const struct YearCalendar *cal, int period,
+                               struct HolidayPeriodStats stats[])
+{
+    int courtdays[TTLMONTHS];
+    int leap;
+    int month;
+    int idx;
+
+    calendar_month_courtdays(cal, courtdays);
+    leap = cal->numdays == 366;
+    for (idx = 0; idx < ruleset_periods_per_year(period); idx++) {
+        stats[idx].year = cal->year;
+        stats[idx].period = period == PERIOD_YEAR ? 0 : idx + 1;
+        stats[idx].courtdays = 0;
+        stats[idx].holidays = 0;
+    }
+    for (month = JANUARY; month <= DECEMBER; month++) {
+        idx = period == PERIOD_MONTH ? month - 1 :
+            period == PERIOD_QUARTER ? (month - 1) / 3 : 0;
+        stats[idx].courtdays += courtdays[month];
+        stats[idx].holidays += daysinmonths[leap][month] - courtdays[month];
+    }
+    return;
+}
+
+int holiday_ruleset_period_stats(struct RuleSet *rules, int firstyear,
+                                 int lastyear, int period,
+                                 struct HolidayPeriodStats stats[],
+                                 int maxstats)
+{
+    struct HolidayPeriodStats yearstats[12];
+    struct YearCalendar cal;
+    int peryear;
+    int numstats;
+    int room;
+    int year;
+
+    peryear = ruleset_periods_per_year(period);
+    if (rules == NULL || peryear == 0 || firstyear < CAL_MINYEAR ||
+            lastyear > CAL_MAXYEAR || firstyear > lastyear || maxstats < 0)
+        return -1;
+
+    numstats = (lastyear - firstyear + 1) * peryear;
+    for (year = firstyear; year <= lastyear &&
+            (year - firstyear) * peryear < maxstats; year++) {
+        ruleset_getyear(rules, year, &cal);
+        ruleset_year_stats(&cal, period, yearstats);
+        room = maxstats - (year - firstyear) * peryear;
+        memcpy(&stats[(year - firstyear) * peryear], yearstats,
+               (size_t) (room < peryear ? room : peryear) *
+               sizeof(yearstats[0]));
+    }
+    return numstats;
+}
+
+int holiday_ruleset_period_stats_batch(struct RuleSet *rules[], int numrules,
+                                       int firstyear, int lastyear,
+                                       int period,
+                                       struct HolidayPeriodStats stats[])
+{
+    int numstats;
+    int idx;
+
+    for (idx = 0; idx < numrules; idx++) {
+        if (rules[idx] == NULL)
+            return -1;
+    }
+    numstats = (lastyear - firstyear + 1) * ruleset_periods_per_year(period);
+    for (idx = 0; idx < numrules; idx++) {
+        if (holiday_ruleset_period_stats(rules[idx], firstyear, lastyear,
+                    period, &stats[idx * numstats], numstats) < 0)
+            return -1;
+    }
+    return numstats;
+}
+
+/*
+ * Description: Determines whether a date is a holiday or weekend under a rule
+ * set.
+ *
+ * Algorithm: Dates in the years covered by compiled calendars are answered
+ * with a single bit test against the year's calendar, which is compiled and
+ * cached on first use.  Other dates (and all dates when the cache has no
+ * budget) are checked against the holiday rules directly.
+ */
+
+int holiday_ruleset_isholiday(struct RuleSet *rules, struct DateTime *dt)
+{
+    struct YearCalendar scratch;
+    const struct YearCalendar *cal;
+    int dayofyear;
+
+    /* First, calculate the day of the week, which callers rely on */
+    set_weekday(dt);
+
+    dayofyear = calendar_dayofyear(dt->year, dt->month, dt->day);
+    if (dayofyear >= 0) {
+        cal = calendar_cache_get(rules, dt->year, &scratch);
+        if (cal != NULL)
+            return calendar_testday(cal, dayofyear);
+    }
+
+    return ruleset_evaluate(rules, dt);
+}
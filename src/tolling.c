@@ -0,0 +1,143 @@
+/*
+ * Filename: tolling.c
+ * Library: libdatetimetools
+ *
+ * FOR DESCRIPTION AND OTHER DETAILS, PLEASE SEE THE DATETOOLS.H AND
+ * DATETIMETOOLS_PVT.H header files.
+ *
+ * Version: See VERSION
+ * Created: 10/19/2026 21:12:36
+ * Last Modified: Mon Oct 19 21:12:36 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: (c) 2011-2020 - Thomas H. Vidal, Los Angeles, CA
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Notes: Court-day and calendar-day offsets that skip tolled days (stays,
+ * appeals, emergency orders), by closing them in a copy of each year's
+ * calendar and counting with the court-day index as usual.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "datetimetools_pvt.h"
+
+/*-----------------------------------------------------------------------------
+ * Tolled Calendars
+ *----------------------------------------------------------------------------*/
+
+/*
+ * Description: Gets a year of a rule set's calendar (or, without a rule set,
+ * a calendar on which every day is open) with the tolled days closed.  Each
+ * period is laid over the year's bitmap as a few word-wide masks, and the
+ * court-day index is recounted only if one touched the year.
+ */
+
+static void tolling_getyear(struct RuleSet *rules, int year,
+                            const struct HolidayTolledPeriod tolled[],
+                            int numtolled, struct YearCalendar *cal)
+{
+    struct DateTime dt;
+    int recount = 0;
+    int first;
+    int last;
+    int idx;
+
+    if (rules != NULL) {
+        ruleset_getyear(rules, year, cal);
+    } else {
+        memset(cal, 0, sizeof(*cal));
+        cal->year = year;
+        dt.year = year;
+        dt.month = JANUARY;
+        dt.day = 1;
+        cal->jdn = jdncnvrt(&dt);
+        dt.year = year + 1;
+        cal->numdays = jdncnvrt(&dt) - cal->jdn;
+        recount = 1;
+    }
+    for (idx = 0; idx < numtolled; idx++) {
+        first = tolled[idx].firstjdn - cal->jdn;
+        last = tolled[idx].lastjdn - cal->jdn;
+        if (first > last || last < 0 || first >= cal->numdays)
+            continue;
+        calendar_close_days(cal, first < 0 ? 0 : first,
+                            last < cal->numdays ? last : cal->numdays - 1);
+        recount = 1;
+    }
+    if (recount)
+        calendar_rank(cal);
+    return;
+}
+
+/*
+ * Description: Counts numdays open days from jdn, not counting tolled days,
+ * from the court-day index: the start's rank in its year plus numdays is the
+ * rank of the answer, which is selected from the year it falls in, stepping
+ * a year at a time.  Without a rule set, every untolled day counts.
+ *
+ * Return: The JDN, or -1 if it is not within 1753 - 9999.
+ */
+
+int tolling_courtday_offset(struct RuleSet *rules, int jdn, int numdays,
+                            const struct HolidayTolledPeriod tolled[],
+                            int numtolled)
+{
+    struct YearCalendar cal;
+    struct DateTime dt;
+    int target;
+    int year;
+
+    if (numdays == 0)
+        return jdn;
+    jdn2greg(jdn, &dt);
+    year = dt.year;
+    if (year < CAL_MINYEAR || year > CAL_MAXYEAR)
+        return -1;
+    tolling_getyear(rules, year, tolled, numtolled, &cal);
+    if (numdays > 0) { /* rank of the answer among the year's court days */
+        target = calendar_courtdays_before(&cal, jdn - cal.jdn + 1) +
+            numdays - 1;
+        while (target >= cal.courtdays) {
+            target -= cal.courtdays;
+            if (++year > CAL_MAXYEAR)
+                return -1;
+            tolling_getyear(rules, year, tolled, numtolled, &cal);
+        }
+    } else {
+        target = calendar_courtdays_before(&cal, jdn - cal.jdn) + numdays;
+        while (target < 0) {
+            if (--year < CAL_MINYEAR)
+                return -1;
+            tolling_getyear(rules, year, tolled, numtolled, &cal);
+            target += cal.courtdays;
+        }
+    }
+    return cal.jdn + calendar_select_open(&cal, target);
+}
+
+/*-----------------------------------------------------------------------------
+ * Public Tolling Interface
+ *----------------------------------------------------------------------------*/
+
+int tolled_date_offset(struct DateTime *orig_date, struct DateTime *calc_date,
+                       int numdays,
+                       const struct HolidayTolledPeriod tolled[],
+                       int numtolled)
+{
+    return ruleset_courtday_result(
+        tolling_courtday_offset(NULL, jdncnvrt(orig_date), numdays, tolled,
+                                numtolled), calc_date);
+}
+
+int holiday_ruleset_tolled_courtday_offset(struct RuleSet *rules,
+        struct DateTime *orig_date, struct DateTime *calc_date, int numdays,
+        const struct HolidayTolledPeriod tolled[], int numtolled)
+{
+    return ruleset_courtday_result(
+        tolling_courtday_offset(rules, jdncnvrt(orig_date), numdays, tolled,
+                                numtolled), calc_date);
+}
@@ -0,0 +1,217 @@
+/*
+ * Filename: bench_datetimetools.c
+ * Library: libdatetimetools
+ *
+ * Version: see VERSION
+ * Created: Mon Oct 19 14:25:31 2026
+ * Last Modified: Mon Oct 19 14:25:31 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2020, Thomas H. Vidal
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Usage: bench_datetimetools -h<holiday rules> [-t<max threads>]
+ *        [-q<queries per thread>] [-c<deadline chain cases>]
+ *
+ * Notes: Measures how holiday lookups scale with the number of threads, with
+ * and without the per-thread copies of recently used years.  Every thread
+ * checks the dates of the same two years, which is what a busy server sees.
+ * With -c, measures batches of deadline chains instead: one motion schedule
+ * for that many cases, triggered on days spread over forty years.
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/datetools.h"
+
+#define BENCHYEAR 2021 /* the years queried are BENCHYEAR and BENCHYEAR + 1 */
+#define MAXBENCHTHREADS 256
+
+struct BenchThread {
+    pthread_t thread;
+    long queries;
+    long holidays; /* keeps the lookups from being optimized away */
+};
+
+static void *bench_worker(void *arg);
+static double bench_run(int numthreads, long queries);
+static int bench_chains(int maxthreads, int numcases);
+static void usage(const char *program_name);
+
+static void *bench_worker(void *arg)
+{
+    struct BenchThread *self = arg;
+    struct DateTime dt;
+    long query;
+
+    for (query = 0; query < self->queries; query++) {
+        dt.year = BENCHYEAR + (int) (query & 1);
+        dt.month = (int) (query / 2 % 12) + 1;
+        dt.day = (int) (query / 24 % 28) + 1;
+        self->holidays += isholiday(&dt);
+    }
+    return NULL;
+}
+
+/*
+ * Description: Runs numthreads threads of queries lookups each.
+ *
+ * Return: Lookups per second across all threads.
+ */
+
+static double bench_run(int numthreads, long queries)
+{
+    static struct BenchThread threads[MAXBENCHTHREADS];
+    struct timespec start, end;
+    double seconds;
+    int idx;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (idx = 0; idx < numthreads; idx++) {
+        threads[idx].queries = queries;
+        threads[idx].holidays = 0;
+        pthread_create(&threads[idx].thread, NULL, bench_worker,
+                       &threads[idx]);
+    }
+    for (idx = 0; idx < numthreads; idx++)
+        pthread_join(threads[idx].thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    seconds = (double) (end.tv_sec - start.tv_sec) +
+        (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (double) numthreads * (double) queries / seconds;
+}
+
+/*
+ * Description: Evaluates a chain for numcases cases on 1, 2, 4, ... threads,
+ * reporting cases per second and how much work was stolen.
+ *
+ * Return: 0, or -1 if out of memory.
+ */
+
+static int bench_chains(int maxthreads, int numcases)
+{
+    static const struct DeadlineSpec motion[6] = {
+        {"Hearing", CHAINTRIGGER, STEP_ROLLFORWARD, 0},
+        {"Motion served", 0, STEP_ROLLBACKWARD, -16},
+        {"Opposition due", 0, STEP_COURTDAYS, -9},
+        {"Reply due", 0, STEP_COURTDAYS, -5},
+        {"Proposed order due", 0, STEP_COURTDAYS, 2},
+        {"Ruling expected", 0, STEP_ROLLFORWARD, 90}
+    };
+    static struct HolidayChainWorkerStats stats[MAXCHAINTHREADS];
+    struct HolidayChain *chain;
+    struct timespec start, end;
+    struct DateTime first;
+    double seconds;
+    int *triggerjdns;
+    int *jdns;
+    int numthreads;
+    int used;
+    long steals;
+    int idx;
+
+    chain = holiday_chain_build(motion, 6);
+    triggerjdns = malloc((size_t) numcases * sizeof(int));
+    jdns = malloc((size_t) numcases * 6 * sizeof(int));
+    if (chain == NULL || triggerjdns == NULL || jdns == NULL) {
+        holiday_chain_release(chain);
+        free(triggerjdns);
+        free(jdns);
+        return -1;
+    }
+    first.year = BENCHYEAR - 20;
+    first.month = 1;
+    first.day = 1;
+    for (idx = 0; idx < numcases; idx++)
+        triggerjdns[idx] = jdncnvrt(&first) + idx % (40 * 365);
+    evaluate_deadlines_batch(chain, triggerjdns, numcases, jdns, 0, NULL);
+
+    printf("%8s %18s %8s\n", "threads", "cases/s", "steals");
+    for (numthreads = 1; numthreads <= maxthreads &&
+            numthreads <= MAXCHAINTHREADS; numthreads *= 2) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        used = evaluate_deadlines_batch(chain, triggerjdns, numcases, jdns,
+                                        numthreads, stats);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds = (double) (end.tv_sec - start.tv_sec) +
+            (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+        for (steals = 0, idx = 0; idx < used; idx++)
+            steals += stats[idx].steals;
+        printf("%8d %18.0f %8ld\n", used, (double) numcases / seconds,
+               steals);
+    }
+    holiday_chain_release(chain);
+    free(triggerjdns);
+    free(jdns);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *program_name = argv[0];
+    char *holidays_filename = NULL;
+    int maxthreads = 64;
+    long queries = 2000000L;
+    int chaincases = 0;
+    double shared, local;
+    int numthreads;
+
+    while ((argc > 1) && (argv[1][0] == '-')) {
+        switch (argv[1][1]) {
+            case 'h':
+                holidays_filename = &argv[1][2];
+                break;
+            case 't':
+                maxthreads = atoi(&argv[1][2]);
+                break;
+            case 'q':
+                queries = atol(&argv[1][2]);
+                break;
+            case 'c':
+                chaincases = atoi(&argv[1][2]);
+                break;
+            default:
+                usage(program_name);
+                return -1;
+        }
+        ++argv;
+        --argc;
+    }
+    if (holidays_filename == NULL || maxthreads < 1 ||
+            maxthreads > MAXBENCHTHREADS || queries < 1 || chaincases < 0) {
+        usage(program_name);
+        return -1;
+    }
+    holiday_rules_open(holidays_filename, 1);
+    if (chaincases > 0)
+        return bench_chains(maxthreads, chaincases);
+
+    printf("%8s %18s %18s %8s\n", "threads", "shared (q/s)",
+           "per-thread (q/s)", "ratio");
+    for (numthreads = 1; numthreads <= maxthreads; numthreads *= 2) {
+        holiday_cache_set_threadlocal(0);
+        shared = bench_run(numthreads, queries);
+        holiday_cache_set_threadlocal(1);
+        local = bench_run(numthreads, queries);
+        printf("%8d %18.0f %18.0f %8.2f\n", numthreads, shared, local,
+               local / shared);
+    }
+    return 0;
+}
+
+static void usage(const char *program_name)
+{
+    fprintf(stderr, "Usage: %s -h<holiday rules> [-t<max threads>] "
+            "[-q<queries per thread>] [-c<deadline chain cases>]\n",
+            program_name);
+    return;
+}
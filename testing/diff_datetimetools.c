@@ -0,0 +1,116 @@
+/*
+ * Filename: diff_datetimetools.c
+ * Library: libdatetimetools
+ *
+ * Version: see VERSION
+ * Created: Mon Oct 19 18:31:04 2026
+ * Last Modified: Mon Oct 19 18:31:04 2026
+ *
+ * Author: Thomas H. Vidal (THV), thomashvidal@gmail.com
+ * Organization: Dark Matter Computing
+ *
+ * Copyright: Copyright (c) 2011-2020, Thomas H. Vidal
+ * SPDX-License-Identifier: LGPL-3.0-only
+ *
+ * Usage: diff_datetimetools -a<old rules> -b<new rules> [-f<first year>]
+ *        [-l<last year>]
+ *
+ * Notes: Lists the dates whose status a new rule file would change, with the
+ * holiday responsible under each file, for checking a rule file before it is
+ * deployed.  Exits 1 if any date differs, like diff(1).
+ */
+
+/* #####   HEADER FILE INCLUDES   ########################################### */
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../include/datetools.h"
+
+#define MAXLISTED 10000 /* differences listed; the rest are only counted */
+
+static void usage(const char *program_name);
+
+int main(int argc, char *argv[])
+{
+    static struct HolidayDiff diffs[MAXLISTED];
+    char *program_name = argv[0];
+    char *before_filename = NULL;
+    char *after_filename = NULL;
+    struct RuleSet *before;
+    struct RuleSet *after;
+    struct timespec start, end;
+    char datestring[DATESTRINGLEN];
+    int firstyear = 1990;
+    int lastyear = 2060;
+    int numdiffs;
+    int idx;
+
+    while ((argc > 1) && (argv[1][0] == '-')) {
+        switch (argv[1][1]) {
+            case 'a':
+                before_filename = &argv[1][2];
+                break;
+            case 'b':
+                after_filename = &argv[1][2];
+                break;
+            case 'f':
+                firstyear = atoi(&argv[1][2]);
+                break;
+            case 'l':
+                lastyear = atoi(&argv[1][2]);
+                break;
+            default:
+                usage(program_name);
+                return -1;
+        }
+        ++argv;
+        --argc;
+    }
+    if (before_filename == NULL || after_filename == NULL) {
+        usage(program_name);
+        return -1;
+    }
+    before = holiday_ruleset_load(before_filename);
+    after = holiday_ruleset_load(after_filename);
+    if (before == NULL || after == NULL) {
+        fprintf(stderr, "Couldn't read %s\n",
+                before == NULL ? before_filename : after_filename);
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    numdiffs = holiday_ruleset_diff(before, after, firstyear, lastyear, diffs,
+                                    MAXLISTED);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (numdiffs < 0) {
+        fprintf(stderr, "Years must be within 1753 - 9999\n");
+        return -1;
+    }
+
+    for (idx = 0; idx < numdiffs && idx < MAXLISTED; idx++) {
+        date_to_string(datestring, &diffs[idx].date, YMD);
+        printf("%-12s %-6s -> %-6s  %s -> %s\n", datestring,
+               diffs[idx].closed_before ? "closed" : "open",
+               diffs[idx].closed_before ? "open" : "closed",
+               *diffs[idx].before_rule != '\0' ? diffs[idx].before_rule : "-",
+               *diffs[idx].after_rule != '\0' ? diffs[idx].after_rule : "-");
+    }
+    printf("%d dates differ from %d through %d (%.3f ms)\n", numdiffs,
+           firstyear, lastyear,
+           (double) (end.tv_sec - start.tv_sec) * 1e3 +
+           (double) (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    holiday_ruleset_close(after);
+    holiday_ruleset_close(before);
+    return numdiffs != 0;
+}
+
+static void usage(const char *program_name)
+{
+    fprintf(stderr, "Usage: %s -a<old rules> -b<new rules> [-f<first year>] "
+            "[-l<last year>]\n", program_name);
+    return;
+}
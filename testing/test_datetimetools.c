@@ -43,6 +43,24 @@ int main(int argc, char *argv[])
     char *rulecheck_filename;
     char *mathcalc_filename;
     char *calmath_filename;
+    char *cachetest_filename;
+    char *rulestats_filename;
+    char *composite_filename;
+    char *registry_dirname;
+    char *lanes_filename;
+    char *ruleedit_filename;
+    char *overlay_filename;
+    char *effective_filename;
+    char *observed_filename;
+    char *diff_filename;
+    char *nextcourtday_filename;
+    char *enumerate_filename;
+    char *periodstats_filename;
+    char *ordinal_filename;
+    char *explain_filename;
+    char *chain_filename;
+    char *chainbatch_filename;
+    char *chaininstance_filename;
     int close_file_when_done = 1;
     
 
@@ -55,6 +73,24 @@ int main(int argc, char *argv[])
     rulecheck_filename = NULL;
     mathcalc_filename = NULL;
     calmath_filename = NULL;
+    cachetest_filename = NULL;
+    rulestats_filename = NULL;
+    composite_filename = NULL;
+    registry_dirname = NULL;
+    lanes_filename = NULL;
+    ruleedit_filename = NULL;
+    overlay_filename = NULL;
+    effective_filename = NULL;
+    observed_filename = NULL;
+    diff_filename = NULL;
+    nextcourtday_filename = NULL;
+    enumerate_filename = NULL;
+    periodstats_filename = NULL;
+    ordinal_filename = NULL;
+    explain_filename = NULL;
+    chain_filename = NULL;
+    chainbatch_filename = NULL;
+    chaininstance_filename = NULL;
 
     /* Process the commandline arguments */
     if (argc == 1) {
@@ -71,6 +107,96 @@ int main(int argc, char *argv[])
                 holiday_rules_open(holidays_filename, close_file_when_done);
                 printholidayrules();
                 break;
+            case 'E': /* fall through */
+            case 'e':
+                cachetest_filename = &argv[1][2];
+                testsuite_run_check(CACHEBUDGET, cachetest_filename);
+                break;
+            case 'O': /* fall through */
+            case 'o':
+                rulestats_filename = &argv[1][2];
+                testsuite_run_check(RULESTATS, rulestats_filename);
+                break;
+            case 'U': /* fall through */
+            case 'u':
+                composite_filename = &argv[1][2];
+                testsuite_run_check(COMPOSITE, composite_filename);
+                break;
+            case 'J': /* fall through */
+            case 'j':
+                registry_dirname = &argv[1][2];
+                testsuite_run_check(REGISTRY, registry_dirname);
+                break;
+            case 'B': /* fall through */
+            case 'b':
+                lanes_filename = &argv[1][2];
+                testsuite_run_check(LANES, lanes_filename);
+                break;
+            case 'D': /* fall through */
+            case 'd':
+                ruleedit_filename = &argv[1][2];
+                testsuite_run_check(RULEEDIT, ruleedit_filename);
+                break;
+            case 'V': /* fall through */
+            case 'v':
+                overlay_filename = &argv[1][2];
+                testsuite_run_check(OVERLAY, overlay_filename);
+                break;
+            case 'F': /* fall through */
+            case 'f':
+                effective_filename = &argv[1][2];
+                testsuite_run_check(EFFECTIVE, effective_filename);
+                break;
+            case 'G': /* fall through */
+            case 'g':
+                observed_filename = &argv[1][2];
+                testsuite_run_check(OBSERVED, observed_filename);
+                break;
+            case 'N': /* fall through */
+            case 'n':
+                diff_filename = &argv[1][2];
+                testsuite_run_check(RULEDIFF, diff_filename);
+                break;
+            case 'P': /* fall through */
+            case 'p':
+                nextcourtday_filename = &argv[1][2];
+                testsuite_run_check(NEXTCOURTDAY, nextcourtday_filename);
+                break;
+            case 'Q': /* fall through */
+            case 'q':
+                enumerate_filename = &argv[1][2];
+                testsuite_run_check(ENUMERATE, enumerate_filename);
+                break;
+            case 'S': /* fall through */
+            case 's':
+                periodstats_filename = &argv[1][2];
+                testsuite_run_check(PERIODSTATS, periodstats_filename);
+                break;
+            case 'T': /* fall through */
+            case 't':
+                ordinal_filename = &argv[1][2];
+                testsuite_run_check(ORDINAL, ordinal_filename);
+                break;
+            case 'X': /* fall through */
+            case 'x':
+                explain_filename = &argv[1][2];
+                testsuite_run_check(EXPLAIN, explain_filename);
+                break;
+            case 'Y': /* fall through */
+            case 'y':
+                chain_filename = &argv[1][2];
+                testsuite_run_check(CHAIN, chain_filename);
+                break;
+            case 'Z': /* fall through */
+            case 'z':
+                chainbatch_filename = &argv[1][2];
+                testsuite_run_check(CHAINBATCH, chainbatch_filename);
+                break;
+            case 'A': /* fall through */
+            case 'a':
+                chaininstance_filename = &argv[1][2];
+                testsuite_run_check(CHAININSTANCE, chaininstance_filename);
+                break;
             case 'C': /* fall through */
             case 'c':
                 datecalc_filename = &argv[1][2];
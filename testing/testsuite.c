@@ -24,8 +24,12 @@
  */
 
 /* #####   HEADER FILE INCLUDES   ########################################### */
+
+#define _POSIX_C_SOURCE 200809L /* mkdtemp, opendir */
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
 #include "../include/datetools.h"
 #include "../include/timetools.h"
 #include "testsuite.h"
@@ -148,6 +152,75 @@ void testsuite_run_check(enum TESTFILETYPES testtype, const char *testfile_name)
             testsuite_compute_courtdays(testfile);
             fclose(testfile);
             break;
+        case CACHEBUDGET:
+            testfile = fopen(testfile_name, "r");
+            if (testfile == NULL) {
+                fprintf (stderr, "couldn't open file '%s'; %s\n",
+                         testfile_name, strerror(errno));
+                exit (EXIT_FAILURE);
+            }
+            testsuite_check_cachebudget(testfile);
+            fclose(testfile);
+            break;
+        case RULESTATS:
+            testfile = fopen(testfile_name, "r");
+            if (testfile == NULL) {
+                fprintf (stderr, "couldn't open file '%s'; %s\n",
+                         testfile_name, strerror(errno));
+                exit (EXIT_FAILURE);
+            }
+            testsuite_check_rulestats(testfile);
+            fclose(testfile);
+            break;
+        case COMPOSITE: /* the file is a second set of holiday rules */
+            testsuite_check_composite(testfile_name);
+            break;
+        case REGISTRY: /* the file is the directory of holiday rules */
+            testsuite_check_registry(testfile_name);
+            testsuite_check_store(testfile_name);
+            break;
+        case LANES: /* the file is a second set of holiday rules */
+            testsuite_check_lanes(testfile_name);
+            break;
+        case RULEEDIT: /* the file is a second set of holiday rules */
+            testsuite_check_ruleedit(testfile_name);
+            break;
+        case OVERLAY: /* the file is a second set of holiday rules */
+            testsuite_check_overlay(testfile_name);
+            break;
+        case EFFECTIVE: /* the file is a set of holiday rules with dates */
+            testsuite_check_effective(testfile_name);
+            break;
+        case OBSERVED: /* the file is a set of observed and Easter rules */
+            testsuite_check_observed(testfile_name);
+            break;
+        case RULEDIFF: /* the file is a set of holiday rules */
+            testsuite_check_diff(testfile_name);
+            break;
+        case NEXTCOURTDAY: /* the file is a set of holiday rules */
+            testsuite_check_nextcourtday(testfile_name);
+            break;
+        case ENUMERATE: /* the file is a set of holiday rules */
+            testsuite_check_enumerate(testfile_name);
+            break;
+        case PERIODSTATS: /* the file is a set of holiday rules */
+            testsuite_check_periodstats(testfile_name);
+            break;
+        case ORDINAL: /* the file is a set of holiday rules */
+            testsuite_check_ordinal(testfile_name);
+            break;
+        case EXPLAIN: /* the file is a set of holiday rules */
+            testsuite_check_explain(testfile_name);
+            break;
+        case CHAIN: /* the file is a set of holiday rules */
+            testsuite_check_chain(testfile_name);
+            break;
+        case CHAINBATCH: /* the file is a set of holiday rules */
+            testsuite_check_chainbatch(testfile_name);
+            break;
+        case CHAININSTANCE: /* the file is a set of holiday rules */
+            testsuite_check_chaininstance(testfile_name);
+            break;
         default:
             /* do nothing */
             break;
@@ -486,6 +559,120 @@ void testsuite_check_courtmath(FILE *openedtestfile)
     return;
 }
 
+/* Counts numdays days (court days if courtdays) from jdn one day at a time,
+ * skipping tolled days, as a reference */
+static int tolled_step(int jdn, int numdays,
+                       const struct HolidayTolledPeriod tolled[],
+                       int numtolled, int courtdays)
+{
+    struct DateTime testdate;
+    int fwd_back = numdays < 0 ? -1 : 1;
+    int counted;
+    int period;
+
+    while (numdays != 0) {
+        jdn += fwd_back;
+        counted = 1;
+        for (period = 0; period < numtolled; period++) {
+            if (jdn >= tolled[period].firstjdn && jdn <= tolled[period].lastjdn)
+                counted = 0;
+        }
+        if (counted && courtdays) {
+            jdn2greg(jdn, &testdate);
+            counted = !isholiday(&testdate);
+        }
+        if (counted)
+            numdays -= fwd_back;
+    }
+    return jdn;
+}
+
+/* Sets a tolled period of numdays days starting on the given date */
+static void tolled_set(struct HolidayTolledPeriod *tolled, int year,
+                       int month, int day, int numdays)
+{
+    struct DateTime firstdate;
+
+    firstdate.year = year;
+    firstdate.month = month;
+    firstdate.day = day;
+    tolled->firstjdn = jdncnvrt(&firstdate);
+    tolled->lastjdn = tolled->firstjdn + numdays - 1;
+    return;
+}
+
+/* Checks one tolled offset against tolled_step() */
+static void tolled_check(struct teststats *stats, const char *label,
+                         int courtdays, int year, int month, int day,
+                         int numdays,
+                         const struct HolidayTolledPeriod tolled[],
+                         int numtolled)
+{
+    struct DateTime start_date;
+    struct DateTime tolled_date;
+    char datestring1[DATESTRINGLEN];
+    char datestring2[DATESTRINGLEN];
+    char message[MAXMESSAGELEN];
+    int expected;
+
+    start_date.year = year;
+    start_date.month = month;
+    start_date.day = day;
+    expected = tolled_step(jdncnvrt(&start_date), numdays, tolled, numtolled,
+                           courtdays);
+    memset(&tolled_date, 0xff, sizeof(tolled_date)); /* no stale weekday */
+    if (courtdays)
+        tolled_courtday_offset(&start_date, &tolled_date, numdays, tolled,
+                               numtolled);
+    else
+        tolled_date_offset(&start_date, &tolled_date, numdays, tolled,
+                           numtolled);
+    date_to_string(datestring1, &start_date, MDY);
+    date_to_string(datestring2, &tolled_date, MDY);
+    sprintf(message, "Tolled, %s: %d from %s: %s.", label, numdays,
+            datestring1, datestring2);
+    stats->ttl_tests++;
+    if (jdncnvrt(&tolled_date) == expected &&
+            (int) tolled_date.day_of_week == derive_weekday(&tolled_date)) {
+        stats->successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+    return;
+}
+
+/* Tolled offsets with many, overlapping, and year-end periods, backward, and
+ * from inside a period, in calendar days or court days */
+static void tolled_check_all(struct teststats *stats, int courtdays)
+{
+    struct HolidayTolledPeriod tolled[24];
+    int month;
+
+    for (month = 1; month <= 12; month++) { /* the 1st - 5th of each month */
+        tolled_set(&tolled[month - 1], 2024, month, 1, 5);
+        tolled_set(&tolled[month + 11], 2025, month, 1, 5);
+    }
+    tolled_check(stats, "24 periods", courtdays, 2024, 1, 1, 300, tolled, 24);
+    tolled_check(stats, "24 periods", courtdays, 2025, 12, 31, -300, tolled,
+                 24);
+
+    tolled_set(&tolled[0], 2024, 3, 15, 11); /* 3/15 - 3/25 */
+    tolled_set(&tolled[1], 2024, 3, 10, 10); /* 3/10 - 3/19 */
+    tolled_set(&tolled[2], 2024, 3, 12, 2); /* inside both */
+    tolled_check(stats, "overlapping", courtdays, 2024, 3, 1, 30, tolled, 3);
+    tolled_check(stats, "overlapping", courtdays, 2024, 4, 20, -30, tolled, 3);
+    tolled_check(stats, "inside", courtdays, 2024, 3, 12, 5, tolled, 3);
+    tolled_check(stats, "inside", courtdays, 2024, 3, 12, -5, tolled, 3);
+
+    tolled_set(&tolled[0], 2023, 12, 20, 22); /* 12/20/2023 - 1/10/2024 */
+    tolled_check(stats, "year end", courtdays, 2023, 12, 15, 20, tolled, 1);
+    tolled_check(stats, "year end", courtdays, 2024, 1, 20, -20, tolled, 1);
+    tolled_check(stats, "year end", courtdays, 2023, 12, 31, 3, tolled, 1);
+    return;
+}
+
 void testsuite_compute_caldays(FILE *openedtestfile)
 {
     struct DateTime start_date;
@@ -499,6 +686,8 @@ void testsuite_compute_caldays(FILE *openedtestfile)
     char message[MAXMESSAGELEN];
     char message2[MAXMESSAGELEN];
     struct teststats calmath_stats;
+    struct DateTime tolled_date;
+    struct HolidayTolledPeriod tolled;
 
     calmath_stats.ttl_tests = 0;
     calmath_stats.successful_tests = 0;
@@ -523,11 +712,13 @@ void testsuite_compute_caldays(FILE *openedtestfile)
             sprintf(message, "Subtracting %d calendar days from %s... ", day_count,
                     datestring1);
         date_offset(&start_date, &computed_date, day_count);
+        tolled_date_offset(&start_date, &tolled_date, day_count, NULL, 0);
         date_to_string(datestring2, &computed_date, MDY);
         calmath_stats.ttl_tests++;
         sprintf(message2, "Result: %s.", datestring2);
         strcat(message, message2); 
-        if (jdncnvrt(&computed_date) == jdncnvrt(&expected_result)) {
+        if (jdncnvrt(&computed_date) == jdncnvrt(&expected_result) &&
+                jdncnvrt(&tolled_date) == jdncnvrt(&expected_result)) {
             calmath_stats.successful_tests++;
             message_right_justify(message, "PASS", SCREENWIDTH);
         } else {
@@ -536,6 +727,33 @@ void testsuite_compute_caldays(FILE *openedtestfile)
         
         display_results(message, TESTING);
     }
+
+    /* 30 days from 3/1/2024 with the clock stopped 3/10 - 3/19 */
+    start_date.year = 2024;
+    start_date.month = 3;
+    start_date.day = 10;
+    tolled.firstjdn = jdncnvrt(&start_date);
+    tolled.lastjdn = tolled.firstjdn + 9;
+    start_date.day = 1;
+    memset(&tolled_date, 0xff, sizeof(tolled_date)); /* no stale weekday */
+    tolled_date_offset(&start_date, &tolled_date, 30, &tolled, 1);
+    date_to_string(datestring2, &tolled_date, MDY);
+    sprintf(message, "30 days from 3/1/2024, tolled 3/10-3/19: %s.",
+            datestring2);
+    calmath_stats.ttl_tests++;
+    expected_result.year = 2024;
+    expected_result.month = 4;
+    expected_result.day = 10;
+    if (jdncnvrt(&tolled_date) == jdncnvrt(&expected_result) &&
+            (int) tolled_date.day_of_week == derive_weekday(&tolled_date)) {
+        calmath_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+    tolled_check_all(&calmath_stats, 0);
+
     display_stats(&calmath_stats);
     display_results(NULL, END_FRAME);
     return;
@@ -554,6 +772,8 @@ void testsuite_compute_courtdays(FILE *openedtestfile)
     char message[MAXMESSAGELEN];
     char message2[MAXMESSAGELEN];
     struct teststats math_stats;
+    struct DateTime tolled_date;
+    struct HolidayTolledPeriod tolled;
 
     math_stats.ttl_tests = 0;
     math_stats.successful_tests = 0;
@@ -578,11 +798,14 @@ void testsuite_compute_courtdays(FILE *openedtestfile)
             sprintf(message, "Subtracting %d court days from %s... ", day_count,
                     datestring1);
         courtday_offset(&start_date, &computed_date, day_count);
+        tolled_courtday_offset(&start_date, &tolled_date, day_count, NULL,
+                               0);
         date_to_string(datestring2, &computed_date, MDY);
         math_stats.ttl_tests++;
         sprintf(message2, "Result: %s.", datestring2);
         strcat(message, message2); 
-        if (jdncnvrt(&computed_date) == jdncnvrt(&expected_result)) {
+        if (jdncnvrt(&computed_date) == jdncnvrt(&expected_result) &&
+                jdncnvrt(&tolled_date) == jdncnvrt(&expected_result)) {
             math_stats.successful_tests++;
             message_right_justify(message, "PASS", SCREENWIDTH);
         } else {
@@ -591,11 +814,2613 @@ void testsuite_compute_courtdays(FILE *openedtestfile)
         
         display_results(message, TESTING);
     }
+
+    /* 10 court days from Mon 6/3/2024 with the clock stopped 6/10 - 6/14:
+     * four are counted before the stay, and the other six after it ends */
+    start_date.year = 2024;
+    start_date.month = 6;
+    start_date.day = 10;
+    tolled.firstjdn = jdncnvrt(&start_date);
+    tolled.lastjdn = tolled.firstjdn + 4;
+    start_date.day = 14;
+    courtday_offset(&start_date, &expected_result, 6);
+    start_date.day = 3;
+    memset(&tolled_date, 0xff, sizeof(tolled_date)); /* no stale weekday */
+    tolled_courtday_offset(&start_date, &tolled_date, 10, &tolled, 1);
+    date_to_string(datestring2, &tolled_date, MDY);
+    sprintf(message, "10 court days from 6/3/2024, tolled 6/10-6/14: %s.",
+            datestring2);
+    math_stats.ttl_tests++;
+    if (jdncnvrt(&tolled_date) == jdncnvrt(&expected_result) &&
+            (int) tolled_date.day_of_week == derive_weekday(&tolled_date)) {
+        math_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+    tolled_check_all(&math_stats, 1);
+
     display_stats(&math_stats);
     display_results(NULL, END_FRAME);
     return;
 }
 
+/* Checks the dates of 2021 over and over, then exits */
+static void *cache_hot_thread(void *arg)
+{
+    struct DateTime testdate;
+    long *holidays = arg;
+    int query;
+
+    for (query = 0; query < 1024; query++) {
+        testdate.year = 2021;
+        testdate.month = query % 12 + 1;
+        testdate.day = query % 28 + 1;
+        *holidays += isholiday(&testdate);
+    }
+    return NULL;
+}
+
+/*
+ * Reruns the court-day difference script with a cache budget of a single
+ * year, so the years in the script keep evicting one another.  The results
+ * must not change, and the cache statistics must show the evictions.  Then
+ * precomputes the script's years on worker threads and checks that running
+ * the script again compiles nothing.
+ */
+
+void testsuite_check_cachebudget(FILE *openedtestfile)
+{
+    struct DateTime start_date;
+    struct DateTime end_date;
+    struct HolidayCacheStats cache_stats;
+    struct HolidayPrecompute *job;
+    pthread_t thread;
+    long holidays;
+    char line[100];
+    int computed_days = 9999;
+    int expected_result = 0;
+    int capacity;
+    char datestring1[DATESTRINGLEN];
+    char datestring2[DATESTRINGLEN];
+    char message[MAXMESSAGELEN];
+    char message2[MAXMESSAGELEN];
+    struct teststats cache_test_stats;
+
+    cache_test_stats.ttl_tests = 0;
+    cache_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Calendar Cache Under A Small Budget", BUILD_FRAME);
+
+    holiday_cache_get_stats(&cache_stats);
+    capacity = holiday_cache_set_budget(cache_stats.calendar_bytes);
+    sprintf(message, "Budget set to %d year(s).", capacity);
+    display_results(message, TESTING);
+
+    /* read and discard the headers */
+    fgets(line, sizeof(line), openedtestfile);
+
+    while (fgets(line, sizeof(line), openedtestfile) != NULL) {
+        sscanf(line, "%d,%d,%d,%d,%d,%d,%d", &start_date.year,
+               &start_date.month, &start_date.day, &end_date.year,
+               &end_date.month, &end_date.day, &expected_result);
+
+        date_to_string(datestring1, &start_date, MDY);
+        date_to_string(datestring2, &end_date, MDY);
+        sprintf(message, "Court days between %s and %s... ",
+                datestring1, datestring2);
+        computed_days = courtday_difference(start_date, end_date);
+        cache_test_stats.ttl_tests++;
+        sprintf(message2, "Result: %d days.", computed_days);
+        strcat(message, message2);
+        if (computed_days == expected_result) {
+            cache_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    holiday_cache_get_stats(&cache_stats);
+    sprintf(message, "Hits %lu, misses %lu, evictions %lu, %d resident... ",
+            cache_stats.hits, cache_stats.misses, cache_stats.evictions,
+            cache_stats.resident);
+    cache_test_stats.ttl_tests++;
+    if (cache_stats.evictions > 0 && cache_stats.hits > 0 &&
+            cache_stats.resident <= capacity) {
+        cache_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_cache_set_budget(64 * 1024); /* back to the default */
+
+    /* Precompute the script's years; the script must then never miss. */
+    job = holiday_cache_precompute(2019, 2022, 2, NULL, NULL);
+    holiday_precompute_wait(job);
+    holiday_cache_reset_stats();
+    fseek(openedtestfile, 0L, SEEK_SET);
+    clearerr(openedtestfile);
+    fgets(line, sizeof(line), openedtestfile);
+    while (fgets(line, sizeof(line), openedtestfile) != NULL) {
+        sscanf(line, "%d,%d,%d,%d,%d,%d,%d", &start_date.year,
+               &start_date.month, &start_date.day, &end_date.year,
+               &end_date.month, &end_date.day, &expected_result);
+        courtday_difference(start_date, end_date);
+    }
+    holiday_cache_get_stats(&cache_stats);
+    sprintf(message, "After precomputing 2019-2022: %lu misses... ",
+            cache_stats.misses);
+    cache_test_stats.ttl_tests++;
+    if (cache_stats.misses == 0 && cache_stats.resident == 4) {
+        cache_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* hits on another thread's own copies reach the count as it goes, not
+     * only when that thread misses */
+    holiday_cache_reset_stats();
+    holidays = 0;
+    if (pthread_create(&thread, NULL, cache_hot_thread, &holidays) == 0)
+        pthread_join(thread, NULL);
+    holiday_cache_get_stats(&cache_stats);
+    sprintf(message, "Hits from a thread's own copies: %lu of 1024... ",
+            cache_stats.hits);
+    cache_test_stats.ttl_tests++;
+    if (cache_stats.hits >= 1024 - 256 && cache_stats.hits <= 1024) {
+        cache_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    display_stats(&cache_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/*
+ * Runs the court-day difference script with the cache off, so every date is
+ * checked against the rules, then reorders the rules by how often they
+ * matched and runs the script again.  The results must not change, the rules
+ * must come out in order of hits, and no more rules may be tested than before.
+ */
+
+#define MAXTESTRULES 64
+
+static unsigned long rulestats_run(FILE *openedtestfile, int *failures)
+{
+    struct DateTime start_date;
+    struct DateTime end_date;
+    struct HolidayRuleStats rule_stats[MAXTESTRULES];
+    char line[100];
+    int expected_result = 0;
+    int numrules;
+    int idx;
+    unsigned long checks = 0;
+
+    holiday_rules_reset_stats();
+    fseek(openedtestfile, 0L, SEEK_SET);
+    clearerr(openedtestfile);
+    fgets(line, sizeof(line), openedtestfile); /* discard the headers */
+    while (fgets(line, sizeof(line), openedtestfile) != NULL) {
+        sscanf(line, "%d,%d,%d,%d,%d,%d,%d", &start_date.year,
+               &start_date.month, &start_date.day, &end_date.year,
+               &end_date.month, &end_date.day, &expected_result);
+        if (courtday_difference(start_date, end_date) != expected_result)
+            (*failures)++;
+    }
+
+    numrules = holiday_rules_get_stats(rule_stats, MAXTESTRULES);
+    for (idx = 0; idx < numrules && idx < MAXTESTRULES; idx++)
+        checks += rule_stats[idx].checks;
+    return checks;
+}
+
+void testsuite_check_rulestats(FILE *openedtestfile)
+{
+    struct HolidayRuleStats rule_stats[MAXTESTRULES];
+    char message[MAXMESSAGELEN];
+    struct teststats rule_test_stats;
+    unsigned long before;
+    unsigned long after;
+    int failures = 0;
+    int inorder = 1;
+    int numrules;
+    int idx;
+
+    rule_test_stats.ttl_tests = 0;
+    rule_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Rule Statistics And Reordering", BUILD_FRAME);
+
+    holiday_cache_set_budget(0); /* check every date against the rules */
+    before = rulestats_run(openedtestfile, &failures);
+
+    numrules = holiday_rules_get_stats(rule_stats, MAXTESTRULES);
+    for (idx = 0; idx < numrules && idx < MAXTESTRULES; idx++) {
+        if ((rule_stats[idx].ruletype == 'w' ||
+                    rule_stats[idx].ruletype == 'W') &&
+                rule_stats[idx].hits > 0) {
+            sprintf(message, "%s matched %lu of %lu tests.",
+                    rule_stats[idx].holidayname, rule_stats[idx].hits,
+                    rule_stats[idx].checks);
+            display_results(message, TESTING);
+        }
+    }
+
+    holiday_rules_reorder();
+    after = rulestats_run(openedtestfile, &failures);
+
+    numrules = holiday_rules_get_stats(rule_stats, MAXTESTRULES);
+    for (idx = 1; idx < numrules && idx < MAXTESTRULES; idx++) {
+        if (rule_stats[idx].month == rule_stats[idx - 1].month &&
+                rule_stats[idx].hits > rule_stats[idx - 1].hits)
+            inorder = 0;
+    }
+    holiday_cache_set_budget(64 * 1024); /* back to the default */
+
+    sprintf(message, "Same results after reordering (%d wrong)... ",
+            failures);
+    rule_test_stats.ttl_tests++;
+    if (failures == 0) {
+        rule_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Rules tested: %lu before, %lu after... ", before, after);
+    rule_test_stats.ttl_tests++;
+    if (before > 0 && after <= before && inorder) {
+        rule_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    display_stats(&rule_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/*
+ * Loads a second set of holiday rules next to the active one and combines
+ * the two.  Over several years, every day must be closed under the union
+ * exactly when it is closed under either set, and under the intersection
+ * exactly when it is closed under both.  A few known dates are then checked.
+ */
+
+struct CompositeCheck {
+    int year;
+    int month;
+    int day;
+    int unionclosed;
+    int intersectionclosed;
+};
+
+void testsuite_check_composite(const char *rulefile_name)
+{
+    static const struct CompositeCheck knowndates[] = {
+        {2023, 6, 19, 1, 0}, /* Juneteenth: federal only */
+        {2023, 3, 31, 1, 0}, /* Cesar Chavez Day: California only */
+        {2023, 11, 24, 1, 0}, /* Day after Thanksgiving: California only */
+        {2023, 7, 4, 1, 1}, /* Independence Day: both */
+        {2023, 7, 5, 0, 0} /* a Wednesday: neither */
+    };
+    struct RuleSet *active;
+    struct RuleSet *loaded;
+    struct RuleSet *either;
+    struct RuleSet *both;
+    struct DateTime testdate;
+    char datestring[DATESTRINGLEN];
+    char message[MAXMESSAGELEN];
+    struct teststats composite_test_stats;
+    int unionwrong = 0;
+    int intersectionwrong = 0;
+    int closeda, closedb;
+    int jdn, lastjdn;
+    int idx;
+
+    composite_test_stats.ttl_tests = 0;
+    composite_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Composite Rule Sets", BUILD_FRAME);
+
+    active = holiday_ruleset_active();
+    loaded = holiday_ruleset_load(rulefile_name);
+    either = holiday_ruleset_union(active, loaded);
+    both = holiday_ruleset_intersection(active, loaded);
+    composite_test_stats.ttl_tests++;
+    if (loaded == NULL || either == NULL || both == NULL) {
+        sprintf(message, "Could not load %s... ", rulefile_name);
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+        display_results(message, TESTING);
+        display_stats(&composite_test_stats);
+        display_results(NULL, END_FRAME);
+        return;
+    }
+    composite_test_stats.successful_tests++;
+
+    testdate.year = 2019;
+    testdate.month = 1;
+    testdate.day = 1;
+    jdn = jdncnvrt(&testdate);
+    testdate.year = 2024;
+    testdate.month = 12;
+    testdate.day = 31;
+    lastjdn = jdncnvrt(&testdate);
+    for (; jdn <= lastjdn; jdn++) {
+        jdn2greg(jdn, &testdate);
+        closeda = holiday_ruleset_isholiday(active, &testdate);
+        closedb = holiday_ruleset_isholiday(loaded, &testdate);
+        if (holiday_ruleset_isholiday(either, &testdate) != (closeda || closedb))
+            unionwrong++;
+        if (holiday_ruleset_isholiday(both, &testdate) != (closeda && closedb))
+            intersectionwrong++;
+    }
+
+    sprintf(message, "Union, 2019-2024 (%d days wrong)... ", unionwrong);
+    composite_test_stats.ttl_tests++;
+    if (unionwrong == 0) {
+        composite_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Intersection, 2019-2024 (%d days wrong)... ",
+            intersectionwrong);
+    composite_test_stats.ttl_tests++;
+    if (intersectionwrong == 0) {
+        composite_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    for (idx = 0; idx < (int) (sizeof(knowndates) / sizeof(knowndates[0]));
+            idx++) {
+        testdate.year = knowndates[idx].year;
+        testdate.month = knowndates[idx].month;
+        testdate.day = knowndates[idx].day;
+        date_to_string(datestring, &testdate, MDY);
+        sprintf(message, "%s: union %d, intersection %d... ", datestring,
+                knowndates[idx].unionclosed,
+                knowndates[idx].intersectionclosed);
+        composite_test_stats.ttl_tests++;
+        if (holiday_ruleset_isholiday(either, &testdate) ==
+                knowndates[idx].unionclosed &&
+                holiday_ruleset_isholiday(both, &testdate) ==
+                knowndates[idx].intersectionclosed) {
+            composite_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    sprintf(message, "Close refused while a composite depends on it... ");
+    composite_test_stats.ttl_tests++;
+    if (holiday_ruleset_close(loaded) == -1 &&
+            holiday_ruleset_close(active) == -1 &&
+            holiday_ruleset_close(either) == 0 &&
+            holiday_ruleset_close(both) == 0 &&
+            holiday_ruleset_close(loaded) == 0) {
+        composite_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    display_stats(&composite_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/*
+ * Registers three jurisdictions: two whose rule files differ but hold the
+ * same rules, and the federal rules.  The first two must share one set of
+ * compiled calendars and agree on every day; the third must not share.
+ * Editing the first must leave the second's answers as they were.
+ */
+
+void testsuite_check_registry(const char *ruledir_name)
+{
+    static const struct HolidayRuleSpec newholiday = {MARCH, 'A', 0, 0, 17,
+        "St. Patrick's Day", "none", 0, 0, 0, 0};
+    struct HolidayJurisdictionStats la_stats;
+    struct HolidayJurisdictionStats sf_stats;
+    struct HolidayJurisdictionStats fed_stats;
+    struct RuleSet *la;
+    struct RuleSet *sf;
+    struct RuleSet *fed;
+    struct RuleSet *reference;
+    struct DateTime testdate;
+    struct DateTime stpatrick;
+    char filename[FILENAME_MAX];
+    char message[MAXMESSAGELEN];
+    struct teststats registry_test_stats;
+    size_t poolbefore;
+    int budgetyears;
+    int year;
+    int disagree = 0;
+    int edited;
+    int jdn, lastjdn;
+
+    registry_test_stats.ttl_tests = 0;
+    registry_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Jurisdiction Registry", BUILD_FRAME);
+
+    sprintf(filename, "%.*s/holidays_casuper.csv", FILENAME_MAX - 64,
+            ruledir_name);
+    holiday_registry_add("CA-LA", filename);
+    sprintf(filename, "%.*s/crlf_files/holidays_casuper_CRLF.csv",
+            FILENAME_MAX - 64, ruledir_name);
+    holiday_registry_add("CA-SF", filename);
+    sprintf(filename, "%.*s/holidays_federal.csv", FILENAME_MAX - 64,
+            ruledir_name);
+    holiday_registry_add("US-FED", filename);
+
+    sprintf(message, "Unknown and duplicate jurisdictions refused... ");
+    registry_test_stats.ttl_tests++;
+    holiday_registry_get_stats("CA-SF", &sf_stats);
+    if (holiday_registry_get("XX-NONE") == NULL &&
+            holiday_registry_add("CA-LA", filename) == -1 &&
+            sf_stats.loaded == 0) {
+        registry_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    la = holiday_registry_get("CA-LA");
+    holiday_registry_get_stats("CA-LA", &la_stats);
+    poolbefore = la_stats.pool_bytes;
+    sf = holiday_registry_get("CA-SF");
+    fed = holiday_registry_get("US-FED");
+
+    testdate.year = 2021;
+    testdate.month = 1;
+    testdate.day = 1;
+    jdn = jdncnvrt(&testdate);
+    testdate.year = 2022;
+    testdate.month = 12;
+    testdate.day = 31;
+    lastjdn = jdncnvrt(&testdate);
+    for (; la != NULL && sf != NULL && jdn <= lastjdn; jdn++) {
+        jdn2greg(jdn, &testdate);
+        if (holiday_ruleset_isholiday(la, &testdate) !=
+                holiday_ruleset_isholiday(sf, &testdate))
+            disagree++;
+    }
+    if (fed != NULL) {
+        jdn2greg(lastjdn, &testdate);
+        holiday_ruleset_isholiday(fed, &testdate);
+    }
+
+    holiday_registry_get_stats("CA-LA", &la_stats);
+    holiday_registry_get_stats("CA-SF", &sf_stats);
+    holiday_registry_get_stats("US-FED", &fed_stats);
+
+    sprintf(message, "CA-SF agrees with CA-LA (%d days differ)... ",
+            disagree);
+    registry_test_stats.ttl_tests++;
+    if (la != NULL && sf != NULL && disagree == 0) {
+        registry_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Calendars shared %d/%d/%d ways, %lu/%lu/%lu bytes... ",
+            la_stats.sharers, sf_stats.sharers, fed_stats.sharers,
+            (unsigned long) la_stats.resident_bytes,
+            (unsigned long) sf_stats.resident_bytes,
+            (unsigned long) fed_stats.resident_bytes);
+    registry_test_stats.ttl_tests++;
+    if (la_stats.sharers == 2 && sf_stats.sharers == 2 &&
+            fed_stats.sharers == 1 && sf_stats.calendar_bytes > 0 &&
+            sf_stats.resident_bytes ==
+            sf_stats.rule_bytes + sf_stats.calendar_bytes / 2) {
+        registry_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* each jurisdiction's cache is sized and measured on its own; CA-LA and
+     * CA-SF share one */
+    sprintf(message, "Per-jurisdiction cache budgets and stats... ");
+    registry_test_stats.ttl_tests++;
+    budgetyears = holiday_registry_set_cache_budget("US-FED",
+            3 * fed_stats.cache.calendar_bytes);
+    for (year = 2020; fed != NULL && year <= 2023; year++) {
+        testdate.year = year;
+        testdate.month = 7;
+        testdate.day = 4;
+        holiday_ruleset_isholiday(fed, &testdate);
+    }
+    holiday_registry_get_stats("US-FED", &fed_stats);
+    holiday_registry_set_cache_budget("CA-SF", 2 * la_stats.cache.budget_bytes);
+    holiday_registry_get_stats("CA-LA", &la_stats);
+    if (budgetyears >= 1 && fed_stats.cache.capacity == budgetyears &&
+            fed_stats.cache.misses == 4 &&
+            fed_stats.cache.evictions == (unsigned long) (4 - budgetyears) &&
+            holiday_registry_set_cache_budget("XX-NONE", 0) == -1 &&
+            la_stats.cache.budget_bytes == 2 * sf_stats.cache.budget_bytes) {
+        registry_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Pool: %lu bytes before CA-SF, %lu after... ",
+            (unsigned long) poolbefore, (unsigned long) sf_stats.pool_bytes);
+    registry_test_stats.ttl_tests++;
+    if (sf_stats.pool_bytes == poolbefore) {
+        registry_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* editing the rule set that owns the shared calendars leaves its twin
+     * with the answers it had */
+    sprintf(filename, "%.*s/holidays_casuper.csv", FILENAME_MAX - 64,
+            ruledir_name);
+    reference = holiday_ruleset_load(filename);
+    stpatrick.year = 2021;
+    stpatrick.month = 3;
+    stpatrick.day = 17;
+    edited = la != NULL && sf != NULL && reference != NULL &&
+        holiday_ruleset_add_rule(la, &newholiday) == 0;
+    disagree = 0;
+    testdate.year = 2021;
+    testdate.month = 1;
+    testdate.day = 1;
+    jdn = jdncnvrt(&testdate);
+    for (; edited && jdn <= lastjdn; jdn++) {
+        jdn2greg(jdn, &testdate);
+        if (holiday_ruleset_isholiday(sf, &testdate) !=
+                holiday_ruleset_isholiday(reference, &testdate))
+            disagree++;
+    }
+    holiday_registry_get_stats("CA-LA", &la_stats);
+    holiday_registry_get_stats("CA-SF", &sf_stats);
+
+    sprintf(message, "CA-LA edited; CA-SF unchanged (%d days differ)... ",
+            disagree);
+    registry_test_stats.ttl_tests++;
+    if (edited && disagree == 0 &&
+            holiday_ruleset_isholiday(la, &stpatrick) == 1 &&
+            holiday_ruleset_isholiday(sf, &stpatrick) == 0 &&
+            la_stats.sharers == 1 && sf_stats.sharers == 1) {
+        registry_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+    holiday_ruleset_close(reference);
+
+    display_stats(&registry_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/* Counts the calendar files in dirname and names one other than skipname */
+static int store_files(const char *dirname, const char *skipname,
+                       char *foundname)
+{
+    struct dirent *entry;
+    DIR *dir;
+    int count = 0;
+
+    dir = opendir(dirname);
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "calendars-", 10) != 0)
+            continue;
+        count++;
+        if (foundname != NULL && strcmp(entry->d_name, skipname) != 0)
+            sprintf(foundname, "%.*s", FILENAME_MAX - 1, entry->d_name);
+    }
+    if (dir != NULL)
+        closedir(dir);
+    return count;
+}
+
+/* Copies a file, appending extra (if not NULL) to the copy */
+static int store_copy(const char *from, const char *to, const char *extra)
+{
+    FILE *in;
+    FILE *out;
+    char buffer[512];
+    size_t len;
+
+    in = fopen(from, "rb");
+    if (in == NULL)
+        return -1;
+    out = fopen(to, "wb");
+    if (out == NULL) {
+        fclose(in);
+        return -1;
+    }
+    while ((len = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        fwrite(buffer, 1, len, out);
+    if (extra != NULL)
+        fputs(extra, out);
+    fclose(in);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+/* Counts the days in 2019 - 2023 on which two rule sets disagree */
+static int store_disagree(struct RuleSet *first, struct RuleSet *second)
+{
+    struct DateTime testdate;
+    struct DateTime firstnext;
+    struct DateTime secondnext;
+    int disagree = 0;
+    int jdn, lastjdn;
+
+    testdate.year = 2019;
+    testdate.month = 1;
+    testdate.day = 1;
+    jdn = jdncnvrt(&testdate);
+    testdate.year = 2023;
+    testdate.month = 12;
+    testdate.day = 31;
+    lastjdn = jdncnvrt(&testdate);
+    for (; jdn <= lastjdn; jdn++) {
+        jdn2greg(jdn, &testdate);
+        holiday_ruleset_next_courtday(first, &testdate, &firstnext);
+        holiday_ruleset_next_courtday(second, &testdate, &secondnext);
+        if (holiday_ruleset_isholiday(first, &testdate) !=
+                holiday_ruleset_isholiday(second, &testdate) ||
+                jdncnvrt(&firstnext) != jdncnvrt(&secondnext))
+            disagree++;
+    }
+    return disagree;
+}
+
+/*
+ * Loads the federal rules with a cache directory, once to write the calendar
+ * file and once to map it, and checks them against the same rules compiled
+ * without one.  Then adds a holiday to the rules and checks that the old file
+ * is not used for them, even when copied over the new one's name.
+ */
+
+void testsuite_check_store(const char *ruledir_name)
+{
+    struct HolidayCacheStats written_stats;
+    struct HolidayCacheStats mapped_stats;
+    struct HolidayCacheStats edited_stats;
+    struct RuleSet *written;
+    struct RuleSet *mapped;
+    struct RuleSet *plain;
+    struct RuleSet *edited;
+    struct DateTime boxingday;
+    char storedir[] = "/tmp/datetimetools-XXXXXX";
+    char rulefile[FILENAME_MAX];
+    char oldfile[FILENAME_MAX];
+    char newfile[FILENAME_MAX];
+    char filename[FILENAME_MAX];
+    char message[MAXMESSAGELEN];
+    struct teststats store_test_stats;
+    int disagree;
+    int files;
+    int newfiles = 0;
+    int isnew = 0;
+    int iscopy = 0;
+
+    store_test_stats.ttl_tests = 0;
+    store_test_stats.successful_tests = 0;
+    oldfile[0] = newfile[0] = '\0';
+    boxingday.year = 2021;
+    boxingday.month = 12;
+    boxingday.day = 27; /* a Monday */
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("On-Disk Calendar Store", BUILD_FRAME);
+
+    if (mkdtemp(storedir) == NULL) {
+        fprintf(stderr, "couldn't make a cache directory; %s\n",
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    sprintf(filename, "%.*s/holidays_federal.csv", FILENAME_MAX - 64,
+            ruledir_name);
+    sprintf(rulefile, "%s/holidays.csv", storedir);
+    store_copy(filename, rulefile, NULL);
+
+    holiday_cache_set_dir(storedir, 2019, 2023);
+    written = holiday_ruleset_load(rulefile);
+    mapped = holiday_ruleset_load(rulefile);
+    holiday_cache_set_dir(NULL, 0, 0);
+    plain = holiday_ruleset_load(rulefile);
+    files = store_files(storedir, "", oldfile);
+    if (written == NULL || mapped == NULL || plain == NULL) {
+        fprintf(stderr, "couldn't load '%s'\n", rulefile);
+        exit(EXIT_FAILURE);
+    }
+    disagree = store_disagree(mapped, plain);
+    holiday_ruleset_get_cache_stats(written, &written_stats);
+    holiday_ruleset_get_cache_stats(mapped, &mapped_stats);
+
+    sprintf(message, "Written, then mapped: %d/%d years, %d file... ",
+            written_stats.mapped, mapped_stats.mapped, files);
+    store_test_stats.ttl_tests++;
+    if (written_stats.mapped == 5 && mapped_stats.mapped == 5 && files == 1) {
+        store_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Mapped years agree with compiled (%d days differ)... ",
+            disagree);
+    store_test_stats.ttl_tests++;
+    if (disagree == 0) {
+        store_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* the edited rules hash to a new file; the old one is left alone */
+    store_copy(filename, rulefile,
+               "\"12\",\"A\",\"27\",\"Boxing Day\",\"none\",\"\",\"\"\n");
+    holiday_cache_set_dir(storedir, 2019, 2023);
+    edited = holiday_ruleset_load(rulefile);
+    newfiles = store_files(storedir, oldfile, newfile);
+    edited_stats.mapped = 0;
+    if (edited != NULL) {
+        isnew = holiday_ruleset_isholiday(edited, &boxingday);
+        holiday_ruleset_get_cache_stats(edited, &edited_stats);
+        holiday_ruleset_close(edited);
+    }
+
+    sprintf(message, "Edited rules: %d files, %d years mapped... ",
+            newfiles, edited_stats.mapped);
+    store_test_stats.ttl_tests++;
+    if (newfiles == 2 && isnew == 1 && edited_stats.mapped == 5 &&
+            holiday_ruleset_isholiday(mapped, &boxingday) == 0) {
+        store_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* a file written for other rules is refused, even under the right name */
+    sprintf(filename, "%s/%s", storedir, oldfile);
+    sprintf(message, "%s/%s", storedir, newfile);
+    store_copy(filename, message, NULL);
+    edited = holiday_ruleset_load(rulefile);
+    edited_stats.mapped = 0;
+    if (edited != NULL) {
+        iscopy = holiday_ruleset_isholiday(edited, &boxingday);
+        holiday_ruleset_get_cache_stats(edited, &edited_stats);
+    }
+    holiday_cache_set_dir(NULL, 0, 0);
+
+    sprintf(message, "Old file under the new name is rewritten... ");
+    store_test_stats.ttl_tests++;
+    if (iscopy == 1 && edited_stats.mapped == 5) {
+        store_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(written);
+    holiday_ruleset_close(mapped);
+    holiday_ruleset_close(plain);
+    holiday_ruleset_close(edited);
+    sprintf(filename, "%s/%s", storedir, oldfile);
+    remove(filename);
+    sprintf(filename, "%s/%s", storedir, newfile);
+    remove(filename);
+    remove(rulefile);
+    remove(storedir);
+
+    display_stats(&store_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/* Counts numdays court days from jdn one day at a time, as a reference */
+static int lanes_step(struct RuleSet *rules, int jdn, int numdays)
+{
+    struct DateTime testdate;
+    int fwd_back = numdays < 0 ? -1 : 1;
+
+    while (numdays != 0) {
+        jdn += fwd_back;
+        jdn2greg(jdn, &testdate);
+        if (!holiday_ruleset_isholiday(rules, &testdate))
+            numdays -= fwd_back;
+    }
+    return jdn;
+}
+
+void testsuite_check_lanes(const char *rulefile_name)
+{
+    static const int offsets[] = {0, 1, -1, 10, -10, 400, -400};
+    struct HolidayRuleSpec everyday = {ALLMONTHS, 'W', 0, 0, 0,
+        "Closed", "none", 0, 0, 0, 0};
+    struct RuleSet *rules[3];
+    struct RuleSet *union_rules;
+    struct RuleSet *closedall;
+    struct HolidayLanes *lanes;
+    struct DateTime testdate;
+    struct DateTime results[3];
+    char message[MAXMESSAGELEN];
+    struct teststats lanes_test_stats;
+    unsigned long expected;
+    unsigned long closed;
+    int mismatches = 0;
+    int jdn, firstjdn, lastjdn;
+    int wkday;
+    int lane;
+    int idx;
+
+    lanes_test_stats.ttl_tests = 0;
+    lanes_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Multi-Jurisdiction Lanes", BUILD_FRAME);
+
+    rules[0] = holiday_ruleset_active();
+    rules[1] = holiday_ruleset_load(rulefile_name);
+    rules[2] = union_rules = holiday_ruleset_union(rules[0], rules[1]);
+    lanes = rules[1] != NULL && rules[2] != NULL ?
+        holiday_lanes_build(rules, 3, 2020, 2022) : NULL;
+
+    sprintf(message, "Lanes built for 3 rule sets, 2020-2022... ");
+    lanes_test_stats.ttl_tests++;
+    if (lanes != NULL && holiday_lanes_build(rules, 0, 2020, 2022) == NULL &&
+            holiday_lanes_build(rules, 3, 2022, 2020) == NULL) {
+        lanes_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+    if (lanes == NULL) {
+        display_stats(&lanes_test_stats);
+        display_results(NULL, END_FRAME);
+        return;
+    }
+
+    /* every day of the span, plus a month either side of it */
+    testdate.year = 2019;
+    testdate.month = 12;
+    testdate.day = 1;
+    firstjdn = jdncnvrt(&testdate);
+    testdate.year = 2023;
+    testdate.month = 1;
+    testdate.day = 31;
+    lastjdn = jdncnvrt(&testdate);
+    for (jdn = firstjdn; jdn <= lastjdn; jdn++) {
+        jdn2greg(jdn, &testdate);
+        expected = 0;
+        for (lane = 0; lane < 3; lane++) {
+            if (holiday_ruleset_isholiday(rules[lane], &testdate))
+                expected |= 1UL << lane;
+        }
+        holiday_lanes_closed_batch(lanes, &jdn, &closed, 1);
+        if (holiday_lanes_closed(lanes, &testdate) != expected ||
+                closed != expected)
+            mismatches++;
+    }
+    sprintf(message, "Lane masks match each rule set (%d days differ)... ",
+            mismatches);
+    lanes_test_stats.ttl_tests++;
+    if (mismatches == 0) {
+        lanes_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    testdate.year = 2022;
+    testdate.month = 11;
+    testdate.day = 23; /* the day before Thanksgiving */
+    jdn = jdncnvrt(&testdate);
+    for (idx = 0; idx < (int) (sizeof(offsets) / sizeof(offsets[0])); idx++) {
+        jdn2greg(jdn, &testdate);
+        holiday_lanes_courtday_offset(lanes, &testdate, offsets[idx],
+                                      results);
+        mismatches = 0;
+        for (lane = 0; lane < 3; lane++) {
+            if (results[lane].jdn != lanes_step(rules[lane], jdn,
+                        offsets[idx]) ||
+                    jdncnvrt(&results[lane]) != results[lane].jdn)
+                mismatches++;
+        }
+        sprintf(message, "Offset of %d court days in every lane... ",
+                offsets[idx]);
+        lanes_test_stats.ttl_tests++;
+        if (mismatches == 0) {
+            lanes_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    /* a lane with no court days at all stops at the end of the calendar */
+    holiday_lanes_release(lanes);
+    lanes = NULL;
+    closedall = holiday_ruleset_load(rulefile_name);
+    for (wkday = SUNDAY; closedall != NULL && wkday <= SATURDAY; wkday++) {
+        everyday.wkday = wkday;
+        holiday_ruleset_add_rule(closedall, &everyday);
+    }
+    rules[2] = closedall;
+    if (closedall != NULL)
+        lanes = holiday_lanes_build(rules, 3, 9998, 9999);
+    testdate.year = 9999;
+    testdate.month = 12;
+    testdate.day = 1;
+    memset(results, 0xff, sizeof(results)); /* no stale weekdays */
+    sprintf(message, "Lane with no court days runs out in 9999... ");
+    lanes_test_stats.ttl_tests++;
+    if (lanes != NULL &&
+            holiday_lanes_courtday_offset(lanes, &testdate, 10, results) ==
+            -1 && results[2].jdn == -1 &&
+            results[0].jdn == lanes_step(rules[0], jdncnvrt(&testdate), 10) &&
+            (int) results[0].day_of_week == derive_weekday(&results[0])) {
+        lanes_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+    holiday_ruleset_close(closedall);
+
+    holiday_lanes_release(lanes);
+    holiday_ruleset_close(union_rules);
+    holiday_ruleset_close(rules[1]);
+    display_stats(&lanes_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/* The same edits, applied to each rule set given */
+static int ruleedit_apply(struct RuleSet *rules)
+{
+    static const struct HolidayRuleSpec stpatrick = {MARCH, 'A', 0, 0, 17,
+        "St. Patrick's Day", "none", 0, 0, 0, 0};
+    static const struct HolidayRuleSpec juneteenth = {JUNE, 'A', 0, 0, 20,
+        "Juneteenth National Independence Day", "none", 0, 0, 0, 0};
+    int failures = 0;
+
+    failures -= holiday_ruleset_add_rule(rules, &stpatrick);
+    failures -= holiday_ruleset_remove_rule(rules, "Thanksgiving Day");
+    failures -= holiday_ruleset_replace_rule(rules,
+            "Juneteenth National Independence Day", &juneteenth);
+    return failures;
+}
+
+void testsuite_check_ruleedit(const char *rulefile_name)
+{
+    static const struct HolidayRuleSpec badmonth = {13, 'A', 0, 0, 1,
+        "Nonesuch", "none", 0, 0, 0, 0};
+    struct HolidayJurisdictionStats a_stats;
+    struct HolidayJurisdictionStats b_stats;
+    struct RuleSet *rules;
+    struct RuleSet *reference;
+    struct RuleSet *composite;
+    struct RuleSet *refcomposite;
+    struct RuleSet *a;
+    struct RuleSet *b;
+    struct DateTime testdate;
+    char message[MAXMESSAGELEN];
+    struct teststats edit_test_stats;
+    int failures;
+    int mismatches = 0;
+    int jdn, lastjdn;
+
+    edit_test_stats.ttl_tests = 0;
+    edit_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Rule Edits", BUILD_FRAME);
+
+    rules = holiday_ruleset_load(rulefile_name);
+    reference = holiday_ruleset_load(rulefile_name);
+    composite = holiday_ruleset_union(holiday_ruleset_active(), rules);
+    if (rules == NULL || reference == NULL || composite == NULL) {
+        sprintf(message, "Could not load %.40s... ", rulefile_name);
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+        display_results(message, TESTING);
+        edit_test_stats.ttl_tests++;
+        display_stats(&edit_test_stats);
+        display_results(NULL, END_FRAME);
+        return;
+    }
+
+    /* compile 2000 - 2030 before editing, so the edits patch them */
+    testdate.month = 1;
+    testdate.day = 1;
+    for (testdate.year = 2000; testdate.year <= 2030; testdate.year++)
+        holiday_ruleset_isholiday(composite, &testdate);
+
+    failures = ruleedit_apply(rules) + ruleedit_apply(reference);
+    refcomposite = holiday_ruleset_union(holiday_ruleset_active(), reference);
+
+    testdate.year = 1999;
+    testdate.month = 1;
+    testdate.day = 1;
+    jdn = jdncnvrt(&testdate);
+    testdate.year = 2031;
+    testdate.month = 12;
+    testdate.day = 31;
+    lastjdn = jdncnvrt(&testdate);
+    for (; refcomposite != NULL && jdn <= lastjdn; jdn++) {
+        jdn2greg(jdn, &testdate);
+        if (holiday_ruleset_isholiday(rules, &testdate) !=
+                holiday_ruleset_isholiday(reference, &testdate) ||
+                holiday_ruleset_isholiday(composite, &testdate) !=
+                holiday_ruleset_isholiday(refcomposite, &testdate))
+            mismatches++;
+    }
+    sprintf(message, "Patched years match a fresh compile (%d differ)... ",
+            mismatches);
+    edit_test_stats.ttl_tests++;
+    if (failures == 0 && refcomposite != NULL && mismatches == 0) {
+        edit_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    testdate.year = 2021;
+    testdate.month = 3;
+    testdate.day = 17;
+    failures = !holiday_ruleset_isholiday(rules, &testdate);
+    testdate.month = 11;
+    testdate.day = 25;
+    failures += holiday_ruleset_isholiday(rules, &testdate);
+    testdate.month = 6;
+    testdate.day = 18; /* a Friday */
+    failures += holiday_ruleset_isholiday(rules, &testdate);
+    sprintf(message, "Added, removed, and replaced holidays in 2021... ");
+    edit_test_stats.ttl_tests++;
+    if (failures == 0) {
+        edit_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Bad edits refused... ");
+    edit_test_stats.ttl_tests++;
+    if (holiday_ruleset_remove_rule(rules, "No Such Holiday") == -1 &&
+            holiday_ruleset_add_rule(rules, &badmonth) == -1 &&
+            holiday_ruleset_remove_rule(composite, "Labor Day") == -1) {
+        edit_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* a registry rule set sharing calendars must stop sharing when edited */
+    holiday_registry_add("EDIT-A", rulefile_name);
+    holiday_registry_add("EDIT-B", rulefile_name);
+    a = holiday_registry_get("EDIT-A");
+    b = holiday_registry_get("EDIT-B");
+    testdate.year = 2021;
+    testdate.month = 3;
+    testdate.day = 17;
+    failures = a == NULL || b == NULL;
+    if (!failures) {
+        holiday_ruleset_isholiday(a, &testdate);
+        failures = ruleedit_apply(b);
+        failures += holiday_ruleset_isholiday(a, &testdate);
+        failures += !holiday_ruleset_isholiday(b, &testdate);
+    }
+    holiday_registry_get_stats("EDIT-A", &a_stats);
+    holiday_registry_get_stats("EDIT-B", &b_stats);
+    sprintf(message, "Edited registry rules stop sharing calendars... ");
+    edit_test_stats.ttl_tests++;
+    if (failures == 0 && a_stats.loaded && b_stats.sharers == 1) {
+        edit_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(refcomposite);
+    holiday_ruleset_close(composite);
+    holiday_ruleset_close(reference);
+    holiday_ruleset_close(rules);
+    display_stats(&edit_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+#define OVERLAYDAYS 1827 /* 2020 - 2024 */
+
+/* Closed under the base with the reference states applied, as the overlay
+ * should be */
+static int overlay_expected(struct RuleSet *base, const char states[],
+                            int firstjdn, int jdn)
+{
+    struct DateTime testdate;
+
+    if (states[jdn - firstjdn] != OVERLAY_NONE)
+        return states[jdn - firstjdn] == OVERLAY_CLOSED;
+    jdn2greg(jdn, &testdate);
+    return holiday_ruleset_isholiday(base, &testdate);
+}
+
+/* Compares the overlay's court-day counts over pseudo-random ranges with a
+ * count of the reference, returning the number that differ */
+static int overlay_check_counts(struct HolidayOverlay *overlay,
+                                struct RuleSet *base, const char states[],
+                                int firstjdn)
+{
+    struct DateTime first, last;
+    unsigned long seed = 12345;
+    int mismatches = 0;
+    int from, to, jdn;
+    int count;
+    int range;
+
+    for (range = 0; range < 50; range++) {
+        seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+        from = firstjdn + (int) (seed % OVERLAYDAYS);
+        seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+        to = firstjdn + (int) (seed % OVERLAYDAYS);
+        if (from > to) {
+            jdn = from;
+            from = to;
+            to = jdn;
+        }
+        count = 0;
+        for (jdn = from; jdn <= to; jdn++)
+            count += !overlay_expected(base, states, firstjdn, jdn);
+        jdn2greg(from, &first);
+        jdn2greg(to, &last);
+        if (holiday_overlay_courtdays(overlay, &first, &last) != count)
+            mismatches++;
+    }
+    return mismatches;
+}
+
+void testsuite_check_overlay(const char *rulefile_name)
+{
+    static const struct HolidayRuleSpec stpatrick = {MARCH, 'A', 0, 0, 17,
+        "St. Patrick's Day", "none", 0, 0, 0, 0};
+    static char states[OVERLAYDAYS];
+    struct RuleSet *base;
+    struct HolidayOverlay *court;
+    struct HolidayOverlay *department;
+    struct DateTime testdate;
+    char message[MAXMESSAGELEN];
+    struct teststats overlay_test_stats;
+    unsigned long seed = 1;
+    int mismatches = 0;
+    int numdates = 0;
+    int firstjdn;
+    int update;
+    int idx;
+
+    overlay_test_stats.ttl_tests = 0;
+    overlay_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Closure Overlays", BUILD_FRAME);
+
+    base = holiday_ruleset_load(rulefile_name);
+    court = holiday_overlay_create(base);
+    department = holiday_overlay_create(base);
+    if (court == NULL || department == NULL) {
+        sprintf(message, "Could not load %.40s... ", rulefile_name);
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+        display_results(message, TESTING);
+        overlay_test_stats.ttl_tests++;
+        display_stats(&overlay_test_stats);
+        display_results(NULL, END_FRAME);
+        return;
+    }
+
+    testdate.year = 2020;
+    testdate.month = 1;
+    testdate.day = 1;
+    firstjdn = jdncnvrt(&testdate);
+
+    /* closures, openings, and clearings, some landing on the same dates */
+    for (update = 0; update < 3000; update++) {
+        seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+        idx = (int) (seed % OVERLAYDAYS);
+        states[idx] = (char) (seed / OVERLAYDAYS % 3);
+        jdn2greg(firstjdn + idx, &testdate);
+        holiday_overlay_set(court, &testdate, states[idx]);
+    }
+    for (idx = 0; idx < OVERLAYDAYS; idx++) {
+        numdates += states[idx] != OVERLAY_NONE;
+        jdn2greg(firstjdn + idx, &testdate);
+        if (holiday_overlay_isholiday(court, &testdate) !=
+                overlay_expected(base, states, firstjdn, firstjdn + idx))
+            mismatches++;
+    }
+    sprintf(message, "%d dates set; lookups match (%d differ)... ",
+            holiday_overlay_numdates(court), mismatches);
+    overlay_test_stats.ttl_tests++;
+    if (holiday_overlay_numdates(court) == numdates && mismatches == 0) {
+        overlay_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    mismatches = overlay_check_counts(court, base, states, firstjdn);
+    sprintf(message, "Court-day counts match (%d differ)... ", mismatches);
+    overlay_test_stats.ttl_tests++;
+    if (mismatches == 0) {
+        overlay_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_add_rule(base, &stpatrick);
+    mismatches = overlay_check_counts(court, base, states, firstjdn);
+    holiday_ruleset_remove_rule(base, "St. Patrick's Day");
+    mismatches += overlay_check_counts(court, base, states, firstjdn);
+    sprintf(message, "Counts follow edits to the base (%d differ)... ",
+            mismatches);
+    overlay_test_stats.ttl_tests++;
+    if (mismatches == 0) {
+        overlay_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    testdate.year = 2022;
+    testdate.month = 7;
+    testdate.day = 4; /* closed by the base */
+    holiday_overlay_set(department, &testdate, OVERLAY_OPEN);
+    sprintf(message, "Department overlays are separate... ");
+    overlay_test_stats.ttl_tests++;
+    if (holiday_overlay_numdates(department) == 1 &&
+            !holiday_overlay_isholiday(department, &testdate) &&
+            holiday_overlay_isholiday(court, &testdate) ==
+            overlay_expected(base, states, firstjdn, jdncnvrt(&testdate)) &&
+            holiday_overlay_set(department, &testdate, 7) == -1) {
+        overlay_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_overlay_release(department);
+    holiday_overlay_release(court);
+    holiday_ruleset_close(base);
+    display_stats(&overlay_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_effective(const char *rulefile_name)
+{
+    static const int knowndates[][4] = { /* year, month, day, closed */
+        {1968, 2, 22, 1}, /* Washington's Birthday on the 22nd until 1970 */
+        {1968, 2, 19, 0},
+        {1972, 2, 21, 1}, /* then on the third Monday */
+        {1972, 2, 22, 0},
+        {1969, 5, 30, 1}, /* Memorial Day on the 30th until 1970 */
+        {1975, 5, 26, 1}, /* then on the last Monday */
+        {1975, 5, 30, 0},
+        {1985, 1, 21, 0}, /* Martin Luther King Jr. Birthday from 1986 */
+        {1986, 1, 20, 1},
+        {2020, 6, 19, 0}, /* Juneteenth from June 17, 2021 */
+        {2023, 6, 19, 1}
+    };
+    static const struct HolidayRuleSpec inauguration = {JANUARY, 'A', 0, 0,
+        20, "Inauguration Day", "5 U.S.C. 6103(c)", 20210120, 20210120,
+        0, 0};
+    static const struct HolidayRuleSpec backward = {JANUARY, 'A', 0, 0,
+        20, "Backward", "none", 20220101, 20210101,
+        0, 0};
+    struct RuleSet *rules;
+    struct DateTime testdate;
+    char datestring[DATESTRINGLEN];
+    char message[MAXMESSAGELEN];
+    struct teststats effective_test_stats;
+    int closed;
+    int idx;
+
+    effective_test_stats.ttl_tests = 0;
+    effective_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Effective Dates of Rules", BUILD_FRAME);
+
+    rules = holiday_ruleset_load(rulefile_name);
+    for (idx = 0; rules != NULL &&
+            idx < (int) (sizeof(knowndates) / sizeof(knowndates[0])); idx++) {
+        testdate.year = knowndates[idx][0];
+        testdate.month = knowndates[idx][1];
+        testdate.day = knowndates[idx][2];
+        closed = holiday_ruleset_isholiday(rules, &testdate);
+        date_to_string(datestring, &testdate, MDY);
+        sprintf(message, "%s is %s... ", datestring,
+                closed ? "closed" : "open");
+        effective_test_stats.ttl_tests++;
+        if (closed == knowndates[idx][3]) {
+            effective_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    sprintf(message, "A rule added for one day only... ");
+    effective_test_stats.ttl_tests++;
+    closed = -1;
+    if (rules != NULL && holiday_ruleset_add_rule(rules, &inauguration) == 0 &&
+            holiday_ruleset_add_rule(rules, &backward) == -1) {
+        testdate.year = 2021;
+        testdate.month = 1;
+        testdate.day = 20;
+        closed = holiday_ruleset_isholiday(rules, &testdate);
+        testdate.year = 2022;
+        closed -= holiday_ruleset_isholiday(rules, &testdate);
+    }
+    if (closed == 1) {
+        effective_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules);
+    display_stats(&effective_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_observed(const char *rulefile_name)
+{
+    static const int knowndates[][4] = { /* year, month, day, closed */
+        {2024, 3, 29, 1}, /* Good Friday */
+        {2024, 4, 1, 0}, /* Easter Monday */
+        {2038, 4, 23, 1}, /* Good Friday, with Easter on April 25 */
+        {2026, 7, 3, 1}, /* July 4 is a Saturday */
+        {2027, 7, 5, 1}, /* July 4 is a Sunday */
+        {2027, 7, 2, 0},
+        {2022, 12, 26, 1}, /* Christmas is a Sunday */
+        {2021, 12, 24, 1}, /* Christmas is a Saturday */
+        {2023, 1, 2, 1}, /* New Year's Day is a Sunday */
+        {2021, 12, 31, 0} /* ...but is not moved back into the old year */
+    };
+    static const struct HolidayRuleSpec newyear = {JANUARY, 'O', 0, 0, 1,
+        "New Year's Day", "Exchange Rule 7.2", 0, 0, SHIFT_NEAREST, 0};
+    static const struct HolidayRuleSpec easter = {ALLMONTHS, 'E', 0, 0, 0,
+        "Easter Monday", "Exchange Rule 7.2", 0, 0, 0, 1};
+    static const struct HolidayRuleSpec badeaster = {ALLMONTHS, 'E', 0, 0, 0,
+        "Too Late", "none", 0, 0, 0, EASTERMAXOFFSET + 1};
+    struct RuleSet *rules;
+    struct DateTime testdate;
+    char datestring[DATESTRINGLEN];
+    char message[MAXMESSAGELEN];
+    struct teststats observed_test_stats;
+    int closed;
+    int idx;
+
+    observed_test_stats.ttl_tests = 0;
+    observed_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Observed and Easter Holidays", BUILD_FRAME);
+
+    rules = holiday_ruleset_load(rulefile_name);
+    for (idx = 0; rules != NULL &&
+            idx < (int) (sizeof(knowndates) / sizeof(knowndates[0])); idx++) {
+        testdate.year = knowndates[idx][0];
+        testdate.month = knowndates[idx][1];
+        testdate.day = knowndates[idx][2];
+        closed = holiday_ruleset_isholiday(rules, &testdate);
+        date_to_string(datestring, &testdate, MDY);
+        sprintf(message, "%s is %s... ", datestring,
+                closed ? "closed" : "open");
+        observed_test_stats.ttl_tests++;
+        if (closed == knowndates[idx][3]) {
+            observed_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    /* a shift out of range and an offset that is not a number */
+    sprintf(message, "Malformed O and E records skipped... ");
+    observed_test_stats.ttl_tests++;
+    if (rules != NULL &&
+            holiday_ruleset_remove_rule(rules, "Bad Shift") == -1 &&
+            holiday_ruleset_remove_rule(rules, "Bad Easter") == -1) {
+        observed_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* the years above are compiled, so these edits patch them */
+    sprintf(message, "Rules edited into compiled years... ");
+    observed_test_stats.ttl_tests++;
+    closed = -1;
+    if (rules != NULL &&
+            holiday_ruleset_replace_rule(rules, "New Year's Day",
+                &newyear) == 0 &&
+            holiday_ruleset_add_rule(rules, &easter) == 0 &&
+            holiday_ruleset_add_rule(rules, &badeaster) == -1) {
+        testdate.year = 2021;
+        testdate.month = 12;
+        testdate.day = 31;
+        closed = holiday_ruleset_isholiday(rules, &testdate);
+        testdate.year = 2024;
+        testdate.month = 4;
+        testdate.day = 1;
+        closed += holiday_ruleset_isholiday(rules, &testdate);
+    }
+    if (closed == 2) {
+        observed_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules);
+    display_stats(&observed_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_diff(const char *rulefile_name)
+{
+    static const struct HolidayRuleSpec columbus = {OCTOBER, 'A', 0, 0, 12,
+        "Columbus Day", "5 U.S.C. 6103(a)", 0, 0, 0, 0};
+    static struct HolidayDiff diffs[200];
+    struct RuleSet *before;
+    struct RuleSet *after;
+    struct DateTime testdate;
+    char message[MAXMESSAGELEN];
+    struct teststats diff_test_stats;
+    int numdiffs = -1;
+    int differ = 0;
+    int agree = 0;
+    int idx;
+
+    diff_test_stats.ttl_tests = 0;
+    diff_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Rule Set Differences", BUILD_FRAME);
+
+    before = holiday_ruleset_load(rulefile_name);
+    after = holiday_ruleset_load(rulefile_name);
+
+    sprintf(message, "A rule set matches itself... ");
+    diff_test_stats.ttl_tests++;
+    if (before != NULL && after != NULL &&
+            holiday_ruleset_diff(before, after, 1990, 2060, diffs, 200) == 0 &&
+            holiday_ruleset_diff(before, after, 2060, 1990, diffs, 200) == -1) {
+        diff_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    if (after != NULL &&
+            holiday_ruleset_remove_rule(after,
+                "Juneteenth National Independence Day") == 0 &&
+            holiday_ruleset_replace_rule(after, "Columbus Day",
+                &columbus) == 0)
+        numdiffs = holiday_ruleset_diff(before, after, 1990, 2060, diffs, 200);
+
+    /* every day checked one at a time under both rule sets */
+    testdate.year = 1990;
+    testdate.month = 1;
+    testdate.day = 1;
+    while (numdiffs >= 0 && testdate.year <= 2060) {
+        if (holiday_ruleset_isholiday(before, &testdate) !=
+                holiday_ruleset_isholiday(after, &testdate)) {
+            if (differ < numdiffs && differ < 200 &&
+                    diffs[differ].date.year == testdate.year &&
+                    diffs[differ].date.month == testdate.month &&
+                    diffs[differ].date.day == testdate.day &&
+                    diffs[differ].closed_before ==
+                    holiday_ruleset_isholiday(before, &testdate))
+                agree++;
+            differ++;
+        }
+        jdn2greg(jdncnvrt(&testdate) + 1, &testdate);
+    }
+    sprintf(message, "%d of %d differences found day by day... ", agree,
+            numdiffs);
+    diff_test_stats.ttl_tests++;
+    if (numdiffs > 0 && agree == differ && differ == numdiffs) {
+        diff_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "The rules responsible are named... ");
+    diff_test_stats.ttl_tests++;
+    agree = 0;
+    for (idx = 0; idx < numdiffs && idx < 200; idx++) {
+        if (diffs[idx].date.year == 2023 && diffs[idx].date.month == 6)
+            agree += strcmp(diffs[idx].before_rule,
+                    "Juneteenth National Independence Day") == 0 &&
+                *diffs[idx].after_rule == '\0';
+        if (diffs[idx].date.year == 2023 && diffs[idx].date.month == 10)
+            agree += strcmp(diffs[idx].before_rule, "Columbus Day") == 0 ||
+                strcmp(diffs[idx].after_rule, "Columbus Day") == 0;
+    }
+    if (agree == 3) { /* June 19 and October 9 and 12, 2023 */
+        diff_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(after);
+    holiday_ruleset_close(before);
+    display_stats(&diff_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_nextcourtday(const char *rulefile_name)
+{
+    static const char *const names[3] = {"Next", "Previous", "Nearest"};
+    struct RuleSet *rules;
+    struct DateTime testdate;
+    struct DateTime rolled;
+    struct DateTime expected[3];
+    char message[MAXMESSAGELEN];
+    struct teststats next_test_stats;
+    int agree[3] = {0, 0, 0};
+    int numdates = 0;
+    int jdn;
+    int way;
+
+    next_test_stats.ttl_tests = 0;
+    next_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Next and Previous Court Days", BUILD_FRAME);
+
+    /* every day of 2021 - 2024 against a day-by-day search */
+    rules = holiday_ruleset_load(rulefile_name);
+    testdate.year = 2021;
+    testdate.month = 1;
+    testdate.day = 1;
+    while (rules != NULL && testdate.year <= 2024) {
+        jdn = jdncnvrt(&testdate);
+        for (way = 0; way < 2; way++) {
+            expected[way] = testdate;
+            while (holiday_ruleset_isholiday(rules, &expected[way]))
+                jdn2greg(jdncnvrt(&expected[way]) + (way == 0 ? 1 : -1),
+                         &expected[way]);
+        }
+        expected[2] = jdncnvrt(&expected[0]) - jdn <=
+            jdn - jdncnvrt(&expected[1]) ? expected[0] : expected[1];
+
+        for (way = 0; way < 3; way++) {
+            rolled.year = 0;
+            if (way == 0)
+                holiday_ruleset_next_courtday(rules, &testdate, &rolled);
+            else if (way == 1)
+                holiday_ruleset_prev_courtday(rules, &testdate, &rolled);
+            else
+                holiday_ruleset_nearest_courtday(rules, &testdate, &rolled);
+            agree[way] += rolled.year == expected[way].year &&
+                rolled.month == expected[way].month &&
+                rolled.day == expected[way].day &&
+                rolled.jdn == jdncnvrt(&expected[way]);
+        }
+        numdates++;
+        jdn2greg(jdn + 1, &testdate);
+    }
+
+    for (way = 0; way < 3; way++) {
+        sprintf(message, "%s court day right for %d of %d dates... ",
+                names[way], agree[way], numdates);
+        next_test_stats.ttl_tests++;
+        if (numdates > 0 && agree[way] == numdates) {
+            next_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    sprintf(message, "No court day before 1753... ");
+    next_test_stats.ttl_tests++;
+    testdate.year = 1753;
+    testdate.month = 1;
+    testdate.day = 1;
+    if (rules != NULL &&
+            holiday_ruleset_prev_courtday(rules, &testdate, &rolled) == -1) {
+        next_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules);
+    display_stats(&next_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_enumerate(const char *rulefile_name)
+{
+    struct RuleSet *rules;
+    struct HolidayEnumeration cursor;
+    struct DateTime first;
+    struct DateTime last;
+    struct DateTime testdate;
+    char message[MAXMESSAGELEN];
+    struct teststats enum_test_stats;
+    int dates[100];
+    int numdates;
+    int listed = 0;
+    int agree = 0;
+    int expected = 0;
+    int idx;
+
+    enum_test_stats.ttl_tests = 0;
+    enum_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Enumerating Court Days", BUILD_FRAME);
+
+    rules = holiday_ruleset_load(rulefile_name);
+    first.year = 2020;
+    first.month = 3;
+    first.day = 15;
+    last.year = 2024;
+    last.month = 10;
+    last.day = 20;
+
+    /* court days as JDNs, a week's worth at a time */
+    testdate = first;
+    holiday_enumerate_begin(&cursor, &first, &last, ENUM_COURTDAYS);
+    while (rules != NULL &&
+            (numdates = holiday_ruleset_enumerate(rules, &cursor, dates,
+                                                  7)) > 0) {
+        for (idx = 0; idx < numdates; idx++, listed++) {
+            while (holiday_ruleset_isholiday(rules, &testdate))
+                jdn2greg(jdncnvrt(&testdate) + 1, &testdate);
+            agree += dates[idx] == jdncnvrt(&testdate);
+            jdn2greg(jdncnvrt(&testdate) + 1, &testdate);
+        }
+    }
+    for (testdate = first; jdncnvrt(&testdate) <= jdncnvrt(&last);
+            jdn2greg(jdncnvrt(&testdate) + 1, &testdate))
+        expected += rules != NULL && !holiday_ruleset_isholiday(rules,
+                                                                &testdate);
+    sprintf(message, "%d of %d court days listed in order... ", agree,
+            expected);
+    enum_test_stats.ttl_tests++;
+    if (expected > 0 && agree == expected && listed == expected) {
+        enum_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* holidays as YYYYMMDD, in one call */
+    first.year = 2024;
+    first.month = 1;
+    first.day = 1;
+    last.year = 2024;
+    last.month = 12;
+    last.day = 31;
+    holiday_enumerate_begin(&cursor, &first, &last,
+                            ENUM_HOLIDAYS | ENUM_PACKED);
+    numdates = rules != NULL ?
+        holiday_ruleset_enumerate(rules, &cursor, dates, 100) : 0;
+    agree = 0;
+    for (idx = 0; idx < numdates; idx++) {
+        testdate.year = dates[idx] / 10000;
+        testdate.month = dates[idx] / 100 % 100;
+        testdate.day = dates[idx] % 100;
+        agree += holiday_ruleset_isholiday(rules, &testdate);
+    }
+    sprintf(message, "%d holidays and weekends in 2024... ", numdates);
+    enum_test_stats.ttl_tests++;
+    /* 104 weekend days and the 11 federal holidays, none on a weekend */
+    if (numdates == 100 && agree == 100 &&
+            dates[0] == 20240101 && dates[99] == 20241116 &&
+            holiday_ruleset_enumerate(rules, &cursor, dates, 100) == 15 &&
+            dates[14] == 20241229 &&
+            holiday_ruleset_enumerate(rules, &cursor, dates, 100) == 0) {
+        enum_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules);
+    display_stats(&enum_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_periodstats(const char *rulefile_name)
+{
+    static struct HolidayPeriodStats months[2 * 120];
+    static struct HolidayPeriodStats quarters[40];
+    struct HolidayPeriodStats years[10];
+    struct RuleSet *rules[2];
+    struct DateTime testdate;
+    char message[MAXMESSAGELEN];
+    struct teststats stats_test_stats;
+    int numstats;
+    int courtdays;
+    int agree = 0;
+    int idx;
+
+    stats_test_stats.ttl_tests = 0;
+    stats_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Court-Day Statistics", BUILD_FRAME);
+
+    rules[0] = holiday_ruleset_load(rulefile_name);
+    rules[1] = holiday_ruleset_active();
+
+    /* each month of 2020 - 2029 counted a day at a time */
+    numstats = rules[0] != NULL ?
+        holiday_ruleset_period_stats_batch(rules, 2, 2020, 2029, PERIOD_MONTH,
+                                           months) : -1;
+    for (idx = 0; idx < 2 * numstats; idx++) {
+        courtdays = 0;
+        testdate.year = months[idx].year;
+        testdate.month = months[idx].period;
+        for (testdate.day = 1; testdate.day <=
+                daysinmonths[isleapyear(&testdate)][testdate.month];
+                testdate.day++)
+            courtdays += !holiday_ruleset_isholiday(rules[idx / numstats],
+                                                    &testdate);
+        agree += courtdays == months[idx].courtdays &&
+            courtdays + months[idx].holidays ==
+            daysinmonths[isleapyear(&testdate)][testdate.month];
+    }
+    sprintf(message, "%d of %d months counted right... ", agree,
+            2 * numstats);
+    stats_test_stats.ttl_tests++;
+    if (numstats == 120 && agree == 2 * numstats) {
+        stats_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* the quarters and years add up the months */
+    agree = 0;
+    if (holiday_ruleset_period_stats(rules[0], 2020, 2029, PERIOD_QUARTER,
+                quarters, 40) == 40 &&
+            holiday_ruleset_period_stats(rules[0], 2020, 2029, PERIOD_YEAR,
+                years, 10) == 10) {
+        for (idx = 0; idx < 120; idx++) {
+            quarters[idx / 3].courtdays -= months[idx].courtdays;
+            years[idx / 12].courtdays -= months[idx].courtdays;
+        }
+        for (idx = 0; idx < 40; idx++)
+            agree += quarters[idx].courtdays == 0;
+        for (idx = 0; idx < 10; idx++)
+            agree += years[idx].courtdays == 0;
+    }
+    sprintf(message, "Quarters and years add up... ");
+    stats_test_stats.ttl_tests++;
+    if (agree == 50 && years[4].year == 2024 && years[4].period == 0 &&
+            years[4].holidays == 115 && quarters[39].period == 4) {
+        stats_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules[0]);
+    display_stats(&stats_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_ordinal(const char *rulefile_name)
+{
+    static const int kinds[3] = {PERIOD_MONTH, PERIOD_QUARTER, PERIOD_YEAR};
+    struct RuleSet *rules;
+    struct DateTime testdate;
+    struct DateTime found;
+    char message[MAXMESSAGELEN];
+    struct teststats ordinal_test_stats;
+    int count[3] = {0, 0, 0};
+    int numdays = 0;
+    int agree = 0;
+    int kind;
+    int period;
+
+    ordinal_test_stats.ttl_tests = 0;
+    ordinal_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Court Days Within a Period", BUILD_FRAME);
+
+    /* every day of 2023 - 2025, counting court days as we go */
+    rules = holiday_ruleset_load(rulefile_name);
+    testdate.year = 2023;
+    testdate.month = 1;
+    testdate.day = 1;
+    while (rules != NULL && testdate.year <= 2025) {
+        if (testdate.day == 1) {
+            count[0] = 0;
+            if (testdate.month % 3 == 1)
+                count[1] = 0;
+            if (testdate.month == JANUARY)
+                count[2] = 0;
+        }
+        if (holiday_ruleset_isholiday(rules, &testdate)) {
+            agree += holiday_ruleset_courtday_ordinal(rules, &testdate,
+                                                      PERIOD_MONTH) == 0;
+        } else {
+            agree++;
+            for (kind = 0; kind < 3; kind++) {
+                count[kind]++;
+                period = kinds[kind] == PERIOD_MONTH ? testdate.month :
+                    (testdate.month - 1) / 3 + 1;
+                found.year = 0;
+                holiday_ruleset_nth_courtday(rules, testdate.year,
+                                             kinds[kind], period,
+                                             count[kind], &found);
+                if (holiday_ruleset_courtday_ordinal(rules, &testdate,
+                            kinds[kind]) != count[kind] ||
+                        found.year != testdate.year ||
+                        found.month != testdate.month ||
+                        found.day != testdate.day) {
+                    agree--;
+                    break;
+                }
+            }
+        }
+        numdays++;
+        jdn2greg(jdncnvrt(&testdate) + 1, &testdate);
+    }
+    sprintf(message, "%d of %d days numbered right... ", agree, numdays);
+    ordinal_test_stats.ttl_tests++;
+    if (numdays > 0 && agree == numdays) {
+        ordinal_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* 2024 has 251 court days, the last on December 31 */
+    sprintf(message, "Counting back from the end of the period... ");
+    ordinal_test_stats.ttl_tests++;
+    found.year = 0;
+    if (rules != NULL &&
+            holiday_ruleset_nth_courtday(rules, 2024, PERIOD_YEAR, 0, -251,
+                                         &found) == 0 &&
+            found.month == 1 && found.day == 2 &&
+            holiday_ruleset_nth_courtday(rules, 2024, PERIOD_YEAR, 0, -1,
+                                         &found) == 0 &&
+            found.month == 12 && found.day == 31 &&
+            holiday_ruleset_nth_courtday(rules, 2024, PERIOD_YEAR, 0, 252,
+                                         &found) == -1 &&
+            holiday_ruleset_nth_courtday(rules, 2024, PERIOD_MONTH, 13, 1,
+                                         &found) == -1) {
+        ordinal_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules);
+    display_stats(&ordinal_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/* Explains a date and checks the reason given */
+static int explain_expect(struct RuleSet *rules, int year, int month, int day,
+                          int closed, const char *holidayname)
+{
+    struct HolidayExplanation why;
+    struct DateTime testdate;
+
+    testdate.year = year;
+    testdate.month = month;
+    testdate.day = day;
+    return holiday_ruleset_explain(rules, &testdate, &why) == closed &&
+        strcmp(why.holidayname, holidayname) == 0;
+}
+
+void testsuite_check_explain(const char *rulefile_name)
+{
+    static const struct HolidayRuleSpec stpatrick = {MARCH, 'A', 0, 0, 17,
+        "St. Patrick's Day", "none", 0, 0, 0, 0};
+    static struct HolidayExplanation why[1200];
+    struct HolidayExplanation one;
+    struct RuleSet *rules;
+    struct DateTime first;
+    struct DateTime last;
+    struct DateTime testdate;
+    char message[MAXMESSAGELEN];
+    struct teststats explain_test_stats;
+    int numwhy = 0;
+    int numclosed = 0;
+    int agree = 0;
+    int idx;
+
+    explain_test_stats.ttl_tests = 0;
+    explain_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Which Holiday Closes a Day", BUILD_FRAME);
+
+    rules = holiday_ruleset_load(rulefile_name);
+    sprintf(message, "Thanksgiving, a Saturday and a court day... ");
+    explain_test_stats.ttl_tests++;
+    if (rules != NULL &&
+            explain_expect(rules, 2024, 11, 28, 1, "Thanksgiving Day") &&
+            explain_expect(rules, 2024, 11, 30, 1, "Saturday") &&
+            explain_expect(rules, 2024, 11, 27, 0, "") &&
+            explain_expect(rules, 2024, 2, 30, -1, "")) {
+        explain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* every closed day of 2023 - 2025, against isholiday and explain */
+    first.year = 2023;
+    first.month = JANUARY;
+    first.day = 1;
+    last.year = 2025;
+    last.month = DECEMBER;
+    last.day = 31;
+    testdate = first;
+    while (rules != NULL && testdate.year <= 2025) {
+        numclosed += holiday_ruleset_isholiday(rules, &testdate);
+        jdn2greg(jdncnvrt(&testdate) + 1, &testdate);
+    }
+    if (rules != NULL)
+        numwhy = holiday_ruleset_explain_range(rules, &first, &last, why,
+                                               1200);
+    for (idx = 0; idx < numwhy && idx < 1200; idx++) {
+        jdn2greg(why[idx].jdn, &testdate);
+        if (holiday_ruleset_isholiday(rules, &testdate) &&
+                holiday_ruleset_explain(rules, &testdate, &one) == 1 &&
+                strcmp(one.holidayname, why[idx].holidayname) == 0 &&
+                strcmp(one.authority, why[idx].authority) == 0 &&
+                why[idx].holidayname[0] != '\0')
+            agree++;
+    }
+    sprintf(message, "%d of %d closed days explained... ", agree, numclosed);
+    explain_test_stats.ttl_tests++;
+    if (numclosed > 0 && numwhy == numclosed && agree == numclosed &&
+            holiday_ruleset_explain_range(rules, &first, &last, why, 1) ==
+            numclosed) {
+        explain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Reasons follow rule edits... ");
+    explain_test_stats.ttl_tests++;
+    if (rules != NULL &&
+            explain_expect(rules, 2025, 3, 17, 0, "") &&
+            holiday_ruleset_add_rule(rules, &stpatrick) == 0 &&
+            explain_expect(rules, 2025, 3, 17, 1, "St. Patrick's Day") &&
+            holiday_ruleset_remove_rule(rules, "Thanksgiving Day") == 0 &&
+            explain_expect(rules, 2024, 11, 28, 0, "")) {
+        explain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_ruleset_close(rules);
+    display_stats(&explain_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/* A deadline worked out a day at a time, to check chains against */
+static int chain_reference(struct RuleSet *rules,
+                           const struct DeadlineSpec *deadline, int jdn)
+{
+    struct DateTime dt;
+    int direction = deadline->amount < 0 ? -1 : 1;
+    int count = 0;
+
+    if (deadline->step != STEP_COURTDAYS) {
+        jdn += deadline->amount;
+        direction = deadline->step == STEP_ROLLBACKWARD ? -1 : 1;
+        jdn2greg(jdn, &dt);
+        while (deadline->step != STEP_CALENDARDAYS &&
+                holiday_ruleset_isholiday(rules, &dt))
+            jdn2greg(jdn += direction, &dt);
+        return jdn;
+    }
+    while (count != deadline->amount) {
+        jdn2greg(jdn += direction, &dt);
+        if (!holiday_ruleset_isholiday(rules, &dt))
+            count += direction;
+    }
+    return jdn;
+}
+
+/* Whether a fan-out of offsets matches each offset counted on its own */
+static int chain_fanout_agrees(struct RuleSet *rules, struct DateTime *start,
+                               int step)
+{
+    static const int offsets[11] = {-400, -60, -30, -10, 0, 0, 10, 15, 20,
+        30, 60};
+    struct DeadlineSpec deadline = {"", CHAINTRIGGER, 0, 0};
+    struct DateTime results[11];
+    int idx;
+
+    deadline.step = step;
+    memset(results, 0xff, sizeof(results)); /* no stale weekdays */
+    if (holiday_ruleset_offset_fanout(rules, start, step, offsets, 11,
+                                      results) != 0)
+        return 0;
+    for (idx = 0; idx < 11; idx++) {
+        deadline.amount = offsets[idx];
+        if (results[idx].jdn != jdncnvrt(&results[idx]) ||
+                (int) results[idx].day_of_week !=
+                derive_weekday(&results[idx]) ||
+                results[idx].jdn != chain_reference(rules, &deadline,
+                                                    jdncnvrt(start)))
+            return 0;
+    }
+    return 1;
+}
+
+/* A deadline of a chain from a trigger date given as a JDN */
+static int chain_deadline(struct RuleSet *rules,
+                          const struct HolidayChain *chain, int deadline,
+                          int triggerjdn)
+{
+    struct DateTime trigger;
+    int jdns[6];
+
+    jdn2greg(triggerjdn, &trigger);
+    holiday_ruleset_evaluate_deadlines(rules, chain, &trigger, jdns);
+    return jdns[deadline];
+}
+
+/* Whether the latest and earliest triggers for a target are the edges: the
+ * deadline falls on or before (after) the target from them, but not from the
+ * day after (before) */
+static int chain_solves(struct RuleSet *rules,
+                        const struct HolidayChain *chain, int deadline,
+                        struct DateTime *target)
+{
+    struct DateTime latest;
+    struct DateTime earliest;
+    int targetjdn = jdncnvrt(target);
+
+    return holiday_ruleset_latest_trigger(rules, chain, deadline, target,
+                                          &latest) == 0 &&
+        holiday_ruleset_earliest_trigger(rules, chain, deadline, target,
+                                         &earliest) == 0 &&
+        chain_deadline(rules, chain, deadline, latest.jdn) <= targetjdn &&
+        chain_deadline(rules, chain, deadline, latest.jdn + 1) > targetjdn &&
+        chain_deadline(rules, chain, deadline, earliest.jdn) >= targetjdn &&
+        chain_deadline(rules, chain, deadline, earliest.jdn - 1) < targetjdn;
+}
+
+void testsuite_check_chain(const char *rulefile_name)
+{
+    /* a motion schedule, listed out of order on purpose */
+    static const struct DeadlineSpec motion[6] = {
+        {"Reply due", 5, STEP_COURTDAYS, -5},
+        {"Opposition due", 5, STEP_COURTDAYS, -9},
+        {"Motion served", 5, STEP_ROLLBACKWARD, -16},
+        {"Proposed order due", 0, STEP_CALENDARDAYS, 2},
+        {"Ruling expected", 5, STEP_ROLLFORWARD, 30},
+        {"Hearing", CHAINTRIGGER, STEP_ROLLFORWARD, 0}
+    };
+    static const struct DeadlineSpec cycle[2] = {
+        {"A", 1, STEP_COURTDAYS, 1},
+        {"B", 0, STEP_COURTDAYS, 1}
+    };
+    static const struct DeadlineSpec dangling[1] = {
+        {"A", 3, STEP_COURTDAYS, 1}
+    };
+    static const int unsorted[3] = {10, 30, 15};
+    static const struct DeadlineSpec steps[9] = {
+        {"", CHAINTRIGGER, STEP_COURTDAYS, 1},
+        {"", CHAINTRIGGER, STEP_COURTDAYS, 10},
+        {"", CHAINTRIGGER, STEP_COURTDAYS, -1},
+        {"", CHAINTRIGGER, STEP_COURTDAYS, -9},
+        {"", CHAINTRIGGER, STEP_CALENDARDAYS, 30},
+        {"", CHAINTRIGGER, STEP_ROLLFORWARD, 30},
+        {"", CHAINTRIGGER, STEP_ROLLFORWARD, -3},
+        {"", CHAINTRIGGER, STEP_ROLLBACKWARD, 16},
+        {"", CHAINTRIGGER, STEP_ROLLBACKWARD, -16}
+    };
+    struct DateTime fanout[3];
+    struct HolidayChain *single;
+    struct HolidayChain *chain;
+    struct RuleSet *rules;
+    struct DateTime trigger;
+    char message[MAXMESSAGELEN];
+    struct teststats chain_test_stats;
+    int jdns[6];
+    int expected;
+    int numtriggers = 0;
+    int agree = 0;
+    int idx;
+
+    chain_test_stats.ttl_tests = 0;
+    chain_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Deadline Chains", BUILD_FRAME);
+
+    /* a hearing set on every day of 2023 - 2025 */
+    rules = holiday_ruleset_load(rulefile_name);
+    chain = holiday_chain_build(motion, 6);
+    trigger.year = 2023;
+    trigger.month = 1;
+    trigger.day = 1;
+    while (rules != NULL && chain != NULL && trigger.year <= 2025) {
+        numtriggers++;
+        agree++;
+        if (holiday_ruleset_evaluate_deadlines(rules, chain, &trigger,
+                                               jdns) != 0)
+            agree--;
+        for (idx = 0; idx < 6; idx++) {
+            expected = chain_reference(rules, &motion[idx],
+                motion[idx].from == CHAINTRIGGER ? jdncnvrt(&trigger) :
+                jdns[motion[idx].from]);
+            if (jdns[idx] != expected) {
+                agree--;
+                break;
+            }
+        }
+        jdn2greg(jdncnvrt(&trigger) + 1, &trigger);
+    }
+    sprintf(message, "%d of %d schedules right... ", agree, numtriggers);
+    chain_test_stats.ttl_tests++;
+    if (numtriggers > 0 && agree == numtriggers) {
+        chain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* hearing Monday, December 2, 2024: opposition 9 court days before is
+     * November 18 (Thanksgiving and the weekends skipped) */
+    sprintf(message, "Opposition and reply before a hearing... ");
+    chain_test_stats.ttl_tests++;
+    trigger.year = 2024;
+    trigger.month = 12;
+    trigger.day = 2;
+    jdns[1] = jdns[0] = 0;
+    if (chain != NULL &&
+            holiday_ruleset_evaluate_deadlines(rules, chain, &trigger,
+                                               jdns) == 0) {
+        jdn2greg(jdns[1], &trigger);
+        expected = trigger.month == 11 && trigger.day == 18;
+        jdn2greg(jdns[0], &trigger);
+        expected = expected && trigger.month == 11 && trigger.day == 22;
+    } else {
+        expected = 0;
+    }
+    if (expected) {
+        chain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* a fan-out of offsets from every day of 2024, counted both ways */
+    trigger.year = 2024;
+    trigger.month = 1;
+    trigger.day = 1;
+    agree = 0;
+    numtriggers = 0;
+    while (rules != NULL && trigger.year == 2024) {
+        numtriggers++;
+        if (chain_fanout_agrees(rules, &trigger, STEP_COURTDAYS) &&
+                chain_fanout_agrees(rules, &trigger, STEP_ROLLFORWARD))
+            agree++;
+        jdn2greg(jdncnvrt(&trigger) + 1, &trigger);
+    }
+    sprintf(message, "Fan-out: %d of %d start dates right... ", agree,
+            numtriggers);
+    chain_test_stats.ttl_tests++;
+    if (numtriggers > 0 && agree == numtriggers) {
+        chain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* solving backward, for every kind of step and for the whole chain */
+    agree = 0;
+    numtriggers = 0;
+    for (idx = 0; rules != NULL && chain != NULL && idx < 9; idx++) {
+        single = holiday_chain_build(&steps[idx], 1);
+        trigger.year = 2024;
+        trigger.month = 1;
+        trigger.day = 1;
+        while (single != NULL && trigger.year == 2024) {
+            numtriggers++;
+            agree += chain_solves(rules, single, 0, &trigger) &&
+                (idx > 0 || chain_solves(rules, chain, 0, &trigger));
+            jdn2greg(jdncnvrt(&trigger) + 1, &trigger);
+        }
+        holiday_chain_release(single);
+    }
+    /* one court day to land by Tuesday, December 3, 2024: start by Monday;
+     * to land on or after Monday, December 2: start from Friday */
+    trigger.year = 2024;
+    trigger.month = 12;
+    trigger.day = 3;
+    fanout[0].day = fanout[1].day = 0;
+    if (rules != NULL) {
+        holiday_ruleset_latest_courtday_start(rules, &trigger, 1, &fanout[0]);
+        trigger.day = 2;
+        holiday_ruleset_earliest_courtday_start(rules, &trigger, 1,
+                                                &fanout[1]);
+    }
+    sprintf(message, "Solving backward: %d of %d right... ", agree,
+            numtriggers);
+    chain_test_stats.ttl_tests++;
+    if (numtriggers == 9 * 366 && agree == numtriggers &&
+            fanout[0].month == 12 && fanout[0].day == 2 &&
+            fanout[1].month == 11 && fanout[1].day == 29) {
+        chain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    sprintf(message, "Cycles, missing deadlines, unsorted offsets... ");
+    chain_test_stats.ttl_tests++;
+    if (holiday_chain_build(cycle, 2) == NULL &&
+            holiday_chain_build(dangling, 1) == NULL &&
+            holiday_chain_build(motion, 0) == NULL &&
+            holiday_ruleset_offset_fanout(rules, &trigger, STEP_COURTDAYS,
+                                          unsorted, 3, fanout) == -1) {
+        chain_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_chain_release(chain);
+    holiday_ruleset_close(rules);
+    display_stats(&chain_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+void testsuite_check_chainbatch(const char *rulefile_name)
+{
+    static const struct DeadlineSpec motion[4] = {
+        {"Hearing", CHAINTRIGGER, STEP_ROLLFORWARD, 0},
+        {"Opposition due", 0, STEP_COURTDAYS, -9},
+        {"Reply due", 0, STEP_COURTDAYS, -5},
+        {"Ruling expected", 0, STEP_ROLLFORWARD, 90}
+    };
+    struct HolidayChainWorkerStats stats[MAXCHAINTHREADS];
+    struct HolidayChain *chain;
+    struct RuleSet *rules;
+    struct DateTime trigger;
+    char message[MAXMESSAGELEN];
+    struct teststats batch_test_stats;
+    int *columns[4];
+    int *triggerjdns;
+    int *jdns;
+    int expected[4];
+    int numcases = 20000;
+    int numthreads;
+    int threadctr;
+    int idx;
+    long cases;
+    long failures;
+    int agree;
+
+    batch_test_stats.ttl_tests = 0;
+    batch_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Deadline Chains for Many Cases", BUILD_FRAME);
+
+    /* one case a day from 2000, the last few past 9999 to fail */
+    rules = holiday_ruleset_load(rulefile_name);
+    chain = holiday_chain_build(motion, 4);
+    triggerjdns = malloc((size_t) numcases * sizeof(int));
+    jdns = malloc((size_t) numcases * 4 * sizeof(int));
+    trigger.year = 2000;
+    trigger.month = 1;
+    trigger.day = 1;
+    for (idx = 0; triggerjdns != NULL && idx < numcases; idx++)
+        triggerjdns[idx] = jdncnvrt(&trigger) + idx;
+    if (triggerjdns != NULL) {
+        trigger.year = 9999;
+        trigger.month = 12;
+        trigger.day = 31;
+        triggerjdns[numcases - 1] = jdncnvrt(&trigger);
+    }
+
+    for (threadctr = 1; threadctr <= 8; threadctr *= 2) {
+        agree = 0;
+        cases = 0;
+        failures = 0;
+        numthreads = -1;
+        if (rules != NULL && chain != NULL && triggerjdns != NULL &&
+                jdns != NULL) {
+            numthreads = holiday_ruleset_evaluate_deadlines_batch(rules,
+                chain, triggerjdns, numcases, jdns, threadctr, stats);
+            for (idx = 0; idx < numthreads; idx++) {
+                cases += stats[idx].cases;
+                failures += stats[idx].failures;
+            }
+            for (idx = 0; idx < numcases; idx++) {
+                jdn2greg(triggerjdns[idx], &trigger);
+                holiday_ruleset_evaluate_deadlines(rules, chain, &trigger,
+                                                   expected);
+                agree += memcmp(expected, &jdns[idx * 4],
+                                sizeof(expected)) == 0;
+            }
+        }
+        sprintf(message, "%d threads: %d of %d cases right... ", numthreads,
+                agree, numcases);
+        batch_test_stats.ttl_tests++;
+        if (numthreads == threadctr && agree == numcases &&
+                cases == numcases && failures == 1) {
+            batch_test_stats.successful_tests++;
+            message_right_justify(message, "PASS", SCREENWIDTH);
+        } else {
+            message_right_justify(message, "FAIL", SCREENWIDTH);
+        }
+        display_results(message, TESTING);
+    }
+
+    /* the same cases a deadline at a time, against the last batch */
+    agree = 0;
+    for (idx = 0; idx < 4; idx++)
+        columns[idx] = malloc((size_t) numcases * sizeof(int));
+    if (rules != NULL && chain != NULL && triggerjdns != NULL &&
+            jdns != NULL && columns[0] != NULL && columns[1] != NULL &&
+            columns[2] != NULL && columns[3] != NULL &&
+            holiday_ruleset_evaluate_deadlines_columns(rules, chain,
+                triggerjdns, numcases, columns) == -1) {
+        for (idx = 0; idx < numcases; idx++) {
+            agree += columns[0][idx] == jdns[idx * 4] &&
+                columns[1][idx] == jdns[idx * 4 + 1] &&
+                columns[2][idx] == jdns[idx * 4 + 2] &&
+                columns[3][idx] == jdns[idx * 4 + 3];
+        }
+    }
+    sprintf(message, "By column: %d of %d cases right... ", agree, numcases);
+    batch_test_stats.ttl_tests++;
+    if (agree == numcases) {
+        batch_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    for (idx = 0; idx < 4; idx++)
+        free(columns[idx]);
+    free(triggerjdns);
+    free(jdns);
+    holiday_chain_release(chain);
+    holiday_ruleset_close(rules);
+    display_stats(&batch_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
+/* Whether the deadlines listed as changed are exactly those expected */
+static int chain_changes_are(struct HolidayChainInstance *instance,
+                             const char *expected)
+{
+    char listed[8] = "";
+    int changed[8];
+    int count;
+    int idx;
+
+    count = holiday_chain_instance_changes(instance, changed, 8);
+    for (idx = 0; idx < count && idx < 7; idx++)
+        listed[idx] = (char) ('0' + changed[idx]);
+    listed[idx] = '\0';
+    return strcmp(listed, expected) == 0;
+}
+
+void testsuite_check_chaininstance(const char *rulefile_name)
+{
+    static const struct DeadlineSpec schedule[5] = {
+        {"Complaint served", CHAINTRIGGER, STEP_CALENDARDAYS, 0},
+        {"Answer due", 0, STEP_ROLLFORWARD, 21},
+        {"Hearing", 0, STEP_ROLLFORWARD, 60},
+        {"Opposition due", 2, STEP_COURTDAYS, -9},
+        {"Reply due", 2, STEP_COURTDAYS, -5}
+    };
+    static const struct HolidayRuleSpec closure = {NOVEMBER, 'A', 0, 0, 4,
+        "Court Closure", "none", 0, 0, 0, 0};
+    struct HolidayChainInstance *instance = NULL;
+    struct HolidayChain *chain;
+    struct RuleSet *rules;
+    struct DateTime trigger;
+    struct DateTime hearing;
+    char message[MAXMESSAGELEN];
+    struct teststats instance_test_stats;
+    int expected[5];
+    int agree;
+    int idx;
+
+    instance_test_stats.ttl_tests = 0;
+    instance_test_stats.successful_tests = 0;
+
+    display_results(NULL, EMPTY_ROW);
+    display_results("Deadline Chains Kept Up to Date", BUILD_FRAME);
+
+    rules = holiday_ruleset_load(rulefile_name);
+    chain = holiday_chain_build(schedule, 5);
+    trigger.year = 2024;
+    trigger.month = 9;
+    trigger.day = 3;
+    if (rules != NULL && chain != NULL)
+        instance = holiday_chain_instance_create(rules, chain, &trigger);
+
+    /* the hearing is continued to Monday, December 16 */
+    sprintf(message, "Continuing the hearing moves only its deadlines... ");
+    instance_test_stats.ttl_tests++;
+    hearing.year = 2024;
+    hearing.month = 12;
+    hearing.day = 16;
+    if (instance != NULL && chain_changes_are(instance, "") &&
+            holiday_chain_instance_pin(instance, 2, &hearing) == 3 &&
+            chain_changes_are(instance, "234") &&
+            holiday_chain_instance_deadline(instance, 2) ==
+            jdncnvrt(&hearing) &&
+            holiday_chain_instance_deadline(instance, 3) ==
+            chain_reference(rules, &schedule[3], jdncnvrt(&hearing))) {
+        instance_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* re-serving moves the answer, but not the continued hearing; once the
+     * hearing is let go it is counted from the new service date again */
+    sprintf(message, "A pinned hearing holds when service moves... ");
+    instance_test_stats.ttl_tests++;
+    trigger.day = 10;
+    agree = 0;
+    if (instance != NULL &&
+            holiday_chain_instance_set_trigger(instance, &trigger) == 2 &&
+            chain_changes_are(instance, "01") &&
+            holiday_chain_instance_pin(instance, 2, NULL) == 3 &&
+            chain_changes_are(instance, "234")) {
+        holiday_ruleset_evaluate_deadlines(rules, chain, &trigger, expected);
+        for (idx = 0; idx < 5; idx++)
+            agree += holiday_chain_instance_deadline(instance, idx) ==
+                expected[idx];
+    }
+    if (agree == 5) {
+        instance_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    /* the hearing is now Tuesday, November 12, after Veterans Day, and the
+     * reply falls on Monday, November 4; closing that day moves it (and the
+     * opposition, counted back past it) */
+    sprintf(message, "Rule edits move the deadlines they touch... ");
+    instance_test_stats.ttl_tests++;
+    agree = 0;
+    if (instance != NULL &&
+            holiday_ruleset_add_rule(rules, &closure) == 0 &&
+            chain_changes_are(instance, "34")) {
+        holiday_ruleset_evaluate_deadlines(rules, chain, &trigger, expected);
+        for (idx = 0; idx < 5; idx++)
+            agree += holiday_chain_instance_deadline(instance, idx) ==
+                expected[idx];
+    }
+    if (agree == 5) {
+        instance_test_stats.successful_tests++;
+        message_right_justify(message, "PASS", SCREENWIDTH);
+    } else {
+        message_right_justify(message, "FAIL", SCREENWIDTH);
+    }
+    display_results(message, TESTING);
+
+    holiday_chain_instance_release(instance);
+    holiday_chain_release(chain);
+    holiday_ruleset_close(rules);
+    display_stats(&instance_test_stats);
+    display_results(NULL, END_FRAME);
+    return;
+}
+
 void testsuite_check_leap(FILE *openedtestfile)
 {
     struct DateTime testdate;
@@ -12,7 +12,25 @@ enum TESTFILETYPES {
     LEAPDATES,
     MATHCALC,
     CALMATH,
-    RULECHECK
+    RULECHECK,
+    CACHEBUDGET,
+    RULESTATS,
+    COMPOSITE,
+    REGISTRY,
+    LANES,
+    RULEEDIT,
+    OVERLAY,
+    EFFECTIVE,
+    OBSERVED,
+    RULEDIFF,
+    NEXTCOURTDAY,
+    ENUMERATE,
+    PERIODSTATS,
+    ORDINAL,
+    EXPLAIN,
+    CHAIN,
+    CHAINBATCH,
+    CHAININSTANCE
 };
 
 
@@ -36,6 +54,25 @@ void testsuite_check_calmath(FILE *openedtestfile);
 void testsuite_check_courtmath(FILE *openedtestfile);
 void testsuite_compute_caldays(FILE *openedtestfile);
 void testsuite_compute_courtdays(FILE *openedtestfile);
+void testsuite_check_cachebudget(FILE *openedtestfile);
+void testsuite_check_rulestats(FILE *openedtestfile);
+void testsuite_check_composite(const char *rulefile_name);
+void testsuite_check_registry(const char *ruledir_name);
+void testsuite_check_store(const char *ruledir_name);
+void testsuite_check_lanes(const char *rulefile_name);
+void testsuite_check_ruleedit(const char *rulefile_name);
+void testsuite_check_overlay(const char *rulefile_name);
+void testsuite_check_effective(const char *rulefile_name);
+void testsuite_check_observed(const char *rulefile_name);
+void testsuite_check_diff(const char *rulefile_name);
+void testsuite_check_nextcourtday(const char *rulefile_name);
+void testsuite_check_enumerate(const char *rulefile_name);
+void testsuite_check_periodstats(const char *rulefile_name);
+void testsuite_check_ordinal(const char *rulefile_name);
+void testsuite_check_explain(const char *rulefile_name);
+void testsuite_check_chain(const char *rulefile_name);
+void testsuite_check_chainbatch(const char *rulefile_name);
+void testsuite_check_chaininstance(const char *rulefile_name);
 /* Display Manager */
 void display_stats(struct teststats *printstats);
 void display_results(const char *message, int testphase);
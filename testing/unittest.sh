@@ -7,5 +7,8 @@ LEAP="./testscripts/leap_test.csv"
 COURTMATH="./testscripts/math_test.csv"
 CALMATH="./testscripts/caldays_test.csv"
 RULE="./testscripts/check_rule_test.csv"
+FEDERAL="./testrules/holidays_federal.csv"
+RULEDIR="./testrules"
+OBSERVED="./testrules/holidays_observed.csv"
 
-bin/test_datetimetools -h$HFILE -w$DERIVE -c$CALC -l$LEAP -r$RULE -m$COURTMATH -k$CALMATH
+bin/test_datetimetools -h$HFILE -w$DERIVE -c$CALC -l$LEAP -r$RULE -m$COURTMATH -k$CALMATH -e$COURTMATH -o$COURTMATH -u$FEDERAL -j$RULEDIR -b$FEDERAL -d$FEDERAL -v$FEDERAL -f$FEDERAL -g$OBSERVED -n$FEDERAL -p$FEDERAL -q$FEDERAL -s$FEDERAL -t$FEDERAL -x$FEDERAL -y$FEDERAL -z$FEDERAL -a$FEDERAL